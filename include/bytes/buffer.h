@@ -61,6 +61,15 @@ public:
 
   void Resize(size_t len);
 
+  /**
+   * make sure at least len bytes can be written at the tail, return where
+   * they start. after writing into it, call CommitWrite() with the bytes
+   * actually written. the pointer is invalid after any other write.
+   */
+  uint8_t *BeginWrite(size_t len);
+
+  void CommitWrite(size_t len);
+
   // ReadFrom
   // WriteTo
 
@@ -2,11 +2,13 @@
 #define __MODBUS_H_
 
 #include "bytes/buffer.h"
+#include "modbus/base/modbus_rtu_silence.h"
 #include "modbus/base/modbus_types.h"
 #include "modbus_data.h"
 #include <array>
 #include <cstddef>
 #include <functional>
+#include <memory>
 #include <mutex>
 
 namespace modbus {
@@ -66,7 +68,7 @@ public:
     serverAddress_ = serverAddress;
   }
   ServerAddress serverAddress() const { return serverAddress_; }
-  bool isBrocast() { return serverAddress_ == kBrocastAddress; }
+  bool isBrocast() const { return serverAddress_ == kBrocastAddress; }
 
   void setFunctionCode(FunctionCode functionCode) {
     functionCode_ = functionCode;
@@ -85,6 +87,7 @@ public:
   }
 
   const ByteArray &data() const { return data_; }
+  ByteArray *mutableData() { return &data_; }
 
   bool isException() const { return functionCode_ & kExceptionByte; }
 
@@ -144,7 +147,11 @@ using CheckSizeFuncTable = std::array<CheckSizeFunc, 256>;
 class ModbusFrameDecoder {
 public:
   explicit ModbusFrameDecoder(const CheckSizeFuncTable &table)
-      : checkSizeFuncTable_(table) {}
+      : ModbusFrameDecoder(std::make_shared<const CheckSizeFuncTable>(table)) {
+  }
+  /// the table is shared instead of copied, it is 8KB
+  explicit ModbusFrameDecoder(std::shared_ptr<const CheckSizeFuncTable> table)
+      : table_(std::move(table)), checkSizeFuncTable_(*table_) {}
 
   virtual ~ModbusFrameDecoder() = default;
 
@@ -152,9 +159,16 @@ public:
   virtual bool IsDone() const = 0;
   virtual void Clear() = 0;
   virtual Error LasError() const = 0;
+  /**
+   * the bytes read into buffer from offset had the silences of gaps on the
+   * line, see RtuSilence. only the rtu decoder frames by them
+   */
+  virtual void Silence(pp::bytes::Buffer & /*buffer*/, size_t /*offset*/,
+                       const RtuSilenceGaps & /*gaps*/) {}
 
 protected:
-  CheckSizeFuncTable checkSizeFuncTable_;
+  std::shared_ptr<const CheckSizeFuncTable> table_;
+  const CheckSizeFuncTable &checkSizeFuncTable_;
 };
 
 class ModbusFrameEncoder {
@@ -177,6 +191,12 @@ public:
   }
   Request(const Adu &adu) : Adu(adu) {}
   void setUserData(const any &userData) { userData_ = userData; }
+  /**
+   * reuse the user data already held by this request, see any::reuse()
+   */
+  template <typename ValueType> ValueType *reuseUserData() {
+    return userData_.reuse<ValueType>();
+  }
   any userData() const { return userData_; }
   const any &userData() { return userData_; }
 
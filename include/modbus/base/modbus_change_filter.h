@@ -0,0 +1,64 @@
+#ifndef __MODBUS_CHANGE_FILTER_H_
+#define __MODBUS_CHANGE_FILTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <modbus/base/modbus_register_schema.h>
+#include <modbus/base/modbus_types.h>
+#include <vector>
+
+namespace modbus {
+
+/**
+ * Remembers the registers of the last response of one poll, and tells which
+ * of them changed in the next response.
+ *
+ * Without a schema every changed register is reported. With a schema, a tag
+ * that has a deadband is only reported when its value moved out of the
+ * deadband around the value reported last time, otherwise its registers are
+ * treated as unchanged and the reported value stays the baseline.
+ */
+class ChangeFilter {
+public:
+  ChangeFilter() = default;
+  explicit ChangeFilter(const RegisterSchema &schema);
+
+  /**
+   * data is the register values of the response. changed is filled with the
+   * changed ranges, start is the register offset from the start address.
+   * the first response, and a response of another size, is a change of all
+   * registers. return true if anything changed
+   */
+  bool update(const uint8_t *data, size_t size,
+              std::vector<AddressRange> *changed);
+  bool update(const ByteArray &data, std::vector<AddressRange> *changed) {
+    return update(data.data(), data.size(), changed);
+  }
+
+  /// forget the last response, the next one is reported completely
+  void reset();
+
+  /**
+   * append the ranges of registers that differ between a and b to ranges,
+   * adjacent registers are merged into one range.
+   */
+  static void diffRegisters(const uint8_t *a, const uint8_t *b,
+                            size_t registers,
+                            std::vector<AddressRange> *ranges);
+
+private:
+  void applyDeadbands(size_t registers, std::vector<AddressRange> *changed);
+
+  RegisterSchema schema_;
+  bool hasSchema_ = false;
+  bool hasLast_ = false;
+  ByteArray last_;
+  RegisterValues values_;
+  std::vector<double> lastValues_;
+  /// per register, 0: unchanged/suppressed, 1: changed
+  std::vector<uint8_t> marks_;
+};
+
+} // namespace modbus
+
+#endif // __MODBUS_CHANGE_FILTER_H_
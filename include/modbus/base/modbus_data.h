@@ -35,13 +35,30 @@ public:
 
   bool empty() const { return !content; }
 
+  /**
+   * return the held ValueType, if there is no ValueType held, a default
+   * constructed one is stored first. reusing the held object keeps the
+   * capacity of its containers.
+   */
+  template <typename ValueType> ValueType *reuse() {
+    if (!content || content->type() != typeid(ValueType)) {
+      any(ValueType()).swap(*this);
+    }
+    return &static_cast<any::holder<ValueType> *>(content)->held;
+  }
+
   const std::type_info &type() const {
     return content ? content->type() : typeid(void);
   }
 
+  /// return nullptr if operand does not hold a ValueType
   template <typename ValueType>
   static inline ValueType *any_cast(any *operand) {
-    return &static_cast<any::holder<ValueType> *>(operand->content)->held;
+    if (!operand || operand->type() != typeid(ValueType)) {
+      return nullptr;
+    }
+    using nonconst = typename std::remove_cv<ValueType>::type;
+    return &static_cast<any::holder<nonconst> *>(operand->content)->held;
   }
 
   template <typename ValueType>
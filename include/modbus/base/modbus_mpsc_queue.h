@@ -0,0 +1,77 @@
+#ifndef __MODBUS_MPSC_QUEUE_H_
+#define __MODBUS_MPSC_QUEUE_H_
+
+#include <atomic>
+
+namespace modbus {
+
+/// the link of a node of MpscQueue, a node is in one queue at a time
+struct MpscNode {
+  std::atomic<MpscNode *> next{nullptr};
+};
+
+/**
+ * An intrusive lock-free queue, any thread pushes, one thread pops.
+ *
+ * push() is one atomic exchange, it never blocks or allocates, the nodes
+ * are owned by the caller. T derives from MpscNode.
+ *
+ * pop() returns null while a push() is halfway done, the node shows up once
+ * that push() returns. so the consumer is woken up by the producer after
+ * push()(an eventfd, a posted event), and pops until null then.
+ */
+template <typename T> class MpscQueue {
+public:
+  MpscQueue() : head_(&stub_), tail_(&stub_) {}
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  /// any thread
+  void push(T *node) { link(node); }
+
+  /// the consumer thread only, see the class comment
+  T *pop() {
+    MpscNode *tail = tail_;
+    MpscNode *next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return static_cast<T *>(tail);
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    /// tail is the last node, the stub goes behind it so it can be taken
+    link(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      tail_ = next;
+      return static_cast<T *>(tail);
+    }
+    return nullptr;
+  }
+
+private:
+  void link(MpscNode *node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    MpscNode *prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  MpscNode stub_;
+  /// the last node pushed
+  std::atomic<MpscNode *> head_;
+  /// the next node to pop, only touched by the consumer
+  MpscNode *tail_;
+};
+
+} // namespace modbus
+
+#endif // __MODBUS_MPSC_QUEUE_H_
@@ -0,0 +1,148 @@
+#ifndef __MODBUS_REGISTER_SCHEMA_H_
+#define __MODBUS_REGISTER_SCHEMA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <modbus/base/modbus_types.h>
+#include <string>
+#include <vector>
+
+namespace modbus {
+
+enum class TagType {
+  kUint16,
+  kInt16,
+  kUint32,
+  kInt32,
+  kFloat32,
+  kInt64,
+  kString
+};
+
+/// byte order inside one register, modbus itself is big endian
+enum class RegisterByteOrder { kBigEndian, kLittleEndian };
+
+/// register order of the values wider than one register
+enum class RegisterWordOrder { kHighWordFirst, kLowWordFirst };
+
+struct RegisterTag {
+  /// register offset from the start address of the read request
+  Quantity offset = 0;
+  TagType type = TagType::kUint16;
+  RegisterByteOrder byteOrder = RegisterByteOrder::kBigEndian;
+  RegisterWordOrder wordOrder = RegisterWordOrder::kHighWordFirst;
+  /**
+   * the tag is delivered as floats[slot] = raw * scale when scale is not 1,
+   * ignored by kString
+   */
+  float scale = 1;
+  /// only used by kString, two chars per register
+  Quantity stringRegisters = 0;
+  /**
+   * used by ChangeFilter, a change is reported only if the value moved more
+   * than deadband, or more than deadbandPercent of the last reported value.
+   * 0 means any change is reported
+   */
+  float deadband = 0;
+  float deadbandPercent = 0;
+};
+
+/**
+ * decoded values as struct of arrays, each tag goes to one column, in the
+ * order the tags were given:
+ * kFloat32 and scaled tags -> floats
+ * kUint16/kInt16/kInt32    -> int32s
+ * kUint32/kInt64           -> int64s
+ * kString                  -> strings
+ */
+struct RegisterValues {
+  std::vector<float> floats;
+  std::vector<int32_t> int32s;
+  std::vector<int64_t> int64s;
+  std::vector<std::string> strings;
+};
+
+/**
+ * A list of tags compiled into a decode plan.
+ *
+ * Adjacent tags with the same type, order and scale are merged into one run,
+ * a run is decoded in a single pass, the byte/word swaps are done 16 bytes at
+ * a time with SSE2 where available.
+ *
+ *   std::vector<RegisterTag> tags(120);
+ *   for (size_t i = 0; i < tags.size(); i++) {
+ *     tags[i].offset = i * 2;
+ *     tags[i].type = TagType::kFloat32;
+ *   }
+ *   RegisterSchema schema(tags);
+ *   RegisterValues values;
+ *   schema.decode(data, &values); // in readRegistersFinished
+ */
+class RegisterSchema {
+public:
+  RegisterSchema() = default;
+  explicit RegisterSchema(const std::vector<RegisterTag> &tags);
+
+  void compile(const std::vector<RegisterTag> &tags);
+
+  /**
+   * the number of registers the response must contain at least
+   */
+  Quantity registersRequired() const { return registersRequired_; }
+  size_t runCount() const { return runs_.size(); }
+
+  /**
+   * data is the register values in the response, as passed by
+   * readRegistersFinished. the columns of values are resized to the schema,
+   * so a values reused across polls is not reallocated.
+   * return false if data is shorter than registersRequired()
+   */
+  bool decode(const uint8_t *data, size_t size, RegisterValues *values) const;
+  bool decode(const ByteArray &data, RegisterValues *values) const {
+    return decode(data.data(), data.size(), values);
+  }
+
+  size_t tagCount() const { return tags_.size(); }
+  const RegisterTag &tag(size_t index) const { return tags_[index]; }
+  /**
+   * the value of tags index in decoded values as double, 0 for kString
+   */
+  double tagValue(size_t index, const RegisterValues &values) const;
+
+  static Quantity registerCount(const RegisterTag &tag);
+
+private:
+  enum class Column { kFloat, kInt32, kInt64, kString };
+
+  struct TagSlot {
+    Column column;
+    size_t slot;
+  };
+
+  struct Run {
+    size_t byteOffset;
+    size_t count;
+    TagType type;
+    bool swapBytes;
+    bool reverseWords;
+    float scale;
+    Column column;
+    size_t slot;
+    Quantity registers;
+  };
+
+  static Column columnOf(const RegisterTag &tag);
+
+  void decodeRun(const Run &run, const uint8_t *data,
+                 RegisterValues *values) const;
+
+  std::vector<RegisterTag> tags_;
+  std::vector<TagSlot> tagSlots_;
+  std::vector<Run> runs_;
+  Quantity registersRequired_ = 0;
+  size_t columnSize_[4] = {0, 0, 0, 0};
+};
+
+} // namespace modbus
+
+#endif // __MODBUS_REGISTER_SCHEMA_H_
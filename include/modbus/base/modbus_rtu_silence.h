@@ -0,0 +1,84 @@
+#ifndef __MODBUS_RTU_SILENCE_H_
+#define __MODBUS_RTU_SILENCE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace modbus {
+
+/// the silences found in the bytes of one read, as offsets into them
+struct RtuSilenceGaps {
+  static const size_t kNone = static_cast<size_t>(-1);
+
+  /// the bytes received
+  size_t size = 0;
+  /// the last silence longer than t3.5, the bytes before it end a frame
+  size_t interFrame = kNone;
+  /// the first silence longer than t1.5 after interFrame(or the start)
+  size_t interCharacter = kNone;
+
+  bool empty() const {
+    return interFrame == kNone && interCharacter == kNone;
+  }
+};
+
+/**
+ * Measures the silence on a rtu line from the times the bytes are read.
+ *
+ * The backend calls received() with a monotonic timestamp each time bytes
+ * arrive, the first of them is taken to start size character times before
+ * the timestamp. The gaps are collected until take(), so the backend may be
+ * read later, in one go.
+ *
+ * t1.5 and t3.5 are 1.5 and 3.5 character times of 11 bits, and fixed to
+ * 750us and 1750us above 19200 baud, as the serial line guide requires.
+ *
+ * The timestamps come from the event loop of the backend, a busy loop delays
+ * them and may show a silence that was not on the line. so the users of it
+ * enable it explicitly.
+ */
+class RtuSilence {
+public:
+  /// the monotonic clock in microseconds
+  static int64_t now();
+
+  explicit RtuSilence(int baudRate = 9600) { setBaudRate(baudRate); }
+
+  void setBaudRate(int baudRate);
+  /// microseconds
+  int64_t characterTime() const { return characterTime_; }
+  int64_t t1_5() const { return t1_5_; }
+  int64_t t3_5() const { return t3_5_; }
+
+  /// size bytes were written at timestamp, the line is busy sending them
+  void sent(int64_t timestamp, size_t size);
+  /// size bytes arrived at timestamp
+  void received(int64_t timestamp, size_t size);
+  /// the gaps in the bytes received since the last take()
+  RtuSilenceGaps take();
+  /// forget the line, the next bytes received have no silence before them
+  void reset();
+
+  /// the silence before the last bytes received, -1 if unknown
+  int64_t lastSilence() const { return lastSilence_; }
+  /**
+   * the silence from the end of the last request sent to the first byte of
+   * its response, -1 if unknown
+   */
+  int64_t turnaround() const { return turnaround_; }
+
+private:
+  int64_t characterTime_ = 0;
+  int64_t t1_5_ = 0;
+  int64_t t3_5_ = 0;
+  /// the time the line got silent, -1 if unknown
+  int64_t lineIdleAt_ = -1;
+  bool waitingResponse_ = false;
+  int64_t lastSilence_ = -1;
+  int64_t turnaround_ = -1;
+  RtuSilenceGaps gaps_;
+};
+
+} // namespace modbus
+
+#endif // __MODBUS_RTU_SILENCE_H_
@@ -0,0 +1,131 @@
+#ifndef __MODBUS_SHARED_REGISTERS_H_
+#define __MODBUS_SHARED_REGISTERS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <modbus/base/modbus_types.h>
+
+namespace modbus {
+
+/**
+ * A register table in a memory region shared between processes, usually a
+ * memory mapped file. The server serves reads straight from the region, and
+ * other processes write the registers in place.
+ *
+ * Layout, the header fields are in host byte order:
+ *
+ *   offset            size               field
+ *   0                 4                  magic "MBSR"(kMagic)
+ *   4                 2                  version(kVersion)
+ *   6                 2                  registers per block(kBlockRegisters)
+ *   8                 2                  start address
+ *   10                2                  reserved, 0
+ *   12                4                  quantity of registers
+ *   16                4                  block count
+ *   20                44                 reserved, 0
+ *   64                4 * block count    sequence counter of each block
+ *   dataOffset()      2 * quantity       register values, big endian, as on
+ *                                        the wire
+ *
+ * dataOffset() is 64 + 4 * block count rounded up to 64.
+ *
+ * Each block of kBlockRegisters registers is guarded by its sequence counter
+ * as a seqlock: a writer makes the counter odd(only if it was even) before it
+ * touches the block and bumps it back to even when done. A reader copies the
+ * registers and retries if a counter of the blocks it read was odd or moved
+ * meanwhile, so every read sees a consistent snapshot of the range, also
+ * across blocks. A process that dies in the middle of a write leaves the
+ * block locked, read() and write() give up on a block that stays locked
+ * for a few thousand tries(a few milliseconds) and return false.
+ *
+ *   // producer process, file created by QModbusServer::mapRegisters
+ *   QFile file("/dev/shm/holding.regs");
+ *   file.open(QIODevice::ReadWrite);
+ *   SharedRegisters regs;
+ *   regs.attach(file.map(0, file.size()), file.size());
+ *   regs.setValue(0x10, 230);
+ */
+class SharedRegisters {
+public:
+  static const uint32_t kMagic = 0x5253424D;
+  static const uint16_t kVersion = 1;
+  static const Quantity kBlockRegisters = 64;
+  static const size_t kHeaderSize = 64;
+
+  /// the size of the region holding quantity registers
+  static size_t requiredSize(uint32_t quantity);
+
+  /**
+   * write an empty table of the layout to memory, the registers are all 0.
+   * return false if size is smaller than requiredSize(quantity)
+   */
+  bool format(uint8_t *memory, size_t size, Address startAddress,
+              uint32_t quantity);
+  /**
+   * use a region formatted by format(), in this process or another one.
+   * return false if the header is not valid
+   */
+  bool attach(uint8_t *memory, size_t size);
+  void detach() { memory_ = nullptr; }
+  bool isAttached() const { return memory_ != nullptr; }
+
+  Address startAddress() const { return startAddress_; }
+  uint32_t quantity() const { return quantity_; }
+  bool contains(Address address, Quantity quantity) const;
+
+  /**
+   * copy quantity registers from address to out(2 * quantity bytes, big
+   * endian). return false if the range is out of the table, or a block of
+   * it stays locked
+   */
+  bool read(Address address, Quantity quantity, uint8_t *out) const;
+  /**
+   * values is 2 * quantity bytes, big endian. if previous is not null, the
+   * values replaced are copied to it while the blocks are locked, so no
+   * other writer comes in between. false as read()
+   */
+  bool write(Address address, const uint8_t *values, Quantity quantity,
+             uint8_t *previous = nullptr);
+  /**
+   * the mask write of function code 0x16, the register becomes
+   * (current & andMask) | (orMask & ~andMask) in one locked write, a value
+   * written by another process is never lost. previous gets the value it
+   * replaced. false as read()
+   */
+  bool maskWrite(Address address, uint16_t andMask, uint16_t orMask,
+                 uint16_t *previous = nullptr);
+
+  uint16_t value(Address address) const;
+  bool setValue(Address address, uint16_t value);
+
+  uint32_t blockCount() const { return blockCount_; }
+  /**
+   * the sequence counter of a block, it moves with every write to the
+   * block, by any process. a reader that keeps it finds the blocks written
+   * since
+   */
+  uint32_t blockSequence(size_t block) const;
+
+private:
+  using Sequence = std::atomic<uint32_t>;
+
+  Sequence *sequence(size_t block) const;
+  uint8_t *data() const { return memory_ + dataOffset_; }
+  size_t firstBlock(Address address) const;
+  size_t lastBlock(Address address, Quantity quantity) const;
+  /// make the counters of the blocks odd, false if one stays locked
+  bool lock(size_t first, size_t last);
+  /// bump the counters back to even, past the write if written
+  void unlock(size_t first, size_t last, bool written);
+
+  uint8_t *memory_ = nullptr;
+  Address startAddress_ = 0;
+  uint32_t quantity_ = 0;
+  uint32_t blockCount_ = 0;
+  size_t dataOffset_ = 0;
+};
+
+} // namespace modbus
+
+#endif // __MODBUS_SHARED_REGISTERS_H_
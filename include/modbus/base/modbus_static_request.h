@@ -0,0 +1,336 @@
+#ifndef __MODBUS_STATIC_REQUEST_H_
+#define __MODBUS_STATIC_REQUEST_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <modbus/base/modbus_types.h>
+
+/**
+ * Requests whose server address, function code, address and quantity are
+ * known at compile time.
+ *
+ * The pdu and the whole rtu frame(crc included) are constexpr arrays, and
+ * each request has a response view whose expected sizes are constants, so
+ * checking a response is a few comparisons instead of the CheckSizeFunc
+ * table. Only depends on modbus_types.h, no Qt.
+ *
+ *   using Poll = ReadHolding<0x01, 0x0000, 10>;
+ *   port.write(Poll::kRtuFrame, Poll::kRtuFrameSize);
+ *   ...
+ *   Poll::Response response;
+ *   if (response.fromRtuFrame(buffer, size) && !response.isException()) {
+ *     uint16_t first = response.value<0>();
+ *   }
+ */
+
+namespace modbus {
+namespace internal {
+
+constexpr uint16_t crc16Bits(uint16_t crc, int bits) {
+  return bits == 0 ? crc
+                   : crc16Bits((crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1,
+                               bits - 1);
+}
+
+constexpr uint16_t crc16Byte(uint16_t crc, uint8_t byte) {
+  return crc16Bits(crc ^ byte, 8);
+}
+
+constexpr uint16_t crc16Of(uint16_t crc) { return crc; }
+
+template <typename... Bytes>
+constexpr uint16_t crc16Of(uint16_t crc, uint8_t byte, Bytes... rest) {
+  return crc16Of(crc16Byte(crc, byte), rest...);
+}
+
+/// modbus crc16 of the arguments, evaluated at compile time
+template <typename... Bytes> constexpr uint16_t crc16(Bytes... bytes) {
+  return crc16Of(0xFFFF, static_cast<uint8_t>(bytes)...);
+}
+
+/// the same crc at runtime, for checking the response
+inline uint16_t crc16Of(const uint8_t *data, size_t size) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < size; i++) {
+    crc = crc16Byte(crc, data[i]);
+  }
+  return crc;
+}
+
+constexpr uint8_t hi(uint16_t value) { return value >> 8; }
+constexpr uint8_t lo(uint16_t value) { return value & 0xFF; }
+
+inline bool checkRtuCrc(const uint8_t *frame, size_t size) {
+  const uint16_t crc = crc16Of(frame, size - 2);
+  return frame[size - 2] == lo(crc) && frame[size - 1] == hi(crc);
+}
+
+/**
+ * the part of the response views shared by all function codes. ExpectedPdu
+ * is the pdu size of a normal response, an exception response is always
+ * function code + exception code.
+ */
+template <ServerAddress Unit, FunctionCode Code, size_t ExpectedPdu>
+class StaticResponseBase {
+public:
+  static constexpr size_t kPduSize = ExpectedPdu;
+  static constexpr size_t kRtuFrameSize = 1 + kPduSize + 2;
+  static constexpr size_t kExceptionPduSize = 2;
+  static constexpr size_t kExceptionRtuFrameSize = 1 + kExceptionPduSize + 2;
+
+  /**
+   * pdu points into the caller's buffer, it is not copied, so the view is
+   * valid as long as the buffer is.
+   */
+  bool fromPdu(const uint8_t *pdu, size_t size) {
+    pdu_ = nullptr;
+    if (size == kExceptionPduSize && pdu[0] == (Code | 0x80)) {
+      pdu_ = pdu;
+      return true;
+    }
+    if (size != kPduSize || pdu[0] != Code) {
+      return false;
+    }
+    pdu_ = pdu;
+    return true;
+  }
+
+  bool fromRtuFrame(const uint8_t *frame, size_t size) {
+    pdu_ = nullptr;
+    if (size != kRtuFrameSize && size != kExceptionRtuFrameSize) {
+      return false;
+    }
+    if (frame[0] != Unit || !checkRtuCrc(frame, size)) {
+      return false;
+    }
+    return fromPdu(frame + 1, size - 3);
+  }
+
+  bool isValid() const { return pdu_ != nullptr; }
+  bool isException() const { return pdu_ && (pdu_[0] & 0x80); }
+  Error error() const {
+    return isException() ? Error(pdu_[1]) : Error::kNoError;
+  }
+
+protected:
+  const uint8_t *pdu_ = nullptr;
+};
+
+template <ServerAddress Unit, FunctionCode Code, size_t ExpectedPdu>
+constexpr size_t StaticResponseBase<Unit, Code, ExpectedPdu>::kPduSize;
+template <ServerAddress Unit, FunctionCode Code, size_t ExpectedPdu>
+constexpr size_t StaticResponseBase<Unit, Code, ExpectedPdu>::kRtuFrameSize;
+template <ServerAddress Unit, FunctionCode Code, size_t ExpectedPdu>
+constexpr size_t StaticResponseBase<Unit, Code, ExpectedPdu>::kExceptionPduSize;
+template <ServerAddress Unit, FunctionCode Code, size_t ExpectedPdu>
+constexpr size_t
+    StaticResponseBase<Unit, Code, ExpectedPdu>::kExceptionRtuFrameSize;
+
+} // namespace internal
+
+/**
+ * a request with a 4 bytes payload, first/second are two 16 bit fields,
+ * that is address + quantity for the read requests and address + value for
+ * the single write requests.
+ */
+template <ServerAddress Unit, FunctionCode Code, uint16_t First,
+          uint16_t Second>
+struct StaticRequest {
+  static constexpr ServerAddress kServerAddress = Unit;
+  static constexpr FunctionCode kFunctionCode = Code;
+
+  static constexpr size_t kPduSize = 5;
+  static constexpr uint8_t kPdu[kPduSize] = {
+      Code, internal::hi(First), internal::lo(First), internal::hi(Second),
+      internal::lo(Second)};
+
+  static constexpr uint16_t kCrc =
+      internal::crc16(Unit, Code, internal::hi(First), internal::lo(First),
+                      internal::hi(Second), internal::lo(Second));
+
+  static constexpr size_t kRtuFrameSize = 1 + kPduSize + 2;
+  static constexpr uint8_t kRtuFrame[kRtuFrameSize] = {
+      Unit,
+      Code,
+      internal::hi(First),
+      internal::lo(First),
+      internal::hi(Second),
+      internal::lo(Second),
+      internal::lo(kCrc),
+      internal::hi(kCrc)};
+};
+
+template <ServerAddress Unit, FunctionCode Code, uint16_t First,
+          uint16_t Second>
+constexpr ServerAddress
+    StaticRequest<Unit, Code, First, Second>::kServerAddress;
+template <ServerAddress Unit, FunctionCode Code, uint16_t First,
+          uint16_t Second>
+constexpr FunctionCode StaticRequest<Unit, Code, First, Second>::kFunctionCode;
+template <ServerAddress Unit, FunctionCode Code, uint16_t First,
+          uint16_t Second>
+constexpr size_t StaticRequest<Unit, Code, First, Second>::kPduSize;
+template <ServerAddress Unit, FunctionCode Code, uint16_t First,
+          uint16_t Second>
+constexpr uint8_t StaticRequest<Unit, Code, First, Second>::kPdu[];
+template <ServerAddress Unit, FunctionCode Code, uint16_t First,
+          uint16_t Second>
+constexpr uint16_t StaticRequest<Unit, Code, First, Second>::kCrc;
+template <ServerAddress Unit, FunctionCode Code, uint16_t First,
+          uint16_t Second>
+constexpr size_t StaticRequest<Unit, Code, First, Second>::kRtuFrameSize;
+template <ServerAddress Unit, FunctionCode Code, uint16_t First,
+          uint16_t Second>
+constexpr uint8_t StaticRequest<Unit, Code, First, Second>::kRtuFrame[];
+
+/**
+ * function code 0x03/0x04
+ * response: function code + byte count + Count * 2 bytes
+ */
+template <ServerAddress Unit, FunctionCode Code, Address Start, Quantity Count>
+struct StaticReadRegisters : StaticRequest<Unit, Code, Start, Count> {
+  static_assert(Code == FunctionCode::kReadHoldingRegisters ||
+                    Code == FunctionCode::kReadInputRegister,
+                "function code must be 0x03 or 0x04");
+  static_assert(Count >= 1 && Count <= 125,
+                "quantity of registers must be in [1, 125]");
+  static_assert(Start + Count - 1 <= 0xFFFF, "address out of range");
+
+  static constexpr Address kStartAddress = Start;
+  static constexpr Quantity kQuantity = Count;
+
+  class Response
+      : public internal::StaticResponseBase<Unit, Code, 2 + Count * 2> {
+  public:
+    bool fromPdu(const uint8_t *pdu, size_t size) {
+      return Response::StaticResponseBase::fromPdu(pdu, size) &&
+             (this->isException() || this->pdu_[1] == Count * 2);
+    }
+
+    bool fromRtuFrame(const uint8_t *frame, size_t size) {
+      return Response::StaticResponseBase::fromRtuFrame(frame, size) &&
+             (this->isException() || this->pdu_[1] == Count * 2);
+    }
+
+    /// the value of register Start + index
+    uint16_t value(size_t index) const {
+      return this->pdu_[2 + index * 2] * 256 + this->pdu_[3 + index * 2];
+    }
+
+    template <size_t Index> uint16_t value() const {
+      static_assert(Index < Count, "register index out of range");
+      return value(Index);
+    }
+  };
+};
+
+template <ServerAddress Unit, FunctionCode Code, Address Start, Quantity Count>
+constexpr Address StaticReadRegisters<Unit, Code, Start, Count>::kStartAddress;
+template <ServerAddress Unit, FunctionCode Code, Address Start, Quantity Count>
+constexpr Quantity StaticReadRegisters<Unit, Code, Start, Count>::kQuantity;
+
+/**
+ * function code 0x01/0x02
+ * response: function code + byte count + (Count + 7) / 8 bytes
+ */
+template <ServerAddress Unit, FunctionCode Code, Address Start, Quantity Count>
+struct StaticReadBits : StaticRequest<Unit, Code, Start, Count> {
+  static_assert(Code == FunctionCode::kReadCoils ||
+                    Code == FunctionCode::kReadInputDiscrete,
+                "function code must be 0x01 or 0x02");
+  static_assert(Count >= 1 && Count <= 2000,
+                "quantity of bits must be in [1, 2000]");
+  static_assert(Start + Count - 1 <= 0xFFFF, "address out of range");
+
+  static constexpr Address kStartAddress = Start;
+  static constexpr Quantity kQuantity = Count;
+  static constexpr size_t kBytes = (Count + 7) / 8;
+
+  class Response : public internal::StaticResponseBase<Unit, Code, 2 + kBytes> {
+  public:
+    bool fromPdu(const uint8_t *pdu, size_t size) {
+      return Response::StaticResponseBase::fromPdu(pdu, size) &&
+             (this->isException() || this->pdu_[1] == kBytes);
+    }
+
+    bool fromRtuFrame(const uint8_t *frame, size_t size) {
+      return Response::StaticResponseBase::fromRtuFrame(frame, size) &&
+             (this->isException() || this->pdu_[1] == kBytes);
+    }
+
+    /// the value of bit Start + index
+    bool value(size_t index) const {
+      return (this->pdu_[2 + index / 8] >> (index % 8)) & 0x01;
+    }
+
+    template <size_t Index> bool value() const {
+      static_assert(Index < Count, "bit index out of range");
+      return value(Index);
+    }
+  };
+};
+
+template <ServerAddress Unit, FunctionCode Code, Address Start, Quantity Count>
+constexpr Address StaticReadBits<Unit, Code, Start, Count>::kStartAddress;
+template <ServerAddress Unit, FunctionCode Code, Address Start, Quantity Count>
+constexpr Quantity StaticReadBits<Unit, Code, Start, Count>::kQuantity;
+template <ServerAddress Unit, FunctionCode Code, Address Start, Quantity Count>
+constexpr size_t StaticReadBits<Unit, Code, Start, Count>::kBytes;
+
+/**
+ * function code 0x05/0x06, the response is an echo of the request
+ */
+template <ServerAddress Unit, FunctionCode Code, Address Addr, uint16_t Value>
+struct StaticWriteSingle : StaticRequest<Unit, Code, Addr, Value> {
+  static_assert(Code == FunctionCode::kWriteSingleCoil ||
+                    Code == FunctionCode::kWriteSingleRegister,
+                "function code must be 0x05 or 0x06");
+  static_assert(Code != FunctionCode::kWriteSingleCoil || Value == 0xFF00 ||
+                    Value == 0x0000,
+                "coil value must be 0xff00 or 0x0000");
+
+  class Response : public internal::StaticResponseBase<Unit, Code, 5> {
+  public:
+    bool fromPdu(const uint8_t *pdu, size_t size) {
+      return Response::StaticResponseBase::fromPdu(pdu, size) &&
+             (this->isException() || isEcho());
+    }
+
+    bool fromRtuFrame(const uint8_t *frame, size_t size) {
+      return Response::StaticResponseBase::fromRtuFrame(frame, size) &&
+             (this->isException() || isEcho());
+    }
+
+  private:
+    bool isEcho() const {
+      return this->pdu_[1] == internal::hi(Addr) &&
+             this->pdu_[2] == internal::lo(Addr) &&
+             this->pdu_[3] == internal::hi(Value) &&
+             this->pdu_[4] == internal::lo(Value);
+    }
+  };
+};
+
+template <ServerAddress Unit, Address Start, Quantity Count>
+using ReadCoils =
+    StaticReadBits<Unit, FunctionCode::kReadCoils, Start, Count>;
+template <ServerAddress Unit, Address Start, Quantity Count>
+using ReadDiscreteInputs =
+    StaticReadBits<Unit, FunctionCode::kReadInputDiscrete, Start, Count>;
+template <ServerAddress Unit, Address Start, Quantity Count>
+using ReadHolding =
+    StaticReadRegisters<Unit, FunctionCode::kReadHoldingRegisters, Start,
+                        Count>;
+template <ServerAddress Unit, Address Start, Quantity Count>
+using ReadInput =
+    StaticReadRegisters<Unit, FunctionCode::kReadInputRegister, Start, Count>;
+template <ServerAddress Unit, Address Addr, bool Value>
+using WriteCoil = StaticWriteSingle<Unit, FunctionCode::kWriteSingleCoil, Addr,
+                                    Value ? 0xFF00 : 0x0000>;
+template <ServerAddress Unit, Address Addr, uint16_t Value>
+using WriteRegister =
+    StaticWriteSingle<Unit, FunctionCode::kWriteSingleRegister, Addr, Value>;
+
+} // namespace modbus
+
+#endif // __MODBUS_STATIC_REQUEST_H_
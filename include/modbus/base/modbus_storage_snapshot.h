@@ -0,0 +1,86 @@
+#ifndef __MODBUS_STORAGE_SNAPSHOT_H_
+#define __MODBUS_STORAGE_SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <modbus/base/modbus_types.h>
+
+namespace modbus {
+
+/// the address space of one table in a snapshot, quantity 0 if not handled
+struct SnapshotTable {
+  Address startAddress = 0;
+  uint32_t quantity = 0;
+
+  bool operator==(const SnapshotTable &other) const {
+    return startAddress == other.startAddress && quantity == other.quantity;
+  }
+  bool operator!=(const SnapshotTable &other) const {
+    return !(*this == other);
+  }
+};
+
+/**
+ * The snapshot of the four server tables in a memory region, usually a memory
+ * mapped file, so the tables are restored with a few copies at startup and
+ * only the pages touched since the last save are written back.
+ *
+ * Layout, the header fields are in host byte order:
+ *
+ *   offset  size     field
+ *   0       4        magic "MBSN"(kMagic)
+ *   4       2        version(kVersion)
+ *   6       2        table count, 4
+ *   8       8        reserved, 0
+ *   16      16 * 4   a descriptor per table, in the order of StorageKind
+ *                    0   2   start address
+ *                    2   2   reserved, 0
+ *                    4   4   quantity, 0 if the table is not handled
+ *                    8   4   offset of the table data
+ *                    12  4   size of the table data
+ *   kPageSize        the data of the tables, each table starts on a page
+ *                    coils/discrete inputs: bits packed lsb first, as on
+ *                    the wire
+ *                    holding/input registers: 2 bytes per register, big
+ *                    endian
+ */
+class StorageSnapshot {
+public:
+  static const uint32_t kMagic = 0x4E53424D;
+  static const uint16_t kVersion = 1;
+  static const int kTableCount = 4;
+  static const size_t kPageSize = 4096;
+
+  /// the bytes a table of quantity values takes
+  static size_t dataSize(StorageKind kind, uint32_t quantity);
+  /// the values of a table in one page, 2048 registers or 32768 bits
+  static uint32_t valuesPerPage(StorageKind kind);
+  static size_t requiredSize(const SnapshotTable (&tables)[kTableCount]);
+
+  /**
+   * write an empty snapshot(all values 0) of the tables to memory.
+   * return false if size is smaller than requiredSize(tables)
+   */
+  bool format(uint8_t *memory, size_t size,
+              const SnapshotTable (&tables)[kTableCount]);
+  /// use a region written by format(), return false if it is not valid
+  bool attach(uint8_t *memory, size_t size);
+  void detach() { memory_ = nullptr; }
+  bool isAttached() const { return memory_ != nullptr; }
+
+  const SnapshotTable &table(StorageKind kind) const {
+    return tables_[static_cast<int>(kind)];
+  }
+  uint8_t *data(StorageKind kind) const {
+    return memory_ + offsets_[static_cast<int>(kind)];
+  }
+
+private:
+  uint8_t *memory_ = nullptr;
+  SnapshotTable tables_[kTableCount];
+  size_t offsets_[kTableCount] = {0, 0, 0, 0};
+};
+
+} // namespace modbus
+
+#endif // __MODBUS_STORAGE_SNAPSHOT_H_
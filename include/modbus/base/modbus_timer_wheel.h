@@ -0,0 +1,123 @@
+#ifndef __MODBUS_TIMER_WHEEL_H_
+#define __MODBUS_TIMER_WHEEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace modbus {
+
+/**
+ * A hierarchical timer wheel, many timers on one tick source.
+ *
+ * 4 levels of 64 slots, a level covers 64 times the span of the one below:
+ * with a tick of 1ms the levels reach 64ms, 4s, 4.4min and 4.7h, a timer
+ * further away waits in the last level and is put back there until it is
+ * due. A timer is in the slot of its expiry on the lowest level that covers
+ * it, and moves down a level each time the level below wraps around.
+ *
+ * schedule() and cancel() are O(1), they link and unlink the intrusive
+ * timer, so a timer cancelled never fires, even in the tick that would have
+ * fired it. advance() fires the timers due in the order of the ticks, the
+ * callbacks may schedule and cancel any timer.
+ *
+ * The owner of the wheel calls advance() from one tick source, at
+ * nextExpiry() or periodically. All the calls are made on one thread.
+ * Times are microseconds of clock, the steady clock by default.
+ */
+class TimerWheel {
+public:
+  /// the link of a timer in a slot
+  struct Link {
+    Link *prev = nullptr;
+    Link *next = nullptr;
+  };
+
+  /**
+   * a timer of one wheel, owned by the user. it is cancelled when it is
+   * destroyed, it must not outlive the wheel while scheduled
+   */
+  class Timer : private Link {
+  public:
+    Timer() = default;
+    explicit Timer(const std::function<void()> &callback)
+        : callback_(callback) {}
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+    ~Timer() { cancel(); }
+
+    void setCallback(const std::function<void()> &callback) {
+      callback_ = callback;
+    }
+    bool isActive() const { return wheel_ != nullptr; }
+    void cancel();
+
+  private:
+    friend class TimerWheel;
+    TimerWheel *wheel_ = nullptr;
+    /// the tick it fires at
+    int64_t expiry_ = 0;
+    uint8_t level_ = 0;
+    uint8_t slot_ = 0;
+    std::function<void()> callback_;
+  };
+
+  static const int kLevels = 4;
+  static const int kSlotBits = 6;
+  static const int kSlots = 1 << kSlotBits;
+
+  /// the steady clock in microseconds
+  static int64_t steadyNow();
+
+  explicit TimerWheel(int64_t tick = 1000,
+                      const std::function<int64_t()> &clock = steadyNow);
+  TimerWheel(const TimerWheel &) = delete;
+  TimerWheel &operator=(const TimerWheel &) = delete;
+  /// the timers still scheduled are cancelled
+  ~TimerWheel();
+
+  /**
+   * fire timer delay microseconds from now, rounded up to the next tick. a
+   * scheduled timer is rescheduled
+   */
+  void schedule(Timer *timer, int64_t delay);
+  void cancel(Timer *timer);
+
+  /// fire the timers due by now, return how many fired
+  size_t advance();
+  /**
+   * the time advance() is due next, -1 if no timer is scheduled. it is the
+   * next expiry, or earlier if the timer has to move down a level first
+   */
+  int64_t nextExpiry() const;
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  int64_t tick() const { return tick_; }
+
+private:
+  void insert(Timer *timer);
+  void unlink(Timer *timer);
+  /**
+   * move the timers of a slot to the level below, or fire them if it is on
+   * level 0. return how many fired
+   */
+  size_t cascade(int level, int slot);
+  /// process the tick current_
+  size_t step();
+
+  int64_t tick_;
+  std::function<int64_t()> clock_;
+  /// the time of tick 0
+  int64_t origin_;
+  /// the ticks processed
+  int64_t current_ = 0;
+  size_t size_ = 0;
+  Link slots_[kLevels][kSlots];
+  /// a bit per non-empty slot
+  uint64_t occupied_[kLevels] = {};
+};
+
+} // namespace modbus
+
+#endif // __MODBUS_TIMER_WHEEL_H_
@@ -6,9 +6,9 @@
 #include <map>
 
 namespace modbus {
+/// incremental modbus crc16, in is the reflected crc register
 struct CrcCtx {
   uint16_t in = 0xFFFF;
-  uint16_t poly = 0x8005;
 
   void clear();
   void crc16(const uint8_t *data, size_t size);
@@ -17,6 +17,28 @@ using RegisterAddress = uint16_t;
 using Address = uint16_t;
 using Quantity = uint16_t;
 
+/// [start, start + quantity)
+struct AddressRange {
+  AddressRange() = default;
+  AddressRange(Address start, Quantity quantity)
+      : start(start), quantity(quantity) {}
+
+  Address start = 0;
+  Quantity quantity = 0;
+
+  bool operator==(const AddressRange &other) const {
+    return start == other.start && quantity == other.quantity;
+  }
+};
+
+/// the tables of a server
+enum class StorageKind {
+  kCoils,
+  kInputDiscrete,
+  kHoldingRegisters,
+  kInputRegisters
+};
+
 struct SixteenBitValue {
   enum class ByteOrder { kNetworkByteOrder, kHostByteOrder };
 
@@ -37,12 +37,22 @@ public:
    * function code 0x01,0x02
    */
   ByteArray marshalReadRequest() const { return marshalAddressQuantity(); }
+  void marshalReadRequest(ByteArray *data) const {
+    marshalAddressQuantity(data);
+  }
 
   ByteArray marshalAddressQuantity() const {
-    return ByteArray({static_cast<uint8_t>(startAddress_ / 256),
-                      static_cast<uint8_t>(startAddress_ % 256),
-                      static_cast<uint8_t>(quantity_ / 256),
-                      static_cast<uint8_t>(quantity_ % 256)});
+    ByteArray data;
+    marshalAddressQuantity(&data);
+    return data;
+  }
+
+  void marshalAddressQuantity(ByteArray *data) const {
+    data->clear();
+    data->push_back(startAddress_ / 256);
+    data->push_back(startAddress_ % 256);
+    data->push_back(quantity_ / 256);
+    data->push_back(quantity_ % 256);
   }
 
   bool unmarshalReadRequest(const ByteArray &data) {
@@ -63,19 +73,22 @@ public:
    */
   ByteArray marshalSingleWriteRequest() const {
     ByteArray data;
+    marshalSingleWriteRequest(&data);
+    return data;
+  }
 
-    data.reserve(4);
+  void marshalSingleWriteRequest(ByteArray *data) const {
+    data->clear();
+    data->reserve(4);
 
     auto it = valueMap_.find(startAddress_);
     smart_assert(it != valueMap_.end() && "has no value set")(startAddress_);
 
-    data.push_back(startAddress_ / 256);
-    data.push_back(startAddress_ % 256);
-
-    data.push_back(it->second ? 0xff : 0x00);
-    data.push_back(0x00);
+    data->push_back(startAddress_ / 256);
+    data->push_back(startAddress_ % 256);
 
-    return data;
+    data->push_back(it->second ? 0xff : 0x00);
+    data->push_back(0x00);
   }
 
   /**
@@ -84,7 +97,14 @@ public:
    */
   ByteArray marshalMultipleWriteRequest() {
     ByteArray data;
+    marshalMultipleWriteRequest(&data);
+    return data;
+  }
+
+  void marshalMultipleWriteRequest(ByteArray *array) {
+    ByteArray &data = *array;
 
+    data.clear();
     data.reserve(48);
 
     data.push_back(startAddress_ / 256);
@@ -115,8 +135,6 @@ public:
     if (quantity_ % 8 != 0) {
       data.push_back(byte);
     }
-
-    return data;
   }
 
   ByteArray marshalReadResponse() {
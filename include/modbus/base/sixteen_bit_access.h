@@ -41,6 +41,12 @@ public:
   }
 
   ByteArray value() const { return value_array_; }
+  /// the values as on the wire, two bytes(big endian) per register
+  const ByteArray &valueArray() const { return value_array_; }
+  /// copy quantity() values in the form of valueArray() at once
+  void setValueArray(const uint8_t *values) {
+    value_array_.assign(values, values + value_array_.size());
+  }
 
   SixteenBitValue value(Address address, bool *ok = nullptr) const {
     Address start_address = startAddress();
@@ -64,10 +70,17 @@ public:
   }
 
   ByteArray marshalMultipleReadRequest() const {
-    return ByteArray({static_cast<uint8_t>(startAddress_ / 256),
-                      static_cast<uint8_t>(startAddress_ % 256),
-                      static_cast<uint8_t>(quantity() / 256),
-                      static_cast<uint8_t>(quantity() % 256)});
+    ByteArray array;
+    marshalMultipleReadRequest(&array);
+    return array;
+  }
+
+  void marshalMultipleReadRequest(ByteArray *array) const {
+    array->clear();
+    array->push_back(startAddress_ / 256);
+    array->push_back(startAddress_ % 256);
+    array->push_back(quantity() / 256);
+    array->push_back(quantity() % 256);
   }
 
   bool unmarshalAddressQuantity(const ByteArray &data) {
@@ -81,6 +94,41 @@ public:
     return true;
   }
 
+  /**
+   * function code 0x16, the register at startAddress is set to
+   * (current & andMask) | (orMask & ~andMask)
+   */
+  void marshalMaskWriteRequest(uint16_t andMask, uint16_t orMask,
+                               ByteArray *array) const {
+    array->clear();
+    array->reserve(6);
+    array->push_back(startAddress_ / 256);
+    array->push_back(startAddress_ % 256);
+    array->push_back(andMask / 256);
+    array->push_back(andMask % 256);
+    array->push_back(orMask / 256);
+    array->push_back(orMask % 256);
+  }
+
+  bool unmarshalMaskWriteRequest(const ByteArray &data, uint16_t *andMask,
+                                 uint16_t *orMask) {
+    size_t size;
+    auto result = bytesRequired<6>(size, data.data(), data.size());
+    if (result != CheckSizeResult::kSizeOk) {
+      return false;
+    }
+    startAddress_ = data[0] * 256 + data[1];
+    setQuantity(1);
+    *andMask = data[2] * 256 + data[3];
+    *orMask = data[4] * 256 + data[5];
+    return true;
+  }
+
+  static uint16_t maskWrite(uint16_t current, uint16_t andMask,
+                            uint16_t orMask) {
+    return (current & andMask) | (orMask & ~andMask);
+  }
+
   bool unmarshalSingleWriteRequest(const ByteArray &data) {
     size_t size;
     auto result = bytesRequired<4>(size, data.data(), data.size());
@@ -116,32 +164,40 @@ public:
 
   ByteArray marshalSingleWriteRequest() const {
     ByteArray array;
+    marshalSingleWriteRequest(&array);
+    return array;
+  }
 
-    array.reserve(4);
-
-    array.push_back(startAddress_ / 256);
-    array.push_back(startAddress_ % 256);
+  void marshalSingleWriteRequest(ByteArray *array) const {
+    array->clear();
+    array->reserve(4);
 
-    array.push_back(value_array_[0]);
-    array.push_back(value_array_[1]);
+    array->push_back(startAddress_ / 256);
+    array->push_back(startAddress_ % 256);
 
-    return array;
+    array->push_back(value_array_[0]);
+    array->push_back(value_array_[1]);
   }
 
   ByteArray marshalMultipleWriteRequest() const {
     ByteArray array;
-    array.reserve(5 + value_array_.size());
+    marshalMultipleWriteRequest(&array);
+    return array;
+  }
 
-    array.push_back(startAddress_ / 256);
-    array.push_back(startAddress_ % 256);
+  void marshalMultipleWriteRequest(ByteArray *array) const {
+    array->clear();
+    array->reserve(5 + value_array_.size());
 
-    array.push_back(quantity() / 256);
-    array.push_back(quantity() % 256);
+    array->push_back(startAddress_ / 256);
+    array->push_back(startAddress_ % 256);
 
-    array.push_back(quantity() * 2);
+    array->push_back(quantity() / 256);
+    array->push_back(quantity() % 256);
 
-    array.insert(array.end(), value_array_.begin(), value_array_.end());
-    return array;
+    array->push_back(quantity() * 2);
+
+    array->insert(array->end(), value_array_.begin(), value_array_.end());
   }
 
   ByteArray marshalMultipleReadResponse() {
@@ -153,6 +209,33 @@ public:
     return array;
   }
 
+  /**
+   * encode the response of a read of quantity registers from address straight
+   * from the values of this access, into the response buffer. the range must
+   * be validated by the caller
+   */
+  void marshalMultipleReadResponse(Address address, Quantity quantity,
+                                   ByteArray *array) const {
+    const size_t offset = (address - startAddress_) * 2;
+    const auto first = value_array_.begin() + offset;
+    array->clear();
+    array->reserve(1 + quantity * 2);
+    array->push_back(quantity * 2);
+    array->insert(array->end(), first, first + quantity * 2);
+  }
+
+  /**
+   * function code 0x17, the read part goes to this access, the write part
+   * (address, quantity and values) to writeAccess
+   */
+  bool unmarshalReadWriteRequest(const ByteArray &data,
+                                 SixteenBitAccess *writeAccess) {
+    if (!unmarshalAddressQuantity(data)) {
+      return false;
+    }
+    return writeAccess->unmarshalMulitpleWriteRequest(tool::subArray(data, 4));
+  }
+
   bool unmarshalReadResponse(const ByteArray &data) {
     size_t size = 0;
     auto result =
@@ -9,6 +9,7 @@
 #include <QtNetwork/QAbstractSocket>
 #include <QtSerialPort/QSerialPort>
 #include <memory>
+#include <modbus/base/modbus_register_schema.h>
 #include <modbus/base/sixteen_bit_access.h>
 #include <queue>
 
@@ -23,8 +24,22 @@ public:
   virtual void close() = 0;
   virtual void write(const char *data, size_t size) = 0;
   virtual QByteArray readAll() = 0;
+  /**
+   * read all received data into the tail of buffer, return the bytes read.
+   * backends should override it to read without the temporary QByteArray
+   */
+  virtual size_t readInto(pp::bytes::Buffer &buffer) {
+    const QByteArray data = readAll();
+    buffer.Write(data.constData(), static_cast<size_t>(data.size()));
+    return static_cast<size_t>(data.size());
+  }
   virtual void clear() = 0;
   virtual std::string name() = 0;
+  /**
+   * the silence measured on the line by the backend, nullptr if it does not
+   * timestamp the bytes it receives
+   */
+  virtual RtuSilence *silence() { return nullptr; }
 signals:
   void opened();
   void closed();
@@ -52,8 +67,10 @@ public:
   void close();
   void write(const char *data, size_t size);
   QByteArray readAll();
+  size_t readInto(pp::bytes::Buffer &buffer);
   void clear();
   std::string name();
+  RtuSilence *silence();
 
   void setPrefix(const QString &prefix);
 
@@ -78,6 +95,29 @@ private:
   QScopedPointer<ReconnectableIoDevicePrivate> d_ptr;
 };
 
+/**
+ * a request encoded once for one transfer mode, see
+ * QModbusClient::prepareRequest(). it is immutable, so it can be shared by
+ * any number of pending sends.
+ */
+struct PreparedRequest {
+  Request request;
+  TransferMode transferMode;
+  /// the whole frame on the wire, with the crc(rtu) or the mbap header
+  ByteArray frame;
+};
+using PreparedRequestPtr = std::shared_ptr<const PreparedRequest>;
+
+/// the completion of a request, see QModbusClient::submitRequest()
+using RequestCompletion =
+    std::function<void(const Request &request, const Response &response)>;
+/**
+ * runs a task on the thread it chooses, e.g. posts it to a thread pool or to
+ * the event loop of another thread
+ */
+using Executor = std::function<void(const std::function<void()> &task)>;
+
+class ChangeFilter;
 class QModbusClientPrivate;
 class QModbusClient : public QObject {
   Q_OBJECT
@@ -94,6 +134,24 @@ public:
    * if the connection is not opened, the request will dropped
    */
   void sendRequest(std::unique_ptr<Request> &request);
+  /**
+   * thread safe, unlike the other apis it can be called from any thread.
+   * the request is pushed to a lock-free queue, no lock is taken and no
+   * queued call is made, the thread of the client takes the queued requests
+   * in batches, with one posted event per batch, and sends them as
+   * sendRequest() does. if the connection is not opened then, the request
+   * will dropped.
+   *
+   * completion is called when requestFinished is emitted for the request,
+   * through executor, or on the thread of the client if executor is null.
+   * the signals are emitted as for any other request. it is called once for
+   * every request, also without a signal: with kNoError once a brocast is
+   * written, and with kTimeout if the request is dropped(the connection is
+   * not opened, clearPendingRequest()).
+   */
+  void submitRequest(const Request &request,
+                     const RequestCompletion &completion = nullptr,
+                     const Executor &executor = nullptr);
 
   /**
    *for function code 0x01/0x02
@@ -128,6 +186,13 @@ public:
    */
   void writeSingleRegister(ServerAddress serverAddress, Address address,
                            const SixteenBitValue &value);
+  /**
+   * for function code 0x16, the server sets the register to
+   * (current & andMask) | (orMask & ~andMask) in one transaction
+   * will emit maskWriteRegisterFinished signal
+   */
+  void maskWriteRegister(ServerAddress serverAddress, Address address,
+                         uint16_t andMask, uint16_t orMask);
   /**
    *for function code 0x10
    *wiil emit writeMultipleRegistersFinished signal
@@ -145,6 +210,49 @@ public:
                                   Address writeStartAddress,
                                   const QVector<SixteenBitValue> &valueList);
 
+  /**
+   * encode the request once with the current transfer mode. each
+   * sendPreparedRequest() then writes the cached frame, in mbap mode only
+   * the transaction id is patched, in rtu mode the cached crc is reused.
+   * the completion is the same as sendRequest(), the request emitted is the
+   * prepared one, in mbap mode its transaction id is not patched.
+   *
+   * if the transfer mode is changed, the request must be prepared again.
+   */
+  PreparedRequestPtr prepareRequest(const Request &request);
+  /**
+   * for function code 0x01/0x02, will emit readSingleBitsFinished signal
+   */
+  PreparedRequestPtr prepareReadSingleBits(ServerAddress serverAddress,
+                                           FunctionCode functionCode,
+                                           Address startAddress,
+                                           Quantity quantity);
+  /**
+   * for function code 0x03/0x04, will emit readRegistersFinished signal
+   */
+  PreparedRequestPtr prepareReadRegisters(ServerAddress serverAddress,
+                                          FunctionCode functionCode,
+                                          Address startAddress,
+                                          Quantity quantity);
+  /**
+   * if the connection is not opened, or the request was prepared for another
+   * transfer mode, the request will dropped
+   */
+  void sendPreparedRequest(const PreparedRequestPtr &prepared);
+
+  /**
+   * for function code 0x03/0x04, only deliver the changes of poll.
+   * the responses of poll sent by sendPreparedRequest() do not emit
+   * readRegistersFinished any more, registersChanged is emitted when some
+   * registers changed since the last response. other requests of the same
+   * range are not filtered. with a schema, the deadbands of its tags are
+   * applied. the client holds poll until it is disabled.
+   */
+  void enableChangeFilter(const PreparedRequestPtr &poll);
+  void enableChangeFilter(const PreparedRequestPtr &poll,
+                          const RegisterSchema &schema);
+  void disableChangeFilter(const PreparedRequestPtr &poll);
+
   bool isIdle();
 
   bool isClosed();
@@ -181,9 +289,63 @@ public:
    */
   void enableDiagnosis(bool enable);
   void enableDump(bool enable);
+  /**
+   * a read(function code 0x01-0x04) identical to a read that is queued or
+   * waiting for its response is not sent again, it completes with the
+   * response of that one. the joined reads are not counted by
+   * pendingRequestSize().
+   * default is disabled
+   */
+  void enableSingleFlight(bool enable);
+  /**
+   * a single write(function code 0x05/0x06) that is not sent yet takes the
+   * value of a newer write to the same address, and the single writes to
+   * adjacent addresses of the same server are sent as one 0x0f/0x10
+   * request. each write still completes on its own, with the echo of its
+   * request or the error of the request sent.
+   * default is disabled
+   */
+  void enableWriteCoalescing(bool enable);
+  /**
+   * in rtu mode, the bytes before a valid response(line noise, the rest of a
+   * late response) are skipped, so the response is decoded when it arrives
+   * instead of failing with a crc error or waiting for the timeout. see
+   * ModbusRtuFrameDecoder. call it when no request is waiting for its
+   * response.
+   * default is disabled
+   */
+  void enableRtuResync(bool enable);
+  /**
+   * in rtu mode, the silences on the line measured by the serial backend
+   * frame the response too: a silence longer than t3.5 drops the partial
+   * response before it, so a corrupt length byte does not hold the decoder
+   * until the timeout, and a silence longer than t1.5 inside the response
+   * fails it with kStorageParityError. the timestamps are taken in the event
+   * loop, a busy loop may split a response, so enable it only on a client
+   * with its own thread or a light loop.
+   * default is disabled
+   */
+  void enableRtuSilenceDetection(bool enable);
+  /**
+   * the microseconds from the end of the last request on the line to the
+   * first byte of its response, -1 if the backend does not measure it
+   */
+  int64_t turnaround();
 
   RuntimeDiagnosis runtimeDiagnosis() const;
 
+  /**
+   * serve the reads(function code 0x01-0x04) from the responses received
+   * not more than ttl milliseconds ago, a read served from the cache is
+   * completed as if it was sent. the writes to a server drop the cached
+   * responses of the coils/holding registers they write.
+   * default is 0, disabled
+   */
+  void setResponseCacheTtl(int ttl);
+  int responseCacheTtl() const;
+  uint64_t responseCacheHits() const;
+  uint64_t responseCacheMisses() const;
+
 signals:
   void clientOpened();
   void clientClosed();
@@ -202,6 +364,16 @@ signals:
                              Error error);
   void writeSingleRegisterFinished(ServerAddress serverAddress, Address address,
                                    Error error);
+  void maskWriteRegisterFinished(ServerAddress serverAddress, Address address,
+                                 Error error);
+  /**
+   * changedRanges are absolute register addresses, data is all the registers
+   * of the response, starting from startAddress
+   */
+  void registersChanged(ServerAddress serverAddress, FunctionCode functionCode,
+                        Address startAddress,
+                        const QVector<AddressRange> &changedRanges,
+                        const ByteArray &data);
 
   void writeMultipleRegistersFinished(ServerAddress serverAddress,
                                       Address address, Error error);
@@ -212,6 +384,9 @@ signals:
       ServerAddress serverAddress, Address readStartAddress,
       const QVector<SixteenBitValue> &valueList, Error error);
 
+protected:
+  bool event(QEvent *e) override;
+
 private:
   void runAfter(int delay, const std::function<void()> &functor);
   void setupEnvironment();
@@ -225,7 +400,8 @@ private:
   void clearPendingRequest();
   void processResponseAnyFunctionCode(const Request &request,
                                       const Response &response);
-  void processFunctionCode(const Request &request, const Response &response);
+  void processFunctionCode(const Request &request, const Response &response,
+                           ChangeFilter *filter);
   void processDiagnosis(const Request &request, const Response &response);
 
   QScopedPointer<QModbusClientPrivate> d_ptr;
@@ -250,9 +426,11 @@ QModbusClient *newSocketClient(QAbstractSocket::SocketType type,
 // data bits: 5/6/7/8
 // parity:n(NoParity)/e(EvenParity)/o(OddParity)
 // stop bits:1/2
+// backend(linux): &backend=termios for TermiosSerialPort instead of QSerialPort
 //
 // modbus.file:///COM1/?9600-8-n-1
 // modbus.file:///dev/ttyS0/?9600-8-n-1
+// modbus.file:///dev/ttyS0/?9600-8-n-1&backend=termios
 // modbus.tcp://192.168.4.66:502/
 // modbus.udp://192.168.4.66:502/
 QModbusClient *createClient(const QString &url,
@@ -265,5 +443,6 @@ Q_DECLARE_METATYPE(modbus::SixteenBitAccess);
 Q_DECLARE_METATYPE(modbus::Error);
 Q_DECLARE_METATYPE(QVector<modbus::SixteenBitValue>);
 Q_DECLARE_METATYPE(modbus::ByteArray);
+Q_DECLARE_METATYPE(QVector<modbus::AddressRange>);
 
 #endif // __MODBUS_CLIENT_H_
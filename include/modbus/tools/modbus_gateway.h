@@ -0,0 +1,87 @@
+#ifndef __MODBUS_GATEWAY_H_
+#define __MODBUS_GATEWAY_H_
+
+#include <QObject>
+#include <QScopedPointer>
+#include <modbus/base/modbus.h>
+#include <modbus/tools/modbus_client.h>
+#include <modbus/tools/modbus_server.h>
+
+namespace modbus {
+
+/**
+ * A modbus tcp to serial gateway. The mbap requests received from the tcp
+ * clients are forwarded by their unit id(server address) to the client of
+ * the serial bus routed, and the response is sent back with the transaction
+ * id of the request.
+ *
+ * Each bus keeps its own queue, the queue of the QModbusClient, so the
+ * requests of one bus are sent one by one while the buses work in parallel.
+ * A tcp client may send the next request before the response of the last
+ * one, the responses are sent in the order they complete.
+ *
+ * The exception responses made by the gateway:
+ *   kUnavailableGatewayPath            no route for the unit id, the bus is
+ *                                      not opened or its queue is full
+ *   kGatewayTargetDeviceResponseLoss   the device did not respond in the
+ *                                      timeout(and retries) of the bus, or
+ *                                      the bus was closed meanwhile
+ *
+ * The requests to the broadcast address are forwarded to every bus routed,
+ * without a response.
+ *
+ * The requests are framed by the mbap length only, so the pdu of any function
+ * code is forwarded as it is. A response on the bus still has to be framed by
+ * the client of the bus, one of a function code it does not know the size of
+ * is answered with kIllegalFunctionCode.
+ *
+ *   auto gateway = createQModbusTcpGateway(502);
+ *   auto bus = createClient("modbus.file:///dev/ttyS0/?9600-8-n-1");
+ *   bus->open();
+ *   gateway->addRoute(1, bus);
+ *   gateway->addRoute(2, bus);
+ *   gateway->listenAndServe();
+ */
+class QModbusGatewayPrivate;
+class QModbusGateway : public QObject {
+  Q_OBJECT
+  Q_DECLARE_PRIVATE(QModbusGateway)
+public:
+  static const int kDefaultMaxPendingPerBus = 64;
+
+  explicit QModbusGateway(AbstractServer *server, QObject *parent = nullptr);
+  ~QModbusGateway() override;
+
+  /**
+   * forward the requests to serverAddress to bus, a bus may serve any number
+   * of server addresses. the bus is not owned by the gateway, its routes are
+   * removed when it is destroyed
+   */
+  void addRoute(ServerAddress serverAddress, QModbusClient *bus);
+  void removeRoute(ServerAddress serverAddress);
+  QModbusClient *route(ServerAddress serverAddress) const;
+
+  /**
+   * the requests waiting on one bus, a request beyond it is answered with
+   * kUnavailableGatewayPath at once
+   */
+  void setMaxPendingPerBus(int maxPending);
+  int maxPendingPerBus() const;
+  /// the requests forwarded and not answered yet, of all buses
+  size_t pendingRequestSize() const;
+
+  void enableDump(bool enable);
+  void setPrefix(const QString &prefix);
+
+  bool listenAndServe();
+
+private:
+  QScopedPointer<QModbusGatewayPrivate> d_ptr;
+};
+
+QModbusGateway *createQModbusTcpGateway(uint16_t port = 502,
+                                        QObject *parent = nullptr);
+
+} // namespace modbus
+
+#endif // __MODBUS_GATEWAY_H_
@@ -0,0 +1,101 @@
+#ifndef __MODBUS_SERIAL_ENGINE_H_
+#define __MODBUS_SERIAL_ENGINE_H_
+
+#include <QObject>
+#include <QScopedPointer>
+#include <QString>
+#include <modbus/base/modbus.h>
+#include <modbus/tools/modbus_termios.h>
+
+#if defined(__linux__)
+
+namespace modbus {
+
+/// a port of SerialEngine, a rtu line with its client settings
+struct SerialEnginePort {
+  /// a path, or a name in /dev like ttyS0
+  std::string portName;
+  TermiosConfig termios;
+  /// milliseconds
+  int waitResponseTimeout = 1000;
+  int retryTimes = 0;
+  /// the silence after a brocast request, milliseconds
+  int waitConversionDelay = 200;
+  /// a port that failed is opened again after it, milliseconds
+  int reopenDelay = 1000;
+  /// frame by the silences on the line, see RtuSilence. default disabled
+  bool enableRtuSilenceDetection = false;
+};
+
+/**
+ * A rtu client engine for many serial ports, serviced by a small fixed pool
+ * of threads instead of a QModbusClient(and its timers and signals) per
+ * port on the thread of the application.
+ *
+ * Each thread polls its ports with epoll, their timers are on a timer wheel
+ * of the thread with a timerfd armed to its next expiry, so the t3.5 delays
+ * and the response timeouts are kept to 0.1ms, whatever the application
+ * thread is doing.
+ * Each port has its own queue and rtu state machine, one request is on the
+ * line at a time, and the next one goes t3.5 after the line got silent.
+ *
+ * A port goes to the thread with the fewest ports. The requests are handed
+ * to the thread of the port through a lock-free queue, and the responses
+ * back to the thread of the engine through another one, requestFinished()
+ * is emitted there, in batches.
+ *
+ * A port that fails(unplugged, hung up) is closed, its requests finish with
+ * kTimeout, and it is opened again after reopenDelay.
+ *
+ *   SerialEngine engine(4);
+ *   SerialEnginePort port;
+ *   port.portName = "/dev/ttyS0";
+ *   port.termios.baudRate = 115200;
+ *   auto id = engine.addPort(port);
+ *   engine.sendRequest(id, Request(1, FunctionCode::kReadHoldingRegisters,
+ *                                  any(), {0x00, 0x00, 0x00, 0x0a}));
+ */
+class SerialEnginePrivate;
+class SerialEngine : public QObject {
+  Q_OBJECT
+  Q_DECLARE_PRIVATE(SerialEngine)
+public:
+  using PortId = int;
+  static const int kDefaultThreadCount = 2;
+
+  explicit SerialEngine(int threadCount = kDefaultThreadCount,
+                        QObject *parent = nullptr);
+  /// the requests not finished yet are dropped
+  ~SerialEngine() override;
+
+  /**
+   * open the port and hand it to a thread, return its id, or -1 with
+   * errorString() set. the ports are added on the thread of the engine,
+   * before the requests to them are sent from other threads
+   */
+  PortId addPort(const SerialEnginePort &port);
+  /// thread safe. false if port is unknown
+  bool sendRequest(PortId port, const Request &request);
+
+  int threadCount() const;
+  int portCount() const;
+  /// the index of the thread servicing port
+  int threadOf(PortId port) const;
+  QString errorString() const;
+
+signals:
+  void requestFinished(int port, const Request &request,
+                       const Response &response);
+
+protected:
+  bool event(QEvent *e) override;
+
+private:
+  QScopedPointer<SerialEnginePrivate> d_ptr;
+};
+
+} // namespace modbus
+
+#endif // __linux__
+
+#endif // __MODBUS_SERIAL_ENGINE_H_
@@ -30,6 +30,15 @@ public:
   virtual void write(const char *data, size_t size) = 0;
   virtual std::string name() const = 0;
   virtual std::string fullName() const = 0;
+  /**
+   * read all received data into the tail of buffer, return the bytes read
+   */
+  virtual size_t readInto(pp::bytes::Buffer & /*buffer*/) { return 0; }
+  /**
+   * the silence measured on the line, nullptr if the connection does not
+   * timestamp the bytes it receives
+   */
+  virtual RtuSilence *silence() { return nullptr; }
 
   void setPrefix(const QString &prefix) { log_prefix_ = prefix.toStdString(); }
 
@@ -68,6 +77,24 @@ using canWriteSingleBitValueFunc =
     std::function<Error(Address startAddress, bool value)>;
 using canWriteSixteenBitValueFunc =
     std::function<Error(Address startAddress, const SixteenBitValue &value)>;
+/**
+ * called once per write with all the values written, one byte(0 or 1) per
+ * bit for single bit tables, two bytes(big endian) per register for sixteen
+ * bit tables
+ */
+using canWriteSingleBitRangeFunc = std::function<Error(
+    StorageKind kind, Address startAddress, const ByteArray &values)>;
+using canWriteSixteenBitRangeFunc = std::function<Error(
+    StorageKind kind, Address startAddress, const ByteArray &values)>;
+/**
+ * called for the requests of the function codes the server does not handle,
+ * data is the pdu after the function code. fill response with the pdu of the
+ * response after the function code and return kNoError, or return the
+ * exception code to answer with
+ */
+using rawRequestHandlerFunc =
+    std::function<Error(ServerAddress serverAddress, FunctionCode functionCode,
+                        const ByteArray &data, ByteArray *response)>;
 
 class QModbusServerPrivate;
 class QModbusServer : public QObject {
@@ -89,6 +116,30 @@ public:
   void enableDump(bool enable);
   void setPrefix(const QString &prefix);
 
+  /**
+   * the changed addresses of each table are collected as merged ranges and
+   * delivered by coilsChanged/inputDiscreteChanged/holdingRegistersChanged/
+   * inputRegistersChanged. with 0(default) they are delivered once per
+   * request or write call, otherwise at most once every msec milliseconds
+   */
+  void setChangeNotifyInterval(int msec);
+  int changeNotifyInterval() const;
+  /**
+   * coilsValueChanged/inputDiscreteValueChanged are emitted once per
+   * address, so they are off by default. writeCoilsRequested is emitted
+   * whenever it is connected, it is how a master's coil write reaches the
+   * application
+   */
+  void enablePerAddressSignals(bool enable);
+  /**
+   * in rtu mode, the silences on the line measured by the serial connection
+   * frame the requests too: a silence longer than t3.5 drops the partial
+   * request before it, a silence longer than t1.5 inside a request fails it
+   * with kStorageParityError. see QModbusClient::enableRtuSilenceDetection.
+   * default is disabled
+   */
+  void enableRtuSilenceDetection(bool enable);
+
   /**
    *for write request, 0x05, 0x0f, 0x06,0x16,0x23
    *Before writing, check whether it can be written. If writing is allowed, the
@@ -99,6 +150,20 @@ public:
    */
   void setCanWriteSingleBitValueFunc(const canWriteSingleBitValueFunc &func);
   void setCanWriteSixteenBitValueFunc(const canWriteSixteenBitValueFunc &func);
+  /**
+   * same as above, but called once per write with the whole range, replaces
+   * the function set by the per-value setter of the same table kind
+   */
+  void setCanWriteSingleBitRangeFunc(const canWriteSingleBitRangeFunc &func);
+  void setCanWriteSixteenBitRangeFunc(const canWriteSixteenBitRangeFunc &func);
+
+  /**
+   * without it, the requests of the function codes not handled are answered
+   * with kIllegalFunctionCode. in mbap mode the requests are framed by the
+   * mbap length, so any function code reaches the handler, in rtu mode only
+   * the function codes the frame decoder knows the size of
+   */
+  void setRawRequestHandler(const rawRequestHandlerFunc &func);
 
   // read write
   void handleHoldingRegisters(Address startAddress, Quantity quantity);
@@ -109,6 +174,29 @@ public:
   // read write
   void handleCoils(Address startAddress, Quantity quantity);
 
+  /**
+   * serve the holding/input registers from a memory mapped file, so other
+   * processes can write the registers in place, see SharedRegisters for the
+   * layout. call it after handleHoldingRegisters/handleInputRegisters. a new
+   * file gets the current values, an existing one must have the same start
+   * address and quantity. writes from other processes are served but don't
+   * emit the change signals
+   */
+  bool mapRegisters(StorageKind kind, const QString &fileName);
+
+  /**
+   * keep a snapshot of all the tables in a memory mapped file, the pages
+   * changed are written back every msec milliseconds and when the server is
+   * destroyed. if fileName already holds a snapshot, the tables handled
+   * with the same address range as in it get their values restored first,
+   * so the server serves the last known values right after a restart. a
+   * table mapped by mapRegisters() keeps the values of its mapping. a table
+   * handled with another address range starts a new snapshot
+   */
+  bool enableSnapshot(const QString &fileName, int msec = 1000);
+  /// write the pages changed since the last save now
+  void saveSnapshot();
+
   // read
   bool holdingRegisterValue(Address address, SixteenBitValue *value);
   bool inputRegisterValue(Address address, SixteenBitValue *value);
@@ -138,6 +226,15 @@ signals:
 
   void writeCoilsRequested(Address address, bool value);
   void writeHodingRegistersRequested(Address address, const ByteArray &values);
+  /// once per 0x05/0x0f request, one byte(0 or 1) per coil in values
+  void writeMultipleCoilsRequested(Address startAddress,
+                                   const ByteArray &values);
+
+  // the merged ranges changed since the last notification
+  void coilsChanged(const QVector<AddressRange> &ranges);
+  void inputDiscreteChanged(const QVector<AddressRange> &ranges);
+  void holdingRegistersChanged(const QVector<AddressRange> &ranges);
+  void inputRegistersChanged(const QVector<AddressRange> &ranges);
 
 private:
   QScopedPointer<QModbusServerPrivate> d_ptr;
@@ -151,6 +248,14 @@ QModbusServer *createQModbusSerialServer(
     QSerialPort::StopBits stopBits = QSerialPort::OneStop,
     QObject *parent = nullptr);
 
+class AbstractIoDevice;
+/**
+ * serve on a serial port backend of the client, e.g. a TermiosSerialPort.
+ * the server owns it, and it must open synchronously
+ */
+QModbusServer *createQModbusSerialServer(AbstractIoDevice *serialPort,
+                                         QObject *parent = nullptr);
+
 QModbusServer *createQModbusTcpServer(uint16_t port = 502,
                                       QObject *parent = nullptr);
 
@@ -159,9 +264,11 @@ QModbusServer *createQModbusTcpServer(uint16_t port = 502,
 // data bits: 5/6/7/8
 // parity:n(NoParity)/e(EvenParity)/o(OddParity)
 // stop bits:1/2
+// backend(linux): &backend=termios for TermiosSerialPort instead of QSerialPort
 //
 // modbus.file:///COM1/?9600-8-n-1
 // modbus.file:///dev/ttyS0/?9600-8-n-1
+// modbus.file:///dev/ttyS0/?9600-8-n-1&backend=termios
 // modbus.tcp://:502/
 QModbusServer *createServer(const QString &url, QObject *parent = nullptr);
 
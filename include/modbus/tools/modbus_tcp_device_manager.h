@@ -0,0 +1,101 @@
+#ifndef __MODBUS_TCP_DEVICE_MANAGER_H_
+#define __MODBUS_TCP_DEVICE_MANAGER_H_
+
+#include <QObject>
+#include <QScopedPointer>
+#include <QString>
+#include <modbus/base/modbus.h>
+
+#if defined(__linux__)
+
+namespace modbus {
+
+/// a device of TcpDeviceManager, a modbus tcp server with its client settings
+struct TcpDevice {
+  /// an ip address or a host name, resolved when the device is added
+  std::string host;
+  uint16_t port = 502;
+  /// milliseconds
+  int connectTimeout = 3000;
+  int waitResponseTimeout = 1000;
+  int retryTimes = 0;
+  /// a device that failed is connected again after it, milliseconds
+  int reconnectDelay = 1000;
+};
+
+/**
+ * A modbus tcp client for many devices, thousands of them, serviced by a
+ * small fixed pool of threads instead of a QModbusClient, a socket, their
+ * buffers and timers per device.
+ *
+ * A device is a session of a few hundred bytes on one of the threads: its
+ * socket, its settings, the transaction id, a timer on the timer wheel of
+ * the thread and the queue of its requests. The buffers, the mbap encoder
+ * and decoder(and its check size table) belong to the thread, shared by its
+ * devices, a device keeps only the bytes of a frame it got in part.
+ *
+ * One request per device is on the wire at a time, the response is matched
+ * by its transaction id, a late response to a request that timed out is
+ * dropped. A device that fails(refused, reset, timed out connecting) is
+ * closed, its requests finish with kTimeout, and it is connected again
+ * after reconnectDelay. The requests sent while it is closed finish with
+ * kTimeout at once.
+ *
+ * A device goes to the thread with the fewest devices. The requests are
+ * handed to the thread through a lock-free queue, and the responses back to
+ * the thread of the manager through another one, requestFinished() is
+ * emitted there, in batches. It is the api of SerialEngine, with devices
+ * for ports.
+ *
+ *   TcpDeviceManager manager(4);
+ *   TcpDevice device;
+ *   device.host = "192.168.1.10";
+ *   auto id = manager.addDevice(device);
+ *   manager.sendRequest(id, Request(1, FunctionCode::kReadHoldingRegisters,
+ *                                   any(), {0x00, 0x00, 0x00, 0x0a}));
+ */
+class TcpDeviceManagerPrivate;
+class TcpDeviceManager : public QObject {
+  Q_OBJECT
+  Q_DECLARE_PRIVATE(TcpDeviceManager)
+public:
+  using DeviceId = int;
+  static const int kDefaultThreadCount = 2;
+
+  explicit TcpDeviceManager(int threadCount = kDefaultThreadCount,
+                            QObject *parent = nullptr);
+  /// the requests not finished yet are dropped
+  ~TcpDeviceManager() override;
+
+  /**
+   * resolve the host and hand the device to a thread, which connects it.
+   * return its id, or -1 with errorString() set. the devices are added on
+   * the thread of the manager, before the requests to them are sent from
+   * other threads
+   */
+  DeviceId addDevice(const TcpDevice &device);
+  /// thread safe. false if device is unknown
+  bool sendRequest(DeviceId device, const Request &request);
+
+  int threadCount() const;
+  int deviceCount() const;
+  /// the index of the thread servicing device
+  int threadOf(DeviceId device) const;
+  QString errorString() const;
+
+signals:
+  void requestFinished(int device, const Request &request,
+                       const Response &response);
+
+protected:
+  bool event(QEvent *e) override;
+
+private:
+  QScopedPointer<TcpDeviceManagerPrivate> d_ptr;
+};
+
+} // namespace modbus
+
+#endif // __linux__
+
+#endif // __MODBUS_TCP_DEVICE_MANAGER_H_
@@ -0,0 +1,58 @@
+#ifndef __MODBUS_TERMIOS_H_
+#define __MODBUS_TERMIOS_H_
+
+#include <cstdint>
+#include <string>
+
+#if defined(__linux__)
+
+namespace modbus {
+
+/// the rs-485 mode of the uart driver(TIOCSRS485), the driver drives RTS
+struct Rs485Config {
+  bool enabled = false;
+  /// the level of RTS while sending and after it
+  bool rtsOnSend = true;
+  bool rtsAfterSend = false;
+  /// milliseconds
+  uint32_t delayRtsBeforeSend = 0;
+  uint32_t delayRtsAfterSend = 0;
+  /// receive the echo of the bytes sent, leave it off for the client
+  bool receiveDuringSend = false;
+};
+
+/// the line settings of a tty, see openTermios()
+struct TermiosConfig {
+  /// one of the standard baud rates from 1200 to 4000000
+  int baudRate = 9600;
+  /// 5-8
+  int dataBits = 8;
+  /// 'N' none, 'E' even, 'O' odd, 'S' space, 'M' mark
+  char parity = 'N';
+  /// 1 or 2
+  int stopBits = 1;
+  /// ASYNC_LOW_LATENCY, a driver without it is only logged
+  bool lowLatency = true;
+  /// VMIN, the tty gets readable after readBatching bytes
+  int readBatching = 1;
+  Rs485Config rs485;
+};
+
+/**
+ * the path of a port name, like QSerialPort a bare name is in /dev. the
+ * names from the urls look like dev/ttyS0/
+ */
+std::string termiosPortLocation(const std::string &name);
+bool isTermiosBaudRate(int baudRate);
+/**
+ * open the tty at path nonblocking and exclusive, in raw mode with the
+ * settings of config. return the fd, or -1 with errorString set
+ */
+int openTermios(const std::string &path, const TermiosConfig &config,
+                std::string *errorString);
+
+} // namespace modbus
+
+#endif // __linux__
+
+#endif // __MODBUS_TERMIOS_H_
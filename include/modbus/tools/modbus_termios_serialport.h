@@ -0,0 +1,103 @@
+#ifndef __MODBUS_TERMIOS_SERIALPORT_H_
+#define __MODBUS_TERMIOS_SERIALPORT_H_
+
+#include <modbus/tools/modbus_client.h>
+#include <modbus/tools/modbus_termios.h>
+
+#if defined(__linux__)
+
+namespace modbus {
+
+/**
+ * A serial port on linux that talks to the tty with termios, instead of
+ * QSerialPort.
+ *
+ * The tty is nonblocking and watched by a QSocketNotifier, so the event
+ * loop polls it with epoll(or poll) directly, and the bytes are read
+ * straight into the buffer of the client with read(2). The notifier is off
+ * from readyRead() until the bytes are read, and they are timestamped when
+ * the tty gets readable, see silence().
+ *
+ *   low latency     ASYNC_LOW_LATENCY(TIOCSSERIAL), the driver pushes the
+ *                   bytes at once instead of on its timer, usb adapters
+ *                   usually gain the most. a driver without it is only
+ *                   logged. default enabled
+ *   read batching   VMIN, the tty gets readable after minBytes bytes. keep
+ *                   it at or below the shortest frame expected(5 for a rtu
+ *                   exception response), or a short frame waits for the
+ *                   timeout. default 1
+ *   rs-485          TIOCSRS485, open() fails if the driver does not
+ *                   support it
+ *
+ * The settings take effect at the next open(). Only the standard baud rates
+ * from 1200 to 4000000 are supported.
+ *
+ *   auto port = new TermiosSerialPort();
+ *   port->setPortName("/dev/ttyS0");
+ *   port->setBaudRate(115200);
+ *   auto client = new QModbusClient(port);
+ *
+ * createClient/createServer use it with the option backend=termios:
+ *   modbus.file:///dev/ttyS0/?115200-8-n-1&backend=termios
+ */
+class TermiosSerialPortPrivate;
+class TermiosSerialPort : public AbstractIoDevice {
+  Q_OBJECT
+  Q_DECLARE_PRIVATE(TermiosSerialPort)
+public:
+  explicit TermiosSerialPort(QObject *parent = nullptr);
+  ~TermiosSerialPort() override;
+
+  /// a path, or a name in /dev like ttyS0
+  void setPortName(const QString &name);
+  /// return false if baudRate is not a standard baud rate
+  bool setBaudRate(qint32 baudRate);
+  void setDataBits(QSerialPort::DataBits dataBits);
+  void setParity(QSerialPort::Parity parity);
+  void setStopBits(QSerialPort::StopBits stopBits);
+  void setLowLatency(bool enable);
+  void setReadBatching(int minBytes);
+  void setRs485(const Rs485Config &config);
+
+  /// the fd of the tty, -1 if it is not opened
+  int handle() const;
+  bool isOpen() const;
+
+  void open() override;
+  void close() override;
+  void write(const char *data, size_t size) override;
+  QByteArray readAll() override;
+  size_t readInto(pp::bytes::Buffer &buffer) override;
+  void clear() override;
+  std::string name() override;
+  RtuSilence *silence() override;
+
+private:
+  void onReadable();
+  void onWritable();
+
+  QScopedPointer<TermiosSerialPortPrivate> d_ptr;
+};
+
+QModbusClient *
+newTermiosSerialClient(const QString &serialName,
+                       QSerialPort::BaudRate baudRate = QSerialPort::Baud9600,
+                       QSerialPort::DataBits dataBits = QSerialPort::Data8,
+                       QSerialPort::Parity parity = QSerialPort::NoParity,
+                       QSerialPort::StopBits stopBits = QSerialPort::OneStop,
+                       QObject *parent = nullptr);
+
+class QModbusServer;
+QModbusServer *createQModbusTermiosSerialServer(
+    const QString &serialName,
+    QSerialPort::BaudRate baudRate = QSerialPort::Baud9600,
+    QSerialPort::DataBits dataBits = QSerialPort::Data8,
+    QSerialPort::Parity parity = QSerialPort::NoParity,
+    QSerialPort::StopBits stopBits = QSerialPort::OneStop,
+    QObject *parent = nullptr);
+
+} // namespace modbus
+
+#endif // __linux__
+
+#endif // __MODBUS_TERMIOS_SERIALPORT_H_
@@ -160,6 +160,18 @@ void Buffer::Resize(size_t len) {
   hasWritten(len);
 }
 
+uint8_t *Buffer::BeginWrite(size_t len) {
+  if (leftSpace() < len) {
+    Optimization();
+  }
+  if (leftSpace() < len) {
+    growSpace(static_cast<size_t>(size_ + len));
+  }
+  return beginWrite();
+}
+
+void Buffer::CommitWrite(size_t len) { hasWritten(len); }
+
 // ReadFrom
 // WriteTo
 
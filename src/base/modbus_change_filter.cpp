@@ -0,0 +1,144 @@
+#include <cmath>
+#include <cstring>
+#include <modbus/base/modbus_change_filter.h>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MODBUS_SSE2 1
+#endif
+
+namespace modbus {
+
+namespace {
+void appendRegister(std::vector<AddressRange> *ranges, size_t index) {
+  if (!ranges->empty()) {
+    AddressRange &last = ranges->back();
+    if (static_cast<size_t>(last.start) + last.quantity == index) {
+      last.quantity++;
+      return;
+    }
+  }
+  ranges->push_back(AddressRange(static_cast<Address>(index), 1));
+}
+} // namespace
+
+ChangeFilter::ChangeFilter(const RegisterSchema &schema)
+    : schema_(schema), hasSchema_(true) {}
+
+void ChangeFilter::reset() {
+  hasLast_ = false;
+  last_.clear();
+  lastValues_.clear();
+}
+
+void ChangeFilter::diffRegisters(const uint8_t *a, const uint8_t *b,
+                                 size_t registers,
+                                 std::vector<AddressRange> *ranges) {
+  size_t i = 0;
+#ifdef MODBUS_SSE2
+  /// 8 registers at a time, the equal ones are skipped with one compare
+  for (; i + 8 <= registers; i += 8) {
+    const __m128i va =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i * 2));
+    const __m128i vb =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i * 2));
+    const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+    if (mask == 0xFFFF) {
+      continue;
+    }
+    for (size_t j = 0; j < 8; j++) {
+      if (((mask >> (j * 2)) & 0x03) != 0x03) {
+        appendRegister(ranges, i + j);
+      }
+    }
+  }
+#endif
+  for (; i < registers; i++) {
+    if (a[i * 2] != b[i * 2] || a[i * 2 + 1] != b[i * 2 + 1]) {
+      appendRegister(ranges, i);
+    }
+  }
+}
+
+bool ChangeFilter::update(const uint8_t *data, size_t size,
+                          std::vector<AddressRange> *changed) {
+  changed->clear();
+  const size_t registers = size / 2;
+
+  if (!hasLast_ || last_.size() != size) {
+    last_.assign(data, data + size);
+    hasLast_ = true;
+    if (registers > 0) {
+      changed->push_back(AddressRange(0, static_cast<Quantity>(registers)));
+    }
+    if (hasSchema_ && schema_.decode(data, size, &values_)) {
+      lastValues_.resize(schema_.tagCount());
+      for (size_t i = 0; i < lastValues_.size(); i++) {
+        lastValues_[i] = schema_.tagValue(i, values_);
+      }
+    }
+    return !changed->empty();
+  }
+
+  diffRegisters(last_.data(), data, registers, changed);
+  if (changed->empty()) {
+    return false;
+  }
+
+  if (hasSchema_ && lastValues_.size() == schema_.tagCount() &&
+      schema_.decode(data, size, &values_)) {
+    applyDeadbands(registers, changed);
+  }
+
+  for (const auto &range : *changed) {
+    std::memcpy(last_.data() + range.start * 2, data + range.start * 2,
+                range.quantity * 2);
+  }
+  return !changed->empty();
+}
+
+void ChangeFilter::applyDeadbands(size_t registers,
+                                  std::vector<AddressRange> *changed) {
+  marks_.assign(registers, 0);
+  for (const auto &range : *changed) {
+    std::memset(marks_.data() + range.start, 1, range.quantity);
+  }
+
+  for (size_t i = 0; i < schema_.tagCount(); i++) {
+    const RegisterTag &tag = schema_.tag(i);
+    const size_t begin = tag.offset;
+    const size_t end = begin + RegisterSchema::registerCount(tag);
+    bool touched = false;
+    for (size_t r = begin; r < end; r++) {
+      touched = touched || marks_[r];
+    }
+    if (!touched) {
+      continue;
+    }
+
+    const double value = schema_.tagValue(i, values_);
+    const double last = lastValues_[i];
+    const double delta = std::fabs(value - last);
+    const bool hasDeadband = tag.type != TagType::kString &&
+                             (tag.deadband > 0 || tag.deadbandPercent > 0);
+    const bool outOfDeadband =
+        (tag.deadband > 0 && delta > tag.deadband) ||
+        (tag.deadbandPercent > 0 &&
+         delta > std::fabs(last) * tag.deadbandPercent / 100);
+    if (hasDeadband && !outOfDeadband) {
+      std::memset(marks_.data() + begin, 0, end - begin);
+      continue;
+    }
+    lastValues_[i] = value;
+  }
+
+  changed->clear();
+  for (size_t r = 0; r < marks_.size(); r++) {
+    if (marks_[r]) {
+      appendRegister(changed, r);
+    }
+  }
+}
+
+} // namespace modbus
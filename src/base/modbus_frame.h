@@ -1,6 +1,7 @@
 #ifndef __MODBUS_FRAME_H_
 #define __MODBUS_FRAME_H_
 
+#include <algorithm>
 #include <array>
 #include <memory>
 #include <modbus/base/modbus.h>
@@ -8,6 +9,7 @@
 #include <modbus/base/smart_assert.h>
 #include <qmap.h>
 #include <unordered_map>
+#include <vector>
 
 namespace modbus {
 static void appendStdString(ByteArray &array, const std::string &subString) {
@@ -77,7 +79,7 @@ inline CheckSizeFuncTable creatDefaultCheckSizeFuncTableForClient() {
       nullptr, nullptr, nullptr,
       nullptr,                           //  kReadFileRecords = 0x14,
       nullptr,                           //  kWriteFileRecords = 0x15,
-      nullptr,                           //  kMaskWriteRegister = 0x16,
+      bytesRequired<6>,                  //  kMaskWriteRegister = 0x16,
       bytesRequiredStoreInArrayIndex<0>, //  kReadWriteMultipleRegisters =
                                          //  0x17,
       nullptr, //  kReadDeviceIdentificationCode = 0x2b
@@ -85,6 +87,15 @@ inline CheckSizeFuncTable creatDefaultCheckSizeFuncTableForClient() {
   return table;
 }
 
+/// the default table for the client, one copy shared by the decoders
+inline std::shared_ptr<const CheckSizeFuncTable>
+sharedCheckSizeFuncTableForClient() {
+  static const std::shared_ptr<const CheckSizeFuncTable> table =
+      std::make_shared<const CheckSizeFuncTable>(
+          creatDefaultCheckSizeFuncTableForClient());
+  return table;
+}
+
 inline CheckSizeFuncTable creatDefaultCheckSizeFuncTableForServer() {
   static const CheckSizeFuncTable table = {
       nullptr,
@@ -100,8 +111,8 @@ inline CheckSizeFuncTable creatDefaultCheckSizeFuncTableForServer() {
       nullptr, nullptr, nullptr,
       nullptr,                           //  kReadFileRecords = 0x14,
       nullptr,                           //  kWriteFileRecords = 0x15,
-      nullptr,                           //  kMaskWriteRegister = 0x16,
-      bytesRequiredStoreInArrayIndex<9>, //  kReadWriteMultipleRegisters =
+      bytesRequired<6>,                  //  kMaskWriteRegister = 0x16,
+      bytesRequiredStoreInArrayIndex<8>, //  kReadWriteMultipleRegisters =
                                          //  0x17,
       nullptr, //  kReadDeviceIdentificationCode = 0x2b
   };
@@ -110,16 +121,51 @@ inline CheckSizeFuncTable creatDefaultCheckSizeFuncTableForServer() {
 
 class ModbusRtuFrameDecoder : public ModbusFrameDecoder {
   enum class State { kServerAddress, kFunctionCode, kData, kCrc0, kCrc1, kEnd };
+  /**
+   * a frame that may start at offset of the buffer, its crc is fed with the
+   * bytes as they arrive
+   */
+  struct Candidate {
+    enum Check { kFrame, kIncomplete, kInvalid };
+
+    size_t offset = 0;
+    /// 0 until the bytes that tell it arrived
+    size_t frameSize = 0;
+    /// the bytes fed to crc
+    size_t fed = 0;
+    CrcCtx crc;
+  };
 
 public:
-  explicit ModbusRtuFrameDecoder(const CheckSizeFuncTable &table)
-      : ModbusFrameDecoder(table) {
+  /**
+   * with resync, the bytes before a valid frame are skipped: a candidate
+   * frame that fails its crc or has an impossible function code is dropped
+   * one byte at a time, and a candidate still incomplete gives way to a
+   * later one that is complete with a valid crc. so a frame after line noise
+   * or a partial frame is decoded at once, instead of after a timeout.
+   * the crc check is the only guard, a false frame is accepted with a
+   * probability of about 1/65536 per offset tried.
+   * the offsets tried are kept between the calls, each one with its crc so
+   * far, so every byte is fed once to the crc of each candidate covering it,
+   * and a candidate is dropped once its frame size is passed
+   */
+  explicit ModbusRtuFrameDecoder(const CheckSizeFuncTable &table,
+                                 bool resync = false)
+      : ModbusFrameDecoder(table), resync_(resync) {
+    Clear();
+  }
+  explicit ModbusRtuFrameDecoder(
+      std::shared_ptr<const CheckSizeFuncTable> table, bool resync = false)
+      : ModbusFrameDecoder(std::move(table)), resync_(resync) {
     Clear();
   }
 
   ~ModbusRtuFrameDecoder() override = default;
 
   CheckSizeResult Decode(pp::bytes::Buffer &buffer, Adu *adu) override {
+    if (resync_) {
+      return decodeResync(buffer, adu);
+    }
     CheckSizeResult result = CheckSizeResult::kNeedMoreData;
     while (buffer.Len() > 0 || state_ == State::kEnd) {
       switch (state_) {
@@ -176,7 +222,7 @@ public:
         crc_[1] = buffer.ReadByte();
 
         uint16_t crc = crcCtx_.end();
-        if (crc % 256 != crc_[0] || crc / 256 != crc_[1]) {
+        if (broken_ || crc % 256 != crc_[0] || crc / 256 != crc_[1]) {
           error_ = Error::kStorageParityError;
         } else if (adu->isException()) {
           error_ = Error(adu->data()[0]);
@@ -202,17 +248,196 @@ public:
     isDone_ = false;
     crcCtx_.clear();
     error_ = Error::kNoError;
+    broken_ = false;
+    candidates_.clear();
+    scanned_ = 0;
+    seen_ = 0;
+    gaps_.clear();
   }
 
   Error LasError() const override { return error_; }
 
+  /**
+   * a silence longer than t3.5 is a frame boundary: the partial frame before
+   * it is dropped, with its bytes still in buffer. a silence longer than t1.5
+   * inside a frame makes the frame invalid, it is decoded with
+   * kStorageParityError. with resync, the frame is the candidate accepted, a
+   * silence in the bytes skipped before it does not count
+   */
+  void Silence(pp::bytes::Buffer &buffer, size_t offset,
+               const RtuSilenceGaps &gaps) override {
+    size_t interCharacter = gaps.interCharacter;
+    if (interCharacter != RtuSilenceGaps::kNone) {
+      interCharacter += offset;
+    }
+    if (gaps.interFrame != RtuSilenceGaps::kNone) {
+      const size_t boundary = offset + gaps.interFrame;
+      uint8_t *p = nullptr;
+      buffer.ZeroCopyRead(&p, boundary);
+      Clear();
+      if (interCharacter != RtuSilenceGaps::kNone) {
+        interCharacter -= boundary;
+      }
+    }
+    if (interCharacter == RtuSilenceGaps::kNone) {
+      return;
+    }
+    if (resync_) {
+      gaps_.push_back(interCharacter);
+    } else if (interCharacter > 0 || state_ != State::kServerAddress) {
+      broken_ = true;
+    }
+  }
+
+  /// the bytes skipped by resync since the decoder was created
+  size_t skippedBytes() const { return skippedBytes_; }
+
 private:
+  CheckSizeResult decodeResync(pp::bytes::Buffer &buffer, Adu *adu) {
+    const size_t len = buffer.Len();
+    if (len < seen_) {
+      /// the buffer was consumed by someone else, the offsets are stale
+      Clear();
+    }
+    uint8_t *p = nullptr;
+    buffer.ZeroCopyPeekAt(&p, 0, len);
+
+    /// the new offsets, a candidate needs a function code it knows
+    for (; scanned_ + 2 <= len; scanned_++) {
+      if (sizeFunction(p[scanned_ + 1])) {
+        Candidate candidate;
+        candidate.offset = scanned_;
+        candidates_.push_back(candidate);
+      }
+    }
+
+    /// the candidates are in the order of their offsets, the first frame
+    /// complete with a valid crc wins, the invalid ones are dropped
+    size_t kept = 0;
+    for (size_t i = 0; i < candidates_.size(); i++) {
+      const Candidate::Check check = feed(&candidates_[i], p, len);
+      if (check == Candidate::kFrame) {
+        acceptFrame(buffer, candidates_[i], adu);
+        return CheckSizeResult::kSizeOk;
+      }
+      if (check == Candidate::kIncomplete) {
+        candidates_[kept++] = candidates_[i];
+      }
+    }
+    candidates_.resize(kept);
+
+    /// the bytes before the first candidate left can't start a frame
+    consume(buffer,
+            candidates_.empty() ? scanned_ : candidates_.front().offset);
+    seen_ = buffer.Len();
+    return CheckSizeResult::kNeedMoreData;
+  }
+
+  const CheckSizeFunc &sizeFunction(uint8_t functionCode) const {
+    return functionCode & Adu::kExceptionByte
+               ? exceptionSize_
+               : checkSizeFuncTable_[functionCode];
+  }
+
+  /// feed the crc of candidate with the bytes of it that arrived since
+  Candidate::Check feed(Candidate *candidate, const uint8_t *p,
+                        size_t len) const {
+    const uint8_t *frame = p + candidate->offset;
+    const size_t available = len - candidate->offset;
+    if (candidate->frameSize == 0) {
+      size_t dataSize = 0;
+      const auto result =
+          sizeFunction(frame[1])(dataSize, frame + 2, available - 2);
+      if (result == CheckSizeResult::kFailed) {
+        return Candidate::kInvalid;
+      }
+      if (result == CheckSizeResult::kNeedMoreData) {
+        return Candidate::kIncomplete;
+      }
+      candidate->frameSize = dataSize + 4;
+    }
+    /// the crc covers all the frame but the crc itself
+    const size_t end = std::min(available, candidate->frameSize - 2);
+    if (end > candidate->fed) {
+      candidate->crc.crc16(frame + candidate->fed, end - candidate->fed);
+      candidate->fed = end;
+    }
+    if (available < candidate->frameSize) {
+      return Candidate::kIncomplete;
+    }
+    const uint16_t crc = candidate->crc.end();
+    if (frame[end] != crc % 256 || frame[end + 1] != crc / 256) {
+      return Candidate::kInvalid;
+    }
+    return Candidate::kFrame;
+  }
+
+  void acceptFrame(pp::bytes::Buffer &buffer, const Candidate &candidate,
+                   Adu *adu) {
+    const size_t offset = candidate.offset;
+    const size_t frameSize = candidate.frameSize;
+    /// a silence longer than t1.5 between two bytes of the frame
+    const bool broken =
+        std::any_of(gaps_.begin(), gaps_.end(), [&](size_t gap) {
+          return gap > offset && gap < offset + frameSize;
+        });
+    consume(buffer, offset);
+
+    uint8_t *p = nullptr;
+    buffer.ZeroCopyRead(&p, frameSize);
+    adu->setServerAddress(p[0]);
+    adu->setFunctionCode(static_cast<FunctionCode>(p[1]));
+    adu->setData(p + 2, frameSize - 4);
+    if (broken) {
+      error_ = Error::kStorageParityError;
+    } else if (adu->isException()) {
+      error_ = Error(p[2]);
+    }
+    isDone_ = true;
+    candidates_.clear();
+    scanned_ = 0;
+    seen_ = 0;
+    gaps_.clear();
+  }
+
+  /// skip size bytes at the front of buffer, the offsets move with them
+  void consume(pp::bytes::Buffer &buffer, size_t size) {
+    if (size == 0) {
+      return;
+    }
+    uint8_t *p = nullptr;
+    buffer.ZeroCopyRead(&p, size);
+    skippedBytes_ += size;
+    for (auto &candidate : candidates_) {
+      candidate.offset -= size;
+    }
+    scanned_ -= size;
+    gaps_.erase(std::remove_if(gaps_.begin(), gaps_.end(),
+                               [size](size_t gap) { return gap <= size; }),
+                gaps_.end());
+    for (auto &gap : gaps_) {
+      gap -= size;
+    }
+  }
+
   State state_ = State::kServerAddress;
   bool isDone_ = false;
   uint8_t crc_[2];
   CrcCtx crcCtx_;
   Error error_ = Error::kNoError;
   CheckSizeFunc function_;
+  bool resync_ = false;
+  size_t skippedBytes_ = 0;
+  /// the candidates of resync, and the offsets tried so far
+  std::vector<Candidate> candidates_;
+  size_t scanned_ = 0;
+  /// the length of the buffer left by the last resync decode
+  size_t seen_ = 0;
+  /// the silences longer than t1.5 seen by resync, before these offsets
+  std::vector<size_t> gaps_;
+  /// a silence longer than t1.5 inside the frame
+  bool broken_ = false;
+  const CheckSizeFunc exceptionSize_ = bytesRequired<1>;
 };
 
 class ModbusAsciiFrameDecoder : public ModbusFrameDecoder {
@@ -264,8 +489,20 @@ class ModbusMbapFrameDecoder : public ModbusFrameDecoder {
   enum class State { kMBap, kServerAddress, kFunctionCode, kData, kEnd };
 
 public:
-  explicit ModbusMbapFrameDecoder(const CheckSizeFuncTable &table)
-      : ModbusFrameDecoder(table) {
+  /**
+   * with frameByLength, a frame is cut by the length field of the mbap header
+   * only, the check size functions are not used, so the frames of any
+   * function code are decoded, their data is the rest of the pdu
+   */
+  explicit ModbusMbapFrameDecoder(const CheckSizeFuncTable &table,
+                                  bool frameByLength = false)
+      : ModbusFrameDecoder(table), frameByLength_(frameByLength) {
+    Clear();
+  }
+  explicit ModbusMbapFrameDecoder(
+      std::shared_ptr<const CheckSizeFuncTable> table,
+      bool frameByLength = false)
+      : ModbusFrameDecoder(std::move(table)), frameByLength_(frameByLength) {
     Clear();
   }
 
@@ -294,6 +531,14 @@ public:
         if (buffer.Len() < len_) {
           goto exit_function;
         }
+        if (frameByLength_ && len_ < 2) {
+          /// no room for the server address and the function code
+          uint8_t *p;
+          buffer.ZeroCopyRead(&p, len_);
+          error_ = Error::kStorageParityError;
+          state_ = State::kEnd;
+          break;
+        }
 
         const auto serverAddress = buffer.ReadByte();
         adu->setServerAddress(serverAddress);
@@ -304,6 +549,18 @@ public:
         auto functionCode = buffer.ReadByte();
         adu->setFunctionCode(static_cast<FunctionCode>(functionCode));
 
+        if (frameByLength_) {
+          /// the whole frame is in the buffer, see kServerAddress
+          uint8_t *p;
+          const size_t size = buffer.ZeroCopyRead(&p, len_ - 2);
+          adu->setData(p, size);
+          if (adu->isException()) {
+            error_ = size > 0 ? Error(p[0]) : Error::kStorageParityError;
+          }
+          state_ = State::kEnd;
+          break;
+        }
+
         state_ = State::kData;
 
         function_ = adu->isException()
@@ -366,6 +623,7 @@ private:
   CheckSizeFunc function_;
   uint16_t flag_ = 0;
   uint16_t len_ = 0;
+  bool frameByLength_ = false;
 };
 
 class ModbusRtuFrameEncoder : public ModbusFrameEncoder {
@@ -429,18 +687,23 @@ public:
   }
 };
 
+/**
+ * frameByLength is only used by the mbap decoder, see ModbusMbapFrameDecoder,
+ * resync only by the rtu decoder, see ModbusRtuFrameDecoder
+ */
 inline std::unique_ptr<ModbusFrameDecoder>
-createModbusFrameDecoder(TransferMode mode, const CheckSizeFuncTable &table) {
+createModbusFrameDecoder(TransferMode mode, const CheckSizeFuncTable &table,
+                         bool frameByLength = false, bool resync = false) {
   switch (mode) {
   case TransferMode::kRtu:
     return std::unique_ptr<ModbusFrameDecoder>(
-        new ModbusRtuFrameDecoder(table));
+        new ModbusRtuFrameDecoder(table, resync));
   case TransferMode::kAscii:
     return std::unique_ptr<ModbusFrameDecoder>(
         new ModbusAsciiFrameDecoder(table));
   case TransferMode::kMbap:
     return std::unique_ptr<ModbusFrameDecoder>(
-        new ModbusMbapFrameDecoder(table));
+        new ModbusMbapFrameDecoder(table, frameByLength));
   default:
     smart_assert("unsupported modbus transfer mode")(static_cast<int>(mode));
     return nullptr;
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <cstring>
+#include <modbus/base/modbus_register_schema.h>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MODBUS_SSE2 1
+#endif
+
+namespace modbus {
+
+namespace {
+/// values decoded through the stack buffer at a time
+constexpr size_t kBlockValues = 64;
+
+/**
+ * convert count values of registers registers each from the wire layout to
+ * host integers(uint16_t/uint32_t/uint64_t by registers).
+ */
+void normalizeScalar(const uint8_t *src, uint8_t *dst, size_t count,
+                     Quantity registers, bool bigEndianRegister,
+                     bool highWordFirst) {
+  for (size_t i = 0; i < count; i++) {
+    uint64_t value = 0;
+    for (Quantity r = 0; r < registers; r++) {
+      const Quantity w = highWordFirst ? r : registers - 1 - r;
+      const uint8_t *p = src + (i * registers + w) * 2;
+      const uint16_t reg =
+          bigEndianRegister ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+      value = (value << 16) | reg;
+    }
+    if (registers == 1) {
+      const uint16_t v = static_cast<uint16_t>(value);
+      std::memcpy(dst + i * 2, &v, 2);
+    } else if (registers == 2) {
+      const uint32_t v = static_cast<uint32_t>(value);
+      std::memcpy(dst + i * 4, &v, 4);
+    } else {
+      std::memcpy(dst + i * 8, &value, 8);
+    }
+  }
+}
+
+void normalize(const uint8_t *src, uint8_t *dst, size_t count,
+               Quantity registers, bool bigEndianRegister, bool highWordFirst) {
+  size_t done = 0;
+#ifdef MODBUS_SSE2
+  // x86 is little endian, so a value is in host order after swapping the
+  // bytes of each big endian register and reversing the high word first
+  // registers.
+  const size_t bytes = count * registers * 2;
+  const bool reverse = highWordFirst && registers > 1;
+  size_t offset = 0;
+  for (; offset + 16 <= bytes; offset += 16) {
+    __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + offset));
+    if (bigEndianRegister) {
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    }
+    if (reverse && registers == 2) {
+      v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+      v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    } else if (reverse && registers == 4) {
+      v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+      v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + offset), v);
+  }
+  done = offset / (registers * 2);
+#endif
+  normalizeScalar(src + done * registers * 2, dst + done * registers * 2,
+                  count - done, registers, bigEndianRegister, highWordFirst);
+}
+
+template <typename From, typename To>
+void convert(const uint8_t *normalized, To *out, size_t count, float scale) {
+  for (size_t i = 0; i < count; i++) {
+    From value;
+    std::memcpy(&value, normalized + i * sizeof(From), sizeof(From));
+    out[i] = scale == 1 ? static_cast<To>(value)
+                        : static_cast<To>(value * scale);
+  }
+}
+
+template <typename To>
+void convertByType(TagType type, const uint8_t *normalized, To *out,
+                   size_t count, float scale) {
+  switch (type) {
+  case TagType::kUint16:
+    convert<uint16_t>(normalized, out, count, scale);
+    break;
+  case TagType::kInt16:
+    convert<int16_t>(normalized, out, count, scale);
+    break;
+  case TagType::kUint32:
+    convert<uint32_t>(normalized, out, count, scale);
+    break;
+  case TagType::kInt32:
+    convert<int32_t>(normalized, out, count, scale);
+    break;
+  case TagType::kFloat32:
+    convert<float>(normalized, out, count, scale);
+    break;
+  case TagType::kInt64:
+    convert<int64_t>(normalized, out, count, scale);
+    break;
+  case TagType::kString:
+    break;
+  }
+}
+
+template <typename To>
+void decodeBlocks(TagType type, const uint8_t *src, To *out, size_t count,
+                  Quantity registers, bool bigEndianRegister,
+                  bool highWordFirst, float scale) {
+  uint8_t block[kBlockValues * 8];
+  for (size_t i = 0; i < count; i += kBlockValues) {
+    const size_t n = std::min(kBlockValues, count - i);
+    normalize(src + i * registers * 2, block, n, registers, bigEndianRegister,
+              highWordFirst);
+    convertByType(type, block, out + i, n, scale);
+  }
+}
+} // namespace
+
+RegisterSchema::RegisterSchema(const std::vector<RegisterTag> &tags) {
+  compile(tags);
+}
+
+Quantity RegisterSchema::registerCount(const RegisterTag &tag) {
+  switch (tag.type) {
+  case TagType::kUint16:
+  case TagType::kInt16:
+    return 1;
+  case TagType::kUint32:
+  case TagType::kInt32:
+  case TagType::kFloat32:
+    return 2;
+  case TagType::kInt64:
+    return 4;
+  case TagType::kString:
+    return tag.stringRegisters;
+  }
+  return 1;
+}
+
+RegisterSchema::Column RegisterSchema::columnOf(const RegisterTag &tag) {
+  if (tag.type == TagType::kString) {
+    return Column::kString;
+  }
+  if (tag.type == TagType::kFloat32 || tag.scale != 1) {
+    return Column::kFloat;
+  }
+  if (tag.type == TagType::kUint32 || tag.type == TagType::kInt64) {
+    return Column::kInt64;
+  }
+  return Column::kInt32;
+}
+
+void RegisterSchema::compile(const std::vector<RegisterTag> &tags) {
+  tags_ = tags;
+  tagSlots_.clear();
+  runs_.clear();
+  registersRequired_ = 0;
+  std::fill(columnSize_, columnSize_ + 4, 0);
+
+  for (const auto &tag : tags) {
+    const Quantity registers = registerCount(tag);
+    const Column column = columnOf(tag);
+    const size_t slot = columnSize_[static_cast<int>(column)]++;
+    tagSlots_.push_back({column, slot});
+    const bool swapBytes = tag.byteOrder == RegisterByteOrder::kBigEndian;
+    const bool reverseWords =
+        registers > 1 && tag.wordOrder == RegisterWordOrder::kHighWordFirst;
+    registersRequired_ = std::max<Quantity>(registersRequired_,
+                                            tag.offset + registers);
+
+    if (!runs_.empty() && tag.type != TagType::kString) {
+      Run &last = runs_.back();
+      if (last.type == tag.type && last.swapBytes == swapBytes &&
+          last.reverseWords == reverseWords && last.scale == tag.scale &&
+          last.column == column &&
+          last.byteOffset + last.count * registers * 2 ==
+              static_cast<size_t>(tag.offset) * 2) {
+        last.count++;
+        continue;
+      }
+    }
+
+    Run run;
+    run.byteOffset = static_cast<size_t>(tag.offset) * 2;
+    run.count = 1;
+    run.type = tag.type;
+    run.swapBytes = swapBytes;
+    run.reverseWords = reverseWords;
+    run.scale = tag.type == TagType::kString ? 1 : tag.scale;
+    run.column = column;
+    run.slot = slot;
+    run.registers = registers;
+    runs_.push_back(run);
+  }
+}
+
+double RegisterSchema::tagValue(size_t index,
+                                const RegisterValues &values) const {
+  const TagSlot &slot = tagSlots_[index];
+  switch (slot.column) {
+  case Column::kFloat:
+    return values.floats[slot.slot];
+  case Column::kInt32:
+    return values.int32s[slot.slot];
+  case Column::kInt64:
+    return static_cast<double>(values.int64s[slot.slot]);
+  case Column::kString:
+    return 0;
+  }
+  return 0;
+}
+
+bool RegisterSchema::decode(const uint8_t *data, size_t size,
+                            RegisterValues *values) const {
+  if (!values || size < static_cast<size_t>(registersRequired_) * 2) {
+    return false;
+  }
+  values->floats.resize(columnSize_[static_cast<int>(Column::kFloat)]);
+  values->int32s.resize(columnSize_[static_cast<int>(Column::kInt32)]);
+  values->int64s.resize(columnSize_[static_cast<int>(Column::kInt64)]);
+  values->strings.resize(columnSize_[static_cast<int>(Column::kString)]);
+
+  for (const auto &run : runs_) {
+    decodeRun(run, data, values);
+  }
+  return true;
+}
+
+void RegisterSchema::decodeRun(const Run &run, const uint8_t *data,
+                               RegisterValues *values) const {
+  const uint8_t *src = data + run.byteOffset;
+  const bool highWordFirst = run.reverseWords;
+
+  switch (run.column) {
+  case Column::kString: {
+    std::string &s = values->strings[run.slot];
+    s.resize(run.registers * 2);
+    for (size_t i = 0; i < s.size(); i += 2) {
+      s[i] = run.swapBytes ? src[i] : src[i + 1];
+      s[i + 1] = run.swapBytes ? src[i + 1] : src[i];
+    }
+    s.resize(std::strlen(s.c_str()));
+    break;
+  }
+  case Column::kFloat: {
+    float *out = values->floats.data() + run.slot;
+    if (run.type != TagType::kFloat32) {
+      decodeBlocks(run.type, src, out, run.count, run.registers,
+                   run.swapBytes, highWordFirst, run.scale);
+      break;
+    }
+    // same size, decoded in place
+    normalize(src, reinterpret_cast<uint8_t *>(out), run.count, 2,
+              run.swapBytes, highWordFirst);
+    if (run.scale != 1) {
+      for (size_t i = 0; i < run.count; i++) {
+        out[i] *= run.scale;
+      }
+    }
+    break;
+  }
+  case Column::kInt32: {
+    int32_t *out = values->int32s.data() + run.slot;
+    if (run.type == TagType::kInt32) {
+      normalize(src, reinterpret_cast<uint8_t *>(out), run.count, 2,
+                run.swapBytes, highWordFirst);
+    } else {
+      decodeBlocks(run.type, src, out, run.count, run.registers,
+                   run.swapBytes, highWordFirst, 1);
+    }
+    break;
+  }
+  case Column::kInt64: {
+    int64_t *out = values->int64s.data() + run.slot;
+    if (run.type == TagType::kInt64) {
+      normalize(src, reinterpret_cast<uint8_t *>(out), run.count, 4,
+                run.swapBytes, highWordFirst);
+    } else {
+      decodeBlocks(run.type, src, out, run.count, run.registers,
+                   run.swapBytes, highWordFirst, 1);
+    }
+    break;
+  }
+  }
+}
+
+} // namespace modbus
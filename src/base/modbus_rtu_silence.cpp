@@ -0,0 +1,74 @@
+#include <chrono>
+#include <modbus/base/modbus_rtu_silence.h>
+
+namespace modbus {
+
+namespace {
+/// 1 start bit, 8 data bits, parity and 1 stop bit(or no parity, 2 stop bits)
+const int64_t kBitsPerCharacter = 11;
+} // namespace
+
+const size_t RtuSilenceGaps::kNone;
+
+int64_t RtuSilence::now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void RtuSilence::setBaudRate(int baudRate) {
+  if (baudRate <= 0) {
+    baudRate = 9600;
+  }
+  characterTime_ = (kBitsPerCharacter * 1000000 + baudRate - 1) / baudRate;
+  if (baudRate > 19200) {
+    t1_5_ = 750;
+    t3_5_ = 1750;
+    return;
+  }
+  t1_5_ = characterTime_ * 3 / 2;
+  t3_5_ = characterTime_ * 7 / 2;
+}
+
+void RtuSilence::sent(int64_t timestamp, size_t size) {
+  lineIdleAt_ = timestamp + static_cast<int64_t>(size) * characterTime_;
+  waitingResponse_ = true;
+}
+
+void RtuSilence::received(int64_t timestamp, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  const int64_t start = timestamp - static_cast<int64_t>(size) * characterTime_;
+  lastSilence_ = -1;
+  if (lineIdleAt_ >= 0) {
+    lastSilence_ = start > lineIdleAt_ ? start - lineIdleAt_ : 0;
+    if (waitingResponse_) {
+      turnaround_ = lastSilence_;
+    }
+    if (lastSilence_ > t3_5_) {
+      gaps_.interFrame = gaps_.size;
+      gaps_.interCharacter = RtuSilenceGaps::kNone;
+    } else if (lastSilence_ > t1_5_ &&
+               gaps_.interCharacter == RtuSilenceGaps::kNone) {
+      gaps_.interCharacter = gaps_.size;
+    }
+  }
+  waitingResponse_ = false;
+  lineIdleAt_ = timestamp;
+  gaps_.size += size;
+}
+
+RtuSilenceGaps RtuSilence::take() {
+  const RtuSilenceGaps gaps = gaps_;
+  gaps_ = RtuSilenceGaps();
+  return gaps;
+}
+
+void RtuSilence::reset() {
+  lineIdleAt_ = -1;
+  waitingResponse_ = false;
+  gaps_ = RtuSilenceGaps();
+}
+
+} // namespace modbus
@@ -0,0 +1,258 @@
+#include <cstring>
+#include <memory>
+#include <modbus/base/modbus_shared_registers.h>
+#include <thread>
+
+namespace modbus {
+
+namespace {
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "the sequence counters are shared as plain 32 bit words");
+
+struct Header {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t blockRegisters;
+  uint16_t startAddress;
+  uint16_t reserved;
+  uint32_t quantity;
+  uint32_t blockCount;
+};
+
+uint32_t blockCountOf(uint32_t quantity) {
+  return (quantity + SharedRegisters::kBlockRegisters - 1) /
+         SharedRegisters::kBlockRegisters;
+}
+
+size_t dataOffsetOf(uint32_t blockCount) {
+  const size_t end = SharedRegisters::kHeaderSize + blockCount * 4;
+  return (end + 63) / 64 * 64;
+}
+
+/// the tries spinning, then the writer in the other process is let run
+const int kSpinTries = 256;
+/// a block locked for so many tries is taken as left by a dead writer
+const int kMaxTries = 4096;
+
+/// wait a little for a locked block, false once it has taken kMaxTries
+bool backoff(int *tries) {
+  if (++*tries > kMaxTries) {
+    return false;
+  }
+  if (*tries > kSpinTries) {
+    std::this_thread::yield();
+  }
+  return true;
+}
+} // namespace
+
+const uint32_t SharedRegisters::kMagic;
+const uint16_t SharedRegisters::kVersion;
+const Quantity SharedRegisters::kBlockRegisters;
+const size_t SharedRegisters::kHeaderSize;
+
+size_t SharedRegisters::requiredSize(uint32_t quantity) {
+  return dataOffsetOf(blockCountOf(quantity)) + quantity * 2;
+}
+
+bool SharedRegisters::format(uint8_t *memory, size_t size,
+                             Address startAddress, uint32_t quantity) {
+  if (!memory || quantity == 0 || startAddress + quantity > 0x10000 ||
+      size < requiredSize(quantity)) {
+    return false;
+  }
+  std::memset(memory, 0, requiredSize(quantity));
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.blockRegisters = kBlockRegisters;
+  header.startAddress = startAddress;
+  header.quantity = quantity;
+  header.blockCount = blockCountOf(quantity);
+  std::memcpy(memory, &header, sizeof(header));
+  return attach(memory, size);
+}
+
+bool SharedRegisters::attach(uint8_t *memory, size_t size) {
+  memory_ = nullptr;
+  if (!memory || size < kHeaderSize) {
+    return false;
+  }
+  Header header;
+  std::memcpy(&header, memory, sizeof(header));
+  if (header.magic != kMagic || header.version != kVersion ||
+      header.blockRegisters != kBlockRegisters ||
+      header.blockCount != blockCountOf(header.quantity) ||
+      header.startAddress + header.quantity > 0x10000 ||
+      size < requiredSize(header.quantity)) {
+    return false;
+  }
+  memory_ = memory;
+  startAddress_ = header.startAddress;
+  quantity_ = header.quantity;
+  blockCount_ = header.blockCount;
+  dataOffset_ = dataOffsetOf(blockCount_);
+  return true;
+}
+
+bool SharedRegisters::contains(Address address, Quantity quantity) const {
+  return memory_ && quantity > 0 && address >= startAddress_ &&
+         static_cast<uint32_t>(address) + quantity <=
+             static_cast<uint32_t>(startAddress_) + quantity_;
+}
+
+SharedRegisters::Sequence *SharedRegisters::sequence(size_t block) const {
+  return reinterpret_cast<Sequence *>(memory_ + kHeaderSize + block * 4);
+}
+
+size_t SharedRegisters::firstBlock(Address address) const {
+  return (address - startAddress_) / kBlockRegisters;
+}
+
+size_t SharedRegisters::lastBlock(Address address, Quantity quantity) const {
+  return (address - startAddress_ + quantity - 1) / kBlockRegisters;
+}
+
+bool SharedRegisters::read(Address address, Quantity quantity,
+                           uint8_t *out) const {
+  if (!contains(address, quantity)) {
+    return false;
+  }
+  const size_t first = firstBlock(address);
+  const size_t last = lastBlock(address, quantity);
+  const uint8_t *src = data() + (address - startAddress_) * 2;
+  /// a modbus request spans at most 3 blocks, local reads may span more
+  uint32_t stackSeqs[4];
+  std::unique_ptr<uint32_t[]> heapSeqs;
+  uint32_t *seqs = stackSeqs;
+  if (last - first + 1 > 4) {
+    heapSeqs.reset(new uint32_t[last - first + 1]);
+    seqs = heapSeqs.get();
+  }
+
+  int tries = 0;
+  for (;;) {
+    bool locked = false;
+    for (size_t b = first; b <= last; b++) {
+      seqs[b - first] = sequence(b)->load(std::memory_order_acquire);
+      locked = locked || (seqs[b - first] & 1);
+    }
+    if (locked) {
+      if (!backoff(&tries)) {
+        return false;
+      }
+      continue;
+    }
+    std::memcpy(out, src, quantity * 2);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bool moved = false;
+    for (size_t b = first; b <= last && !moved; b++) {
+      moved = sequence(b)->load(std::memory_order_relaxed) != seqs[b - first];
+    }
+    if (!moved) {
+      return true;
+    }
+    if (!backoff(&tries)) {
+      return false;
+    }
+  }
+}
+
+bool SharedRegisters::write(Address address, const uint8_t *values,
+                            Quantity quantity, uint8_t *previous) {
+  if (!contains(address, quantity)) {
+    return false;
+  }
+  const size_t first = firstBlock(address);
+  const size_t last = lastBlock(address, quantity);
+  if (!lock(first, last)) {
+    return false;
+  }
+  uint8_t *dst = data() + (address - startAddress_) * 2;
+  if (previous) {
+    std::memcpy(previous, dst, quantity * 2);
+  }
+  std::memcpy(dst, values, quantity * 2);
+  unlock(first, last, true);
+  return true;
+}
+
+bool SharedRegisters::maskWrite(Address address, uint16_t andMask,
+                                uint16_t orMask, uint16_t *previous) {
+  if (!contains(address, 1)) {
+    return false;
+  }
+  const size_t block = firstBlock(address);
+  if (!lock(block, block)) {
+    return false;
+  }
+  uint8_t *dst = data() + (address - startAddress_) * 2;
+  const uint16_t current = dst[0] * 256 + dst[1];
+  const uint16_t value = (current & andMask) | (orMask & ~andMask);
+  dst[0] = static_cast<uint8_t>(value >> 8);
+  dst[1] = static_cast<uint8_t>(value & 0xFF);
+  if (previous) {
+    *previous = current;
+  }
+  unlock(block, block, true);
+  return true;
+}
+
+bool SharedRegisters::lock(size_t first, size_t last) {
+  /// lock the blocks in ascending order, so two writers never deadlock
+  for (size_t b = first; b <= last; b++) {
+    Sequence *seq = sequence(b);
+    int tries = 0;
+    uint32_t expected = seq->load(std::memory_order_relaxed);
+    for (;;) {
+      if (expected & 1) {
+        if (!backoff(&tries)) {
+          if (b > first) {
+            unlock(first, b - 1, false);
+          }
+          return false;
+        }
+        expected = seq->load(std::memory_order_relaxed);
+        continue;
+      }
+      if (seq->compare_exchange_weak(expected, expected + 1,
+                                     std::memory_order_acquire,
+                                     std::memory_order_relaxed)) {
+        break;
+      }
+    }
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  return true;
+}
+
+void SharedRegisters::unlock(size_t first, size_t last, bool written) {
+  for (size_t b = first; b <= last; b++) {
+    if (written) {
+      sequence(b)->fetch_add(1, std::memory_order_release);
+    } else {
+      /// nothing was written, the counter goes back to where it was
+      sequence(b)->fetch_sub(1, std::memory_order_release);
+    }
+  }
+}
+
+uint32_t SharedRegisters::blockSequence(size_t block) const {
+  return sequence(block)->load(std::memory_order_acquire);
+}
+
+uint16_t SharedRegisters::value(Address address) const {
+  uint8_t bytes[2] = {0, 0};
+  read(address, 1, bytes);
+  return bytes[0] * 256 + bytes[1];
+}
+
+bool SharedRegisters::setValue(Address address, uint16_t value) {
+  const uint8_t bytes[2] = {static_cast<uint8_t>(value >> 8),
+                            static_cast<uint8_t>(value & 0xFF)};
+  return write(address, bytes, 1);
+}
+
+} // namespace modbus
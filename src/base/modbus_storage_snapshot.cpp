@@ -0,0 +1,118 @@
+#include <cstring>
+#include <modbus/base/modbus_storage_snapshot.h>
+
+namespace modbus {
+
+namespace {
+const size_t kHeaderSize = 16;
+const size_t kDescriptorSize = 16;
+
+void putUint16(uint8_t *p, uint16_t value) { std::memcpy(p, &value, 2); }
+void putUint32(uint8_t *p, uint32_t value) { std::memcpy(p, &value, 4); }
+
+uint16_t getUint16(const uint8_t *p) {
+  uint16_t value;
+  std::memcpy(&value, p, 2);
+  return value;
+}
+
+uint32_t getUint32(const uint8_t *p) {
+  uint32_t value;
+  std::memcpy(&value, p, 4);
+  return value;
+}
+
+size_t alignToPage(size_t size) {
+  return (size + StorageSnapshot::kPageSize - 1) / StorageSnapshot::kPageSize *
+         StorageSnapshot::kPageSize;
+}
+
+bool isBitTable(StorageKind kind) {
+  return kind == StorageKind::kCoils || kind == StorageKind::kInputDiscrete;
+}
+} // namespace
+
+const uint32_t StorageSnapshot::kMagic;
+const uint16_t StorageSnapshot::kVersion;
+const int StorageSnapshot::kTableCount;
+const size_t StorageSnapshot::kPageSize;
+
+size_t StorageSnapshot::dataSize(StorageKind kind, uint32_t quantity) {
+  return isBitTable(kind) ? (quantity + 7) / 8 : quantity * 2;
+}
+
+uint32_t StorageSnapshot::valuesPerPage(StorageKind kind) {
+  return isBitTable(kind) ? kPageSize * 8 : kPageSize / 2;
+}
+
+size_t
+StorageSnapshot::requiredSize(const SnapshotTable (&tables)[kTableCount]) {
+  size_t size = kPageSize;
+  for (int i = 0; i < kTableCount; i++) {
+    size += alignToPage(dataSize(static_cast<StorageKind>(i),
+                                 tables[i].quantity));
+  }
+  return size;
+}
+
+bool StorageSnapshot::format(uint8_t *memory, size_t size,
+                             const SnapshotTable (&tables)[kTableCount]) {
+  const size_t required = requiredSize(tables);
+  if (!memory || size < required) {
+    return false;
+  }
+  std::memset(memory, 0, required);
+  putUint32(memory, kMagic);
+  putUint16(memory + 4, kVersion);
+  putUint16(memory + 6, kTableCount);
+
+  size_t offset = kPageSize;
+  for (int i = 0; i < kTableCount; i++) {
+    const size_t tableSize =
+        dataSize(static_cast<StorageKind>(i), tables[i].quantity);
+    uint8_t *descriptor = memory + kHeaderSize + i * kDescriptorSize;
+    putUint16(descriptor, tables[i].startAddress);
+    putUint32(descriptor + 4, tables[i].quantity);
+    putUint32(descriptor + 8, offset);
+    putUint32(descriptor + 12, tableSize);
+    offset += alignToPage(tableSize);
+  }
+  return attach(memory, size);
+}
+
+bool StorageSnapshot::attach(uint8_t *memory, size_t size) {
+  memory_ = nullptr;
+  if (!memory || size < kPageSize || getUint32(memory) != kMagic ||
+      getUint16(memory + 4) != kVersion ||
+      getUint16(memory + 6) != kTableCount) {
+    return false;
+  }
+
+  SnapshotTable tables[kTableCount];
+  size_t offsets[kTableCount];
+  for (int i = 0; i < kTableCount; i++) {
+    const uint8_t *descriptor = memory + kHeaderSize + i * kDescriptorSize;
+    tables[i].startAddress = getUint16(descriptor);
+    tables[i].quantity = getUint32(descriptor + 4);
+    offsets[i] = getUint32(descriptor + 8);
+    const size_t tableSize = getUint32(descriptor + 12);
+    if (tables[i].startAddress + tables[i].quantity > 0x10000 ||
+        tableSize !=
+            dataSize(static_cast<StorageKind>(i), tables[i].quantity) ||
+        offsets[i] < kPageSize || offsets[i] + tableSize > size) {
+      return false;
+    }
+  }
+  if (size < requiredSize(tables)) {
+    return false;
+  }
+
+  memory_ = memory;
+  for (int i = 0; i < kTableCount; i++) {
+    tables_[i] = tables[i];
+    offsets_[i] = offsets[i];
+  }
+  return true;
+}
+
+} // namespace modbus
@@ -0,0 +1,226 @@
+#include <chrono>
+#include <modbus/base/modbus_timer_wheel.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace modbus {
+
+namespace {
+/// x is not 0
+int countTrailingZeros(uint64_t x) {
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanForward64(&index, x);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctzll(x);
+#endif
+}
+
+uint64_t rotateRight(uint64_t x, int n) {
+  return n == 0 ? x : (x >> n) | (x << (64 - n));
+}
+
+/// a slot detached from the wheel, while it is fired or cascaded
+const uint8_t kDetached = TimerWheel::kLevels;
+} // namespace
+
+const int TimerWheel::kLevels;
+const int TimerWheel::kSlotBits;
+const int TimerWheel::kSlots;
+
+void TimerWheel::Timer::cancel() {
+  if (wheel_ != nullptr) {
+    wheel_->cancel(this);
+  }
+}
+
+int64_t TimerWheel::steadyNow() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+TimerWheel::TimerWheel(int64_t tick, const std::function<int64_t()> &clock)
+    : tick_(tick > 0 ? tick : 1), clock_(clock), origin_(clock_()) {
+  for (auto &level : slots_) {
+    for (auto &slot : level) {
+      slot.prev = &slot;
+      slot.next = &slot;
+    }
+  }
+}
+
+TimerWheel::~TimerWheel() {
+  for (auto &level : slots_) {
+    for (auto &slot : level) {
+      for (Link *link = slot.next; link != &slot;) {
+        Timer *timer = static_cast<Timer *>(link);
+        link = link->next;
+        timer->prev = nullptr;
+        timer->next = nullptr;
+        timer->wheel_ = nullptr;
+      }
+    }
+  }
+}
+
+void TimerWheel::schedule(Timer *timer, int64_t delay) {
+  if (timer->wheel_ != nullptr) {
+    timer->wheel_->cancel(timer);
+  }
+  const int64_t expiry = clock_() + (delay > 0 ? delay : 0) - origin_;
+  timer->expiry_ = (expiry + tick_ - 1) / tick_;
+  if (timer->expiry_ <= current_) {
+    timer->expiry_ = current_ + 1;
+  }
+  timer->wheel_ = this;
+  size_++;
+  insert(timer);
+}
+
+void TimerWheel::cancel(Timer *timer) {
+  if (timer->wheel_ != this) {
+    return;
+  }
+  unlink(timer);
+  timer->wheel_ = nullptr;
+  size_--;
+}
+
+size_t TimerWheel::advance() {
+  const int64_t target = (clock_() - origin_) / tick_;
+  size_t fired = 0;
+  while (current_ < target && size_ > 0) {
+    if (occupied_[0] != 0) {
+      current_++;
+    } else {
+      /// nothing fires before level 0 wraps around
+      const int64_t wrap = ((current_ >> kSlotBits) + 1) << kSlotBits;
+      if (wrap > target) {
+        break;
+      }
+      current_ = wrap;
+    }
+    fired += step();
+  }
+  /// nothing to fire on the way
+  if (current_ < target) {
+    current_ = target;
+  }
+  return fired;
+}
+
+int64_t TimerWheel::nextExpiry() const {
+  if (size_ == 0) {
+    return -1;
+  }
+  int64_t next = -1;
+  for (int level = 0; level < kLevels; level++) {
+    if (occupied_[level] == 0) {
+      continue;
+    }
+    const int shift = level * kSlotBits;
+    /**
+     * the slots of level 0 fire at their tick, the slots above move down at
+     * the start of their span
+     */
+    const int64_t base = level == 0 ? current_ + 1 : (current_ >> shift) + 1;
+    const int distance = countTrailingZeros(
+        rotateRight(occupied_[level], static_cast<int>(base & (kSlots - 1))));
+    const int64_t at = (base + distance) << shift;
+    if (next < 0 || at < next) {
+      next = at;
+    }
+  }
+  return origin_ + next * tick_;
+}
+
+void TimerWheel::insert(Timer *timer) {
+  const int64_t delta = timer->expiry_ - current_;
+  int level = 0;
+  int64_t expiry = timer->expiry_;
+  while (level < kLevels - 1 &&
+         delta >= (int64_t(1) << ((level + 1) * kSlotBits))) {
+    level++;
+  }
+  if (delta >= (int64_t(1) << (kLevels * kSlotBits))) {
+    /// beyond the last level, it waits in the farthest slot
+    expiry = current_ + (int64_t(1) << (kLevels * kSlotBits)) - 1;
+  }
+  const int slot = static_cast<int>((expiry >> (level * kSlotBits)) &
+                                    (kSlots - 1));
+  Link &head = slots_[level][slot];
+  timer->prev = head.prev;
+  timer->next = &head;
+  head.prev->next = timer;
+  head.prev = timer;
+  timer->level_ = static_cast<uint8_t>(level);
+  timer->slot_ = static_cast<uint8_t>(slot);
+  occupied_[level] |= uint64_t(1) << slot;
+}
+
+void TimerWheel::unlink(Timer *timer) {
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->prev = nullptr;
+  timer->next = nullptr;
+  if (timer->level_ == kDetached) {
+    return;
+  }
+  const Link &head = slots_[timer->level_][timer->slot_];
+  if (head.next == &head) {
+    occupied_[timer->level_] &= ~(uint64_t(1) << timer->slot_);
+  }
+}
+
+size_t TimerWheel::cascade(int level, int slot) {
+  Link &head = slots_[level][slot];
+  if (head.next == &head) {
+    return 0;
+  }
+  /// detach the slot, the callbacks may touch the timers in it
+  Link detached;
+  detached.next = head.next;
+  detached.prev = head.prev;
+  detached.next->prev = &detached;
+  detached.prev->next = &detached;
+  head.next = &head;
+  head.prev = &head;
+  occupied_[level] &= ~(uint64_t(1) << slot);
+  for (Link *link = detached.next; link != &detached; link = link->next) {
+    static_cast<Timer *>(link)->level_ = kDetached;
+  }
+
+  size_t fired = 0;
+  while (detached.next != &detached) {
+    Timer *timer = static_cast<Timer *>(detached.next);
+    unlink(timer);
+    if (level > 0) {
+      insert(timer);
+      continue;
+    }
+    timer->wheel_ = nullptr;
+    size_--;
+    fired++;
+    if (timer->callback_) {
+      timer->callback_();
+    }
+  }
+  return fired;
+}
+
+size_t TimerWheel::step() {
+  for (int level = 1; level < kLevels; level++) {
+    const int shift = level * kSlotBits;
+    if ((current_ & ((int64_t(1) << shift) - 1)) != 0) {
+      break;
+    }
+    cascade(level, static_cast<int>((current_ >> shift) & (kSlots - 1)));
+  }
+  return cascade(0, static_cast<int>(current_ & (kSlots - 1)));
+}
+
+} // namespace modbus
@@ -1,5 +1,7 @@
 #include "modbus_client_p.h"
 #include "modbus_url_parser.h"
+#include <QCoreApplication>
+#include <QEvent>
 #include <QTimer>
 #include <algorithm>
 #include <assert.h>
@@ -7,10 +9,16 @@
 #include <modbus/base/modbus_tool.h>
 #include <modbus/base/single_bit_access.h>
 #include <modbus/base/smart_assert.h>
+#include <modbus/tools/modbus_termios_serialport.h>
 #include <modbus_frame.h>
 
 namespace modbus {
 
+namespace {
+const QEvent::Type kRequestsSubmittedEvent =
+    static_cast<QEvent::Type>(QEvent::registerEventType());
+} // namespace
+
 static QVector<SixteenBitValue>
 toSixteenBitValueList(const SixteenBitAccess &access);
 static ByteArray toBitValueList(const SingleBitAccess &access);
@@ -22,11 +30,13 @@ struct ReadWriteRegistersAccess {
 
 QModbusClient::QModbusClient(AbstractIoDevice *iodevice, QObject *parent)
     : QObject(parent), d_ptr(new QModbusClientPrivate(iodevice, this)) {
+  d_ptr->q_ptr = this;
   setupEnvironment();
 }
 
 QModbusClient::QModbusClient(QObject *parent)
     : QObject(parent), d_ptr(new QModbusClientPrivate(nullptr, parent)) {
+  d_ptr->q_ptr = this;
   setupEnvironment();
 }
 
@@ -50,21 +60,71 @@ void QModbusClient::close() {
 void QModbusClient::sendRequest(std::unique_ptr<Request> &request) {
   Q_D(QModbusClient);
 
-  if (!isOpened()) {
-    log(d->log_prefix_, LogLevel::kWarning, "{} closed, discard reuqest",
-        d->device_->name());
+  if (!d->checkOpened()) {
     return;
   }
 
   /*just queue the request, when the session state is in idle, it will be sent
    * out*/
-  auto *element = d->enqueueAndPeekLastElement();
+  auto *element = d->elementPool_.acquire();
   createElement(request, element);
+  d->enqueueElement(element);
+}
 
-  element->retryTimes = d->retryTimes_;
-  d->scheduleNextRequest(d->t3_5_);
+void QModbusClient::submitRequest(const Request &request,
+                                  const RequestCompletion &completion,
+                                  const Executor &executor) {
+  Q_D(QModbusClient);
+
+  auto *submitted = new SubmittedRequest();
+  submitted->request = request;
+  if (completion && executor) {
+    /// the task runs later, it holds copies of the request and the response
+    submitted->completion = [completion, executor](const Request &request,
+                                                   const Response &response) {
+      executor([completion, request, response]() {
+        completion(request, response);
+      });
+    };
+  } else {
+    submitted->completion = completion;
+  }
+  d->submitted_.push(submitted);
+  if (!d->submitPending_.exchange(true)) {
+    QCoreApplication::postEvent(this, new QEvent(kRequestsSubmittedEvent));
+  }
+}
+
+bool QModbusClient::event(QEvent *e) {
+  Q_D(QModbusClient);
+  if (e->type() != kRequestsSubmittedEvent) {
+    return QObject::event(e);
+  }
+  /// the requests submitted after it post the event again
+  d->submitPending_.store(false);
+  while (SubmittedRequest *submitted = d->submitted_.pop()) {
+    if (d->checkOpened()) {
+      auto *element = d->elementPool_.acquire();
+      if (element->request) {
+        *element->request = std::move(submitted->request);
+      } else {
+        element->request.reset(new Request(std::move(submitted->request)));
+      }
+      element->completion = std::move(submitted->completion);
+      d->enqueueElement(element);
+    } else {
+      d->completeUnanswered(submitted->request, submitted->completion,
+                            Error::kTimeout);
+    }
+    delete submitted;
+  }
+  return true;
 }
 
+/**
+ * the apis below build the request on a pooled element, so the request, its
+ * user data and their buffers are reused by the next call.
+ */
 void QModbusClient::readSingleBits(ServerAddress serverAddress,
                                    FunctionCode functionCode,
                                    Address startAddress, Quantity quantity) {
@@ -76,46 +136,61 @@ void QModbusClient::readSingleBits(ServerAddress serverAddress,
         "single bit access:[read] invalid function code(" +
             std::to_string(functionCode) + ")");
   }
+  if (!d->checkOpened()) {
+    return;
+  }
 
-  SingleBitAccess access;
+  auto *element = d->elementPool_.acquire();
+  auto *access =
+      d->prepareElement<SingleBitAccess>(element, serverAddress, functionCode);
 
-  access.setStartAddress(startAddress);
-  access.setQuantity(quantity);
-
-  std::unique_ptr<Request> request(new Request(
-      serverAddress, functionCode, access, access.marshalReadRequest()));
-  sendRequest(request);
+  access->setStartAddress(startAddress);
+  access->setQuantity(quantity);
+  access->marshalReadRequest(element->request->mutableData());
+  d->enqueueElement(element);
 }
 
 void QModbusClient::writeSingleCoil(ServerAddress serverAddress,
                                     Address startAddress, bool value) {
-  SingleBitAccess access;
+  Q_D(QModbusClient);
 
-  access.setStartAddress(startAddress);
-  access.setQuantity(1);
-  access.setValue(value);
-  std::unique_ptr<Request> request(
-      new Request(serverAddress, FunctionCode::kWriteSingleCoil, access,
-                  access.marshalSingleWriteRequest()));
-  sendRequest(request);
+  if (!d->checkOpened()) {
+    return;
+  }
+
+  auto *element = d->elementPool_.acquire();
+  auto *access = d->prepareElement<SingleBitAccess>(
+      element, serverAddress, FunctionCode::kWriteSingleCoil);
+
+  access->setStartAddress(startAddress);
+  access->setQuantity(1);
+  access->setValue(value);
+  access->marshalSingleWriteRequest(element->request->mutableData());
+  d->enqueueElement(element);
 }
 
 void QModbusClient::writeMultipleCoils(ServerAddress serverAddress,
                                        Address startAddress,
                                        const QVector<uint8_t> &valueList) {
-  SingleBitAccess access;
+  Q_D(QModbusClient);
 
-  access.setStartAddress(startAddress);
-  access.setQuantity(valueList.size());
+  if (!d->checkOpened()) {
+    return;
+  }
+
+  auto *element = d->elementPool_.acquire();
+  auto *access = d->prepareElement<SingleBitAccess>(
+      element, serverAddress, FunctionCode::kWriteMultipleCoils);
+
+  access->setStartAddress(startAddress);
+  access->setQuantity(valueList.size());
   for (int offset = 0; offset < valueList.size(); offset++) {
     Address address = startAddress + offset;
-    access.setValue(address, valueList[offset]);
+    access->setValue(address, valueList[offset]);
   }
 
-  std::unique_ptr<Request> request(
-      new Request(serverAddress, FunctionCode::kWriteMultipleCoils, access,
-                  access.marshalMultipleWriteRequest()));
-  sendRequest(request);
+  access->marshalMultipleWriteRequest(element->request->mutableData());
+  d->enqueueElement(element);
 }
 
 void QModbusClient::readRegisters(ServerAddress serverAddress,
@@ -129,77 +204,207 @@ void QModbusClient::readRegisters(ServerAddress serverAddress,
         "invalid function code for read registers" +
             std::to_string(functionCode));
   }
+  if (!d->checkOpened()) {
+    return;
+  }
 
-  SixteenBitAccess access;
-
-  access.setStartAddress(startAddress);
-  access.setQuantity(quantity);
+  auto *element = d->elementPool_.acquire();
+  auto *access =
+      d->prepareElement<SixteenBitAccess>(element, serverAddress, functionCode);
 
-  std::unique_ptr<Request> request(
-      new Request(serverAddress, functionCode, access,
-                  access.marshalMultipleReadRequest()));
-  sendRequest(request);
+  access->setStartAddress(startAddress);
+  access->setQuantity(quantity);
+  access->marshalMultipleReadRequest(element->request->mutableData());
+  d->enqueueElement(element);
 }
 
 void QModbusClient::writeSingleRegister(ServerAddress serverAddress,
                                         Address address,
                                         const SixteenBitValue &value) {
-  SixteenBitAccess access;
+  Q_D(QModbusClient);
+
+  if (!d->checkOpened()) {
+    return;
+  }
+
+  auto *element = d->elementPool_.acquire();
+  auto *access = d->prepareElement<SixteenBitAccess>(
+      element, serverAddress, FunctionCode::kWriteSingleRegister);
+
+  access->setStartAddress(address);
+  access->setQuantity(1);
+  access->setValue(value.toUint16());
+  access->marshalSingleWriteRequest(element->request->mutableData());
+  d->enqueueElement(element);
+}
+
+void QModbusClient::maskWriteRegister(ServerAddress serverAddress,
+                                      Address address, uint16_t andMask,
+                                      uint16_t orMask) {
+  Q_D(QModbusClient);
 
-  access.setStartAddress(address);
-  access.setValue(value.toUint16());
+  if (!d->checkOpened()) {
+    return;
+  }
+
+  auto *element = d->elementPool_.acquire();
+  auto *access = d->prepareElement<SixteenBitAccess>(
+      element, serverAddress, FunctionCode::kMaskWriteRegister);
 
-  std::unique_ptr<Request> request(
-      new Request(serverAddress, FunctionCode::kWriteSingleRegister, access,
-                  access.marshalSingleWriteRequest()));
-  sendRequest(request);
+  access->setStartAddress(address);
+  access->setQuantity(1);
+  access->marshalMaskWriteRequest(andMask, orMask,
+                                  element->request->mutableData());
+  d->enqueueElement(element);
 }
 
 void QModbusClient::writeMultipleRegisters(
     ServerAddress serverAddress, Address startAddress,
     const QVector<SixteenBitValue> &valueList) {
-  SixteenBitAccess access;
+  Q_D(QModbusClient);
 
-  access.setStartAddress(startAddress);
-  access.setQuantity(valueList.size());
+  if (!d->checkOpened()) {
+    return;
+  }
+
+  auto *element = d->elementPool_.acquire();
+  auto *access = d->prepareElement<SixteenBitAccess>(
+      element, serverAddress, FunctionCode::kWriteMultipleRegisters);
+
+  access->setStartAddress(startAddress);
+  access->setQuantity(valueList.size());
 
   int offset = 0;
   for (const auto &sixValue : valueList) {
-    auto address = access.startAddress() + offset;
-    access.setValue(address, sixValue.toUint16());
+    auto address = access->startAddress() + offset;
+    access->setValue(address, sixValue.toUint16());
     offset++;
   }
-  std::unique_ptr<Request> request(
-      new Request(serverAddress, FunctionCode::kWriteMultipleRegisters, access,
-                  access.marshalMultipleWriteRequest()));
-  sendRequest(request);
+  access->marshalMultipleWriteRequest(element->request->mutableData());
+  d->enqueueElement(element);
 }
 
 void QModbusClient::readWriteMultipleRegisters(
     ServerAddress serverAddress, Address readStartAddress,
     Quantity readQuantity, Address writeStartAddress,
     const QVector<SixteenBitValue> &valueList) {
-  ReadWriteRegistersAccess access;
+  Q_D(QModbusClient);
 
-  access.readAccess.setStartAddress(readStartAddress);
-  access.readAccess.setQuantity(readQuantity);
+  if (!d->checkOpened()) {
+    return;
+  }
+
+  auto *element = d->elementPool_.acquire();
+  auto *access = d->prepareElement<ReadWriteRegistersAccess>(
+      element, serverAddress, FunctionCode::kReadWriteMultipleRegisters);
 
-  access.writeAccess.setStartAddress(writeStartAddress);
-  access.writeAccess.setQuantity(valueList.size());
+  access->readAccess.setStartAddress(readStartAddress);
+  access->readAccess.setQuantity(readQuantity);
+
+  access->writeAccess.setStartAddress(writeStartAddress);
+  access->writeAccess.setQuantity(valueList.size());
 
   int offset = 0;
   for (const auto &value : valueList) {
     auto address = writeStartAddress + offset++;
-    access.writeAccess.setValue(address, value.toUint16());
+    access->writeAccess.setValue(address, value.toUint16());
   }
 
-  ByteArray data = access.readAccess.marshalMultipleReadRequest();
-  ByteArray writeData = access.writeAccess.marshalMultipleWriteRequest();
+  ByteArray *data = element->request->mutableData();
+  access->readAccess.marshalMultipleReadRequest(data);
+  /// the write part is appended after the read part
+  auto &writeData = d->scratchArray_;
+  access->writeAccess.marshalMultipleWriteRequest(&writeData);
+  data->insert(data->end(), writeData.begin(), writeData.end());
+  d->enqueueElement(element);
+}
 
-  data.insert(data.end(), writeData.begin(), writeData.end());
-  std::unique_ptr<Request> request(new Request(
-      serverAddress, FunctionCode::kReadWriteMultipleRegisters, access, data));
-  sendRequest(request);
+PreparedRequestPtr QModbusClient::prepareRequest(const Request &request) {
+  Q_D(QModbusClient);
+
+  pp::bytes::Buffer buffer;
+  d->encoder_->Encode(&request, buffer);
+
+  std::shared_ptr<PreparedRequest> prepared(new PreparedRequest());
+  prepared->request = request;
+  prepared->transferMode = d->transferMode_;
+
+  uint8_t *p = nullptr;
+  int len = buffer.Len();
+  buffer.ZeroCopyRead(&p, len);
+  prepared->frame.assign(p, p + len);
+  return prepared;
+}
+
+PreparedRequestPtr QModbusClient::prepareReadSingleBits(
+    ServerAddress serverAddress, FunctionCode functionCode,
+    Address startAddress, Quantity quantity) {
+  SingleBitAccess access;
+
+  access.setStartAddress(startAddress);
+  access.setQuantity(quantity);
+
+  return prepareRequest(Request(serverAddress, functionCode, access,
+                                access.marshalReadRequest()));
+}
+
+PreparedRequestPtr QModbusClient::prepareReadRegisters(
+    ServerAddress serverAddress, FunctionCode functionCode,
+    Address startAddress, Quantity quantity) {
+  SixteenBitAccess access;
+
+  access.setStartAddress(startAddress);
+  access.setQuantity(quantity);
+
+  return prepareRequest(Request(serverAddress, functionCode, access,
+                                access.marshalMultipleReadRequest()));
+}
+
+void QModbusClient::sendPreparedRequest(const PreparedRequestPtr &prepared) {
+  Q_D(QModbusClient);
+
+  if (!prepared || !d->checkOpened()) {
+    return;
+  }
+  if (prepared->transferMode != d->transferMode_) {
+    log(d->log_prefix_, LogLevel::kError,
+        "{} the request was prepared for another transfer mode, discard it",
+        d->device_->name());
+    return;
+  }
+
+  auto *element = d->elementPool_.acquire();
+  element->prepared = prepared;
+  d->enqueueElement(element);
+}
+
+void QModbusClient::enableChangeFilter(const PreparedRequestPtr &poll) {
+  Q_D(QModbusClient);
+
+  if (!QModbusClientPrivate::canFilterChanges(poll)) {
+    return;
+  }
+  d->changeFilters_[poll.get()] = {poll, std::make_shared<ChangeFilter>()};
+}
+
+void QModbusClient::enableChangeFilter(const PreparedRequestPtr &poll,
+                                       const RegisterSchema &schema) {
+  Q_D(QModbusClient);
+
+  if (!QModbusClientPrivate::canFilterChanges(poll)) {
+    return;
+  }
+  d->changeFilters_[poll.get()] = {poll,
+                                   std::make_shared<ChangeFilter>(schema)};
+}
+
+void QModbusClient::disableChangeFilter(const PreparedRequestPtr &poll) {
+  Q_D(QModbusClient);
+
+  if (!poll) {
+    return;
+  }
+  d->changeFilters_.erase(poll.get());
 }
 
 bool QModbusClient::isIdle() {
@@ -230,6 +435,7 @@ void QModbusClient::setupEnvironment() {
   qRegisterMetaType<QVector<uint8_t>>("QVector<uint8_t>");
   qRegisterMetaType<FunctionCode>("FunctionCode");
   qRegisterMetaType<Quantity>("Quantity");
+  qRegisterMetaType<QVector<AddressRange>>("QVector<AddressRange>");
 
   Q_D(QModbusClient);
 
@@ -250,8 +456,6 @@ void QModbusClient::setupEnvironment() {
           &QModbusClient::onIoDeviceBytesWritten, Qt::QueuedConnection);
   connect(d->device_, &ReconnectableIoDevice::readyRead, this,
           &QModbusClient::onIoDeviceReadyRead, Qt::QueuedConnection);
-  connect(d->waitResponseTimer_, &QTimer::timeout, this,
-          &QModbusClient::onIoDeviceResponseTimeout, Qt::QueuedConnection);
   connect(this, &QModbusClient::requestFinished, this,
           &QModbusClient::processResponseAnyFunctionCode, Qt::QueuedConnection);
 }
@@ -272,7 +476,8 @@ void QModbusClient::setTransferMode(TransferMode transferMode) {
   Q_D(QModbusClient);
 
   d->transferMode_ = transferMode;
-  d->decoder_ = createModbusFrameDecoder(transferMode, d->checkSizeFuncTable_);
+  d->decoder_ = createModbusFrameDecoder(transferMode, d->checkSizeFuncTable_,
+                                         false, d->enableRtuResync_);
   d->encoder_ = createModbusFrameEncoder(transferMode);
 }
 
@@ -318,14 +523,15 @@ void QModbusClient::setFrameInterval(int frameInterval) {
 
 void QModbusClient::clearPendingRequest() {
   Q_D(QModbusClient);
-  while (!d->elementQueue_.empty()) {
-    auto e = d->elementQueue_.front();
-    d->elementQueue_.pop_front();
-    delete e;
-  }
-  d->waitTimerAlive_ = false;
-  d->waitResponseTimer_->stop();
+  /// a completion may queue a request, the queue is left clean before
+  ElementQueue dropped;
+  dropped.swap(d->elementQueue_);
+  d->singleFlight_.clear();
+  d->waitResponseTimer_.cancel();
   d->sessionState_.setState(SessionState::kIdle);
+  for (auto e : dropped) {
+    d->completeUnanswered(e, Error::kTimeout);
+  }
 }
 
 size_t QModbusClient::pendingRequestSize() {
@@ -352,6 +558,41 @@ void QModbusClient::enableDiagnosis(bool enable) {
   d->enableDiagnosis_ = enable;
 }
 
+void QModbusClient::enableSingleFlight(bool enable) {
+  Q_D(QModbusClient);
+  d->enableSingleFlight_ = enable;
+  if (!enable) {
+    /// the joined reads still complete with the one they joined
+    for (auto &item : d->singleFlight_) {
+      item.second->singleFlight = false;
+    }
+    d->singleFlight_.clear();
+  }
+}
+
+void QModbusClient::enableWriteCoalescing(bool enable) {
+  Q_D(QModbusClient);
+  d->enableWriteCoalescing_ = enable;
+}
+
+void QModbusClient::enableRtuResync(bool enable) {
+  Q_D(QModbusClient);
+  d->enableRtuResync_ = enable;
+  d->decoder_ = createModbusFrameDecoder(d->transferMode_,
+                                         d->checkSizeFuncTable_, false, enable);
+}
+
+void QModbusClient::enableRtuSilenceDetection(bool enable) {
+  Q_D(QModbusClient);
+  d->enableRtuSilenceDetection_ = enable;
+}
+
+int64_t QModbusClient::turnaround() {
+  Q_D(QModbusClient);
+  RtuSilence *silence = d->device_->silence();
+  return silence ? silence->turnaround() : -1;
+}
+
 void QModbusClient::enableDump(bool enable) {
   Q_D(QModbusClient);
   if (d->enableDump_ == enable) {
@@ -365,27 +606,36 @@ RuntimeDiagnosis QModbusClient::runtimeDiagnosis() const {
   return d->runtimeDiagnosis_;
 }
 
-void QModbusClient::onIoDeviceResponseTimeout() {
+void QModbusClient::setResponseCacheTtl(int ttl) {
   Q_D(QModbusClient);
+  d->responseCache_.setTtl(ttl);
+}
 
-  /**
-   * @brief when the request is sent, the client will start a timer, until
-   * response is got. but,sometimes we got a response successfully,and the timer
-   * is timeout too, although we explicit stoped the timer and set state into
-   * `idle`, but the `timeout` event has been enqueued into eventloop,call
-   * `timer.stop()` operation does not work. in this case, we must use a flag
-   * indicates the timer had stopped
-   * */
-  if (!d->waitTimerAlive_) {
-    return;
-  }
+int QModbusClient::responseCacheTtl() const {
+  const Q_D(QModbusClient);
+  return d->responseCache_.ttl();
+}
+
+uint64_t QModbusClient::responseCacheHits() const {
+  const Q_D(QModbusClient);
+  return d->responseCache_.hits();
+}
+
+uint64_t QModbusClient::responseCacheMisses() const {
+  const Q_D(QModbusClient);
+  return d->responseCache_.misses();
+}
+
+void QModbusClient::onIoDeviceResponseTimeout() {
+  Q_D(QModbusClient);
 
+  /// called by the timer wheel, a timer cancelled is never fired late
   smart_assert(d->sessionState_.state() ==
                SessionState::kWaitingResponse)(d->sessionState_.state());
 
   auto &element = d->elementQueue_.front();
   element->bytesWritten = 0;
-  element->dumpReadArray.clear();
+  element->dumpReadArray.resize(0);
   d->decoder_->Clear();
 
   /**
@@ -397,12 +647,12 @@ void QModbusClient::onIoDeviceResponseTimeout() {
    */
   d->sessionState_.setState(SessionState::kIdle);
 
-  const auto &request = *element->request;
+  const auto &request = element->currentRequest();
   auto &response = element->response;
 
   response.setServerAddress(request.serverAddress());
   response.setFunctionCode(request.functionCode());
-  response.setTransactionId(request.transactionId());
+  response.setTransactionId(element->transactionId);
   response.setError(Error::kTimeout);
   if (element->retryTimes-- > 0) {
     log(d->log_prefix_, LogLevel::kWarning,
@@ -419,8 +669,7 @@ void QModbusClient::onIoDeviceResponseTimeout() {
      */
     auto e = d->elementQueue_.front();
     d->elementQueue_.pop_front();
-    emit requestFinished(*e->request, e->response);
-    delete e;
+    d->completeElement(e);
   }
   d->scheduleNextRequest(d->t3_5_);
 }
@@ -433,26 +682,39 @@ void QModbusClient::onIoDeviceReadyRead() {
    * state. Therefore, if data is received but not in the wait-response state,
    * then this data is not what we want,discard them
    */
-  auto qdata = d->device_->readAll();
-  d->readBuffer_.Write(qdata.data(), qdata.size());
+  const size_t offset = d->readBuffer_.Len();
+  const size_t size = d->device_->readInto(d->readBuffer_);
+  /// the bytes just received, still owned by readBuffer_
+  char *received = nullptr;
+  d->readBuffer_.ZeroCopyPeekAt(&received, offset, size);
+  /// always taken, so the gaps do not pile up while it is disabled
+  RtuSilenceGaps gaps;
+  if (RtuSilence *silence = d->device_->silence()) {
+    gaps = silence->take();
+  }
   if (d->sessionState_.state() != SessionState::kWaitingResponse) {
-    d->readBuffer_.Reset();
-
     std::stringstream stream;
     stream << d->sessionState_.state();
     log(d->log_prefix_, LogLevel::kWarning,
         "{} now state is in {}.got unexpected data, discard them.[{}]",
-        d->device_->name(), stream.str(), dump(d->transferMode_, qdata));
+        d->device_->name(), stream.str(),
+        dump(d->transferMode_, received, static_cast<int>(size)));
 
+    d->readBuffer_.Reset();
     d->device_->clear();
     return;
   }
 
   auto &element = d->elementQueue_.front();
-  auto &request = element->request;
+  const auto &request = element->currentRequest();
 
   if (d->enableDump_) {
-    element->dumpReadArray.append(qdata);
+    element->dumpReadArray.append(received, static_cast<int>(size));
+  }
+
+  /// the bytes read after the last timestamp have no gap in them yet
+  if (d->enableRtuSilenceDetection_ && !gaps.empty() && gaps.size <= size) {
+    d->decoder_->Silence(d->readBuffer_, offset, gaps);
   }
 
   d->decoder_->Decode(d->readBuffer_, &element->response);
@@ -466,8 +728,8 @@ void QModbusClient::onIoDeviceReadyRead() {
   const auto lastError = d->decoder_->LasError();
   d->decoder_->Clear();
 
-  // replace with swap/move
-  Response response = element->response;
+  /// the element is released after the signal, no need to copy it
+  Response &response = element->response;
   if (lastError != Error::kNoError) {
     response.setError(lastError);
   }
@@ -477,41 +739,40 @@ void QModbusClient::onIoDeviceReadyRead() {
    * Should continue to time out
    * discard all recived dat
    */
-  if (response.serverAddress() != request->serverAddress()) {
+  if (response.serverAddress() != request.serverAddress()) {
     log(d->log_prefix_, LogLevel::kWarning,
         d->device_->name() +
             ":got response, unexpected serveraddress, discard it.[" +
-            dump(d->transferMode_, qdata) + "]");
+            dump(d->transferMode_, received, static_cast<int>(size)) + "]");
 
     d->readBuffer_.Reset();
 
     return;
   }
 
-  if (response.functionCode() != request->functionCode()) {
+  if (response.functionCode() != request.functionCode()) {
     log(d->log_prefix_, LogLevel::kWarning,
         d->device_->name() +
             ":got response, unexpected functioncode, discard it.[" +
-            dump(d->transferMode_, qdata) + "]");
+            dump(d->transferMode_, received, static_cast<int>(size)) + "]");
 
     d->readBuffer_.Reset();
 
     return;
   }
 
-  if (response.transactionId() != request->transactionId()) {
+  if (response.transactionId() != element->transactionId) {
     log(d->log_prefix_, LogLevel::kWarning,
         d->device_->name() +
             ":got response, unexpected transaction Id, discard it.[" +
-            dump(d->transferMode_, qdata) + "]");
+            dump(d->transferMode_, received, static_cast<int>(size)) + "]");
 
     d->readBuffer_.Reset();
 
     return;
   }
 
-  d->waitTimerAlive_ = false;
-  d->waitResponseTimer_->stop();
+  d->waitResponseTimer_.cancel();
   d->sessionState_.setState(SessionState::kIdle);
 
   if (d->enableDump_) {
@@ -529,8 +790,11 @@ void QModbusClient::onIoDeviceReadyRead() {
    */
   auto e = d->elementQueue_.front();
   d->elementQueue_.pop_front();
-  emit requestFinished(*e->request, response);
-  delete e;
+  if (d->responseCache_.enabled()) {
+    d->responseCache_.store(e->currentRequest(), response);
+    d->responseCache_.invalidate(e->currentRequest());
+  }
+  d->completeElement(e);
   d->scheduleNextRequest(d->t3_5_);
 }
 
@@ -543,22 +807,22 @@ void QModbusClient::onIoDeviceBytesWritten(qint16 bytes) {
 
   /*check the request is sent done*/
   auto &element = d->elementQueue_.front();
-  auto &request = element->request;
   element->bytesWritten += bytes;
   if (element->bytesWritten != element->totalBytes) {
     return;
   }
 
-  if (request->isBrocast()) {
+  if (element->currentRequest().isBrocast()) {
     auto e = d->elementQueue_.front();
     d->elementQueue_.pop_front();
-    delete e;
+    d->responseCache_.invalidate(e->currentRequest());
     d->sessionState_.setState(SessionState::kIdle);
     d->decoder_->Clear();
     d->scheduleNextRequest(d->waitConversionDelay_);
 
     log(d->log_prefix_, LogLevel::kWarning,
         d->device_->name() + " brocast request, turn into idle status");
+    d->completeUnanswered(e, Error::kNoError);
     return;
   }
 
@@ -570,10 +834,7 @@ void QModbusClient::onIoDeviceBytesWritten(qint16 bytes) {
    * (return to the user).
    */
   d->sessionState_.setState(SessionState::kWaitingResponse);
-  d->waitResponseTimer_->setSingleShot(true);
-  d->waitResponseTimer_->setInterval(d->waitResponseTimeout_);
-  d->waitTimerAlive_ = true;
-  d->waitResponseTimer_->start();
+  d->timerWheel().schedule(&d->waitResponseTimer_, d->waitResponseTimeout_);
 }
 
 void QModbusClient::onIoDeviceError(const QString &errorString) {
@@ -581,14 +842,7 @@ void QModbusClient::onIoDeviceError(const QString &errorString) {
 
   d->errorString_ = errorString;
 
-  switch (d->sessionState_.state()) {
-  case SessionState::kWaitingResponse:
-    d->waitResponseTimer_->stop();
-  default:
-    break;
-  }
-
-  d->waitTimerAlive_ = false;
+  d->waitResponseTimer_.cancel();
   d->sessionState_.setState(SessionState::kIdle);
   d->decoder_->Clear();
   emit errorOccur(errorString);
@@ -596,10 +850,13 @@ void QModbusClient::onIoDeviceError(const QString &errorString) {
 
 void QModbusClient::processResponseAnyFunctionCode(const Request &request,
                                                    const Response &response) {
+  Q_D(QModbusClient);
+
+  auto filter = d->takeFinishedChangeFilter();
   processDiagnosis(request, response);
   try {
     /// any_cast maybe thown exception
-    processFunctionCode(request, response);
+    processFunctionCode(request, response, filter.get());
   } catch (...) {
   }
 }
@@ -621,7 +878,8 @@ void QModbusClient::processDiagnosis(const Request &request,
 }
 
 void QModbusClient::processFunctionCode(const Request &request,
-                                        const Response &response) {
+                                        const Response &response,
+                                        ChangeFilter *filter) {
   Q_D(QModbusClient);
 
   const any &data = request.userData();
@@ -663,6 +921,22 @@ void QModbusClient::processFunctionCode(const Request &request,
     if (!response.isException()) {
       ok = processReadRegisters(request, response, &access, d->log_prefix_);
     }
+    if (ok && filter) {
+      const ByteArray &value = access.value();
+      if (!filter->update(value, &d->changedRanges_)) {
+        return;
+      }
+      QVector<AddressRange> changedRanges;
+      changedRanges.reserve(static_cast<int>(d->changedRanges_.size()));
+      for (const auto &range : d->changedRanges_) {
+        changedRanges.append(AddressRange(
+            static_cast<Address>(access.startAddress() + range.start),
+            range.quantity));
+      }
+      emit registersChanged(request.serverAddress(), request.functionCode(),
+                            access.startAddress(), changedRanges, value);
+      return;
+    }
     if (ok) {
       emit readRegistersFinished(request.serverAddress(),
                                  request.functionCode(), access.startAddress(),
@@ -677,6 +951,12 @@ void QModbusClient::processFunctionCode(const Request &request,
                                      access.startAddress(), response.error());
     return;
   }
+  case FunctionCode::kMaskWriteRegister: {
+    auto access = modbus::any::any_cast<SixteenBitAccess>(data);
+    emit maskWriteRegisterFinished(request.serverAddress(),
+                                   access.startAddress(), response.error());
+    return;
+  }
   case FunctionCode::kWriteMultipleRegisters: {
     auto access = modbus::any::any_cast<SixteenBitAccess>(data);
     emit writeMultipleRegistersFinished(
@@ -751,6 +1031,13 @@ QModbusClient *createClient(const QString &url, QObject *parent) {
 
   log("", LogLevel::kInfo, "instanced modbus client on {}", url.toStdString());
   if (config.scheme == "modbus.file") {
+#if defined(__linux__)
+    if (config.options.value("backend") == "termios") {
+      return newTermiosSerialClient(config.serialName, config.baudRate,
+                                    config.dataBits, config.parity,
+                                    config.stopBits, parent);
+    }
+#endif
     return newQtSerialClient(config.serialName, config.baudRate,
                              config.dataBits, config.parity, config.stopBits,
                              parent);
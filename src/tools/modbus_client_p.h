@@ -4,12 +4,18 @@
 #include "modbus/base/modbus.h"
 #include "modbus_client_types.h"
 #include "modbus_frame.h"
+#include "modbus_response_cache.h"
+#include "modbus_thread_timer_wheel.h"
 #include <QTimer>
+#include <atomic>
 #include <base/modbus_logger.h>
+#include <modbus/base/modbus_change_filter.h>
+#include <modbus/base/modbus_mpsc_queue.h>
 #include <modbus/base/modbus_tool.h>
 #include <modbus/base/smart_assert.h>
 #include <modbus/tools/modbus_client.h>
 #include <queue>
+#include <unordered_map>
 
 namespace modbus {
 enum class SessionState { kIdle, kSendingRequest, kWaitingResponse };
@@ -33,8 +39,15 @@ inline std::ostream &operator<<(std::ostream &output,
   return output;
 }
 
+/// a request of submitRequest(), until the thread of the client takes it
+struct SubmittedRequest : public MpscNode {
+  Request request;
+  RequestCompletion completion;
+};
+
 class QModbusClientPrivate : public QObject {
   Q_OBJECT
+  Q_DECLARE_PUBLIC(QModbusClient)
 public:
   explicit QModbusClientPrivate(AbstractIoDevice *serialPort,
                                 QObject *parent = nullptr)
@@ -42,11 +55,395 @@ public:
     initMemberValues();
     device_ = new ReconnectableIoDevice(serialPort, this);
   }
-  ~QModbusClientPrivate() override = default;
+  ~QModbusClientPrivate() override {
+    while (SubmittedRequest *submitted = submitted_.pop()) {
+      delete submitted;
+    }
+  }
+
+  static bool canFilterChanges(const PreparedRequestPtr &poll) {
+    return poll && (poll->request.functionCode() ==
+                        FunctionCode::kReadHoldingRegisters ||
+                    poll->request.functionCode() ==
+                        FunctionCode::kReadInputRegister);
+  }
+
+  /**
+   * a change filter belongs to the PreparedRequest it was enabled for, a
+   * plain request of the same range is never filtered
+   */
+  std::shared_ptr<ChangeFilter> findChangeFilter(const Element *element) {
+    if (changeFilters_.empty() || !element->prepared) {
+      return nullptr;
+    }
+    auto it = changeFilters_.find(element->prepared.get());
+    return it == changeFilters_.end() ? nullptr : it->second.filter;
+  }
+
+  /**
+   * processResponseAnyFunctionCode() gets a copy of the request by a queued
+   * requestFinished, in the order they were emitted. take the change filter
+   * recorded for the response it is processing, if any
+   */
+  std::shared_ptr<ChangeFilter> takeFinishedChangeFilter() {
+    ++finishedProcessed_;
+    if (filteredFinished_.empty() ||
+        filteredFinished_.front().first != finishedProcessed_) {
+      return nullptr;
+    }
+    auto filter = std::move(filteredFinished_.front().second);
+    filteredFinished_.pop_front();
+    return filter;
+  }
+
+  bool checkOpened() {
+    if (device_->isOpened()) {
+      return true;
+    }
+    log(log_prefix_, LogLevel::kWarning, "{} closed, discard reuqest",
+        device_->name());
+    return false;
+  }
+
+  /**
+   * reuse the request of a pooled element, return the user data of the
+   * request as Access, the caller fills it and the request data in.
+   */
+  template <typename Access>
+  Access *prepareElement(Element *element, ServerAddress serverAddress,
+                         FunctionCode functionCode) {
+    if (!element->request) {
+      element->request.reset(new Request());
+    }
+    auto &request = *element->request;
+    request.setServerAddress(serverAddress);
+    request.setFunctionCode(functionCode);
+    request.setTransactionId(0);
+    return request.reuseUserData<Access>();
+  }
+
+  void enqueueElement(Element *element) {
+    if (responseCache_.enabled()) {
+      const auto &request = element->currentRequest();
+      if (responseCache_.lookup(request, &element->response)) {
+        completeFromCache(element);
+        return;
+      }
+      responseCache_.invalidate(request);
+    }
+    if (enableSingleFlight_ && joinSingleFlight(element)) {
+      return;
+    }
+    if (enableWriteCoalescing_ && coalesceWrite(element)) {
+      return;
+    }
+    element->retryTimes = retryTimes_;
+    elementQueue_.push_back(element);
+    scheduleNextRequest(t3_5_);
+  }
+
+  /**
+   * the cache hits are completed in the next event loop, in the order they
+   * were requested, never inside the call that requested them
+   */
+  void completeFromCache(Element *element) {
+    cacheHits_.push_back(element);
+    if (cacheHits_.size() > 1) {
+      return;
+    }
+    QTimer::singleShot(0, this, [this]() {
+      ElementQueue hits;
+      hits.swap(cacheHits_);
+      for (auto element : hits) {
+        emitFinished(element, element->currentRequest(), element->response);
+        elementPool_.release(element);
+      }
+    });
+  }
+
+  /**
+   * the key of a read is the server address + the pdu, other requests are
+   * never joined
+   */
+  bool singleFlightKey(const Request &request, std::string *key) {
+    switch (request.functionCode()) {
+    case FunctionCode::kReadCoils:
+    case FunctionCode::kReadInputDiscrete:
+    case FunctionCode::kReadHoldingRegisters:
+    case FunctionCode::kReadInputRegister:
+      break;
+    default:
+      return false;
+    }
+    if (request.isBrocast()) {
+      return false;
+    }
+    const auto &data = request.data();
+    key->resize(0);
+    key->push_back(static_cast<char>(request.serverAddress()));
+    key->push_back(static_cast<char>(request.functionCode()));
+    key->append(data.begin(), data.end());
+    return true;
+  }
+
+  /**
+   * if an identical read is queued or in flight, attach element to it as a
+   * waiter and return true. otherwise element is indexed and will be
+   * queued by the caller
+   */
+  bool joinSingleFlight(Element *element) {
+    if (!singleFlightKey(element->currentRequest(), &singleFlightKey_)) {
+      return false;
+    }
+    auto it = singleFlight_.find(singleFlightKey_);
+    if (it != singleFlight_.end()) {
+      it->second->waiters.push_back(element);
+      return true;
+    }
+    singleFlight_.emplace(singleFlightKey_, element);
+    element->singleFlight = true;
+    return false;
+  }
 
-  Element *enqueueAndPeekLastElement() {
-    elementQueue_.push_back(new Element());
-    return elementQueue_.back();
+  void leaveSingleFlight(Element *element) {
+    if (!element->singleFlight) {
+      return;
+    }
+    element->singleFlight = false;
+    if (!singleFlightKey(element->currentRequest(), &singleFlightKey_)) {
+      return;
+    }
+    auto it = singleFlight_.find(singleFlightKey_);
+    if (it != singleFlight_.end() && it->second == element) {
+      singleFlight_.erase(it);
+    }
+  }
+
+  /// requestFinished, and the completion of a submitted request
+  void emitFinished(Element *element, const Request &request,
+                    const Response &response) {
+    Q_Q(QModbusClient);
+    ++finishedEmitted_;
+    auto filter = findChangeFilter(element);
+    if (filter) {
+      filteredFinished_.emplace_back(finishedEmitted_, std::move(filter));
+    }
+    emit q->requestFinished(request, response);
+    if (element->completion) {
+      element->completion(request, response);
+    }
+  }
+
+  /**
+   * the completion of a request that gets no response: a brocast once it
+   * is written, with kNoError, or a request dropped before it is answered,
+   * with error. no signal is emitted for it
+   */
+  static void completeUnanswered(const Request &request,
+                                 const RequestCompletion &completion,
+                                 Error error) {
+    if (!completion) {
+      return;
+    }
+    Response response;
+    response.setServerAddress(request.serverAddress());
+    response.setFunctionCode(request.functionCode());
+    response.setTransactionId(request.transactionId());
+    if (error != Error::kNoError) {
+      response.setError(error);
+    }
+    completion(request, response);
+  }
+
+  /// completeUnanswered() for element and its waiters, then release them
+  void completeUnanswered(Element *element, Error error) {
+    completeUnanswered(element->currentRequest(), element->completion, error);
+    for (auto waiter : element->waiters) {
+      completeUnanswered(waiter->currentRequest(), waiter->completion, error);
+    }
+    elementPool_.release(element);
+  }
+
+  /**
+   * the element has been removed from the queue, emit requestFinished for
+   * it and all its waiters with its response, then release them
+   */
+  void completeElement(Element *element) {
+    if (element->coalesced) {
+      completeCoalesced(element);
+      return;
+    }
+    leaveSingleFlight(element);
+    emitFinished(element, element->currentRequest(), element->response);
+    for (auto waiter : element->waiters) {
+      emitFinished(waiter, waiter->currentRequest(), element->response);
+    }
+    elementPool_.release(element);
+  }
+
+  /**
+   * a non brocast 0x05/0x06 request, value is 0/1 for a coil
+   */
+  static bool singleWrite(const Request &request, Address *address,
+                          uint16_t *value) {
+    const auto &data = request.data();
+    const FunctionCode code = request.functionCode();
+    if ((code != FunctionCode::kWriteSingleRegister &&
+         code != FunctionCode::kWriteSingleCoil) ||
+        request.isBrocast() || data.size() < 4) {
+      return false;
+    }
+    *address = data[0] * 256 + data[1];
+    const uint16_t raw = data[2] * 256 + data[3];
+    *value = code == FunctionCode::kWriteSingleCoil ? (raw == 0xff00) : raw;
+    return true;
+  }
+
+  /**
+   * the limits of 0x10/0x0f, the pdu must not exceed 253 bytes
+   */
+  static bool canCoalesce(FunctionCode code, Address start, size_t size,
+                          Address address) {
+    const size_t maxSize =
+        code == FunctionCode::kWriteSingleRegister ? 123 : 1968;
+    const int begin = std::min<int>(start, address);
+    const int end = std::max<int>(start + static_cast<int>(size), address + 1);
+    return address + 1 >= start && address <= start + size &&
+           static_cast<size_t>(end - begin) <= maxSize;
+  }
+
+  /**
+   * merge the single write element into a not yet sent write to the same
+   * server, the same address(the newer value wins) or an adjacent one.
+   * the requests to the same server are never reordered, the search stops
+   * at the first one that can't take the write.
+   */
+  bool coalesceWrite(Element *element) {
+    const auto &request = element->currentRequest();
+    Address address = 0;
+    uint16_t value = 0;
+    if (!singleWrite(request, &address, &value)) {
+      return false;
+    }
+    const FunctionCode code = request.functionCode();
+    /// the first element is being sent unless the session is idle
+    const size_t sent = sessionState_.state() == SessionState::kIdle ? 0 : 1;
+
+    for (size_t i = elementQueue_.size(); i > sent; i--) {
+      Element *&pending = elementQueue_[i - 1];
+      const auto &other = pending->currentRequest();
+      if (!other.isBrocast() &&
+          other.serverAddress() != request.serverAddress()) {
+        continue;
+      }
+
+      Address otherAddress = 0;
+      uint16_t otherValue = 0;
+      if (pending->coalesced) {
+        if (pending->coalescedCode != code ||
+            !canCoalesce(code, pending->coalescedStart,
+                         pending->coalescedValues.size(), address)) {
+          return false;
+        }
+      } else {
+        if (other.functionCode() != code ||
+            !singleWrite(other, &otherAddress, &otherValue) ||
+            !canCoalesce(code, otherAddress, 1, address)) {
+          return false;
+        }
+        auto batch = elementPool_.acquire();
+        batch->coalesced = true;
+        batch->coalescedCode = code;
+        batch->coalescedStart = otherAddress;
+        batch->coalescedValues.assign(1, otherValue);
+        batch->retryTimes = pending->retryTimes;
+        batch->waiters.push_back(pending);
+        pending = batch;
+      }
+
+      auto &values = pending->coalescedValues;
+      if (address < pending->coalescedStart) {
+        values.insert(values.begin(), value);
+        pending->coalescedStart = address;
+      } else if (address == pending->coalescedStart + values.size()) {
+        values.push_back(value);
+      } else {
+        values[address - pending->coalescedStart] = value;
+      }
+      pending->waiters.push_back(element);
+      marshalCoalescedRequest(pending, request.serverAddress());
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * one value is sent as 0x05/0x06, more as 0x0f/0x10
+   */
+  static void marshalCoalescedRequest(Element *element,
+                                      ServerAddress serverAddress) {
+    if (!element->request) {
+      element->request.reset(new Request());
+    }
+    auto &request = *element->request;
+    const auto &values = element->coalescedValues;
+    const Address start = element->coalescedStart;
+    const bool coils = element->coalescedCode == FunctionCode::kWriteSingleCoil;
+
+    request.setServerAddress(serverAddress);
+    request.setTransactionId(0);
+    ByteArray &data = *request.mutableData();
+    data.resize(0);
+    data.push_back(start / 256);
+    data.push_back(start % 256);
+    if (values.size() == 1) {
+      request.setFunctionCode(element->coalescedCode);
+      const uint16_t value = coils ? (values[0] ? 0xff00 : 0x0000) : values[0];
+      data.push_back(value / 256);
+      data.push_back(value % 256);
+      return;
+    }
+
+    request.setFunctionCode(coils ? FunctionCode::kWriteMultipleCoils
+                                  : FunctionCode::kWriteMultipleRegisters);
+    data.push_back(values.size() / 256);
+    data.push_back(values.size() % 256);
+    if (coils) {
+      const size_t bytes = (values.size() + 7) / 8;
+      data.push_back(bytes);
+      data.resize(data.size() + bytes, 0);
+      for (size_t i = 0; i < values.size(); i++) {
+        data[5 + i / 8] |= values[i] << (i % 8);
+      }
+      return;
+    }
+    data.push_back(values.size() * 2);
+    for (auto value : values) {
+      data.push_back(value / 256);
+      data.push_back(value % 256);
+    }
+  }
+
+  /**
+   * each coalesced write completes as if it was sent alone, its response is
+   * the echo of its request, or the error of the coalesced one
+   */
+  void completeCoalesced(Element *element) {
+    const Response &coalesced = element->response;
+    for (auto waiter : element->waiters) {
+      const auto &request = waiter->currentRequest();
+      Response &response = waiter->response;
+      response.setServerAddress(request.serverAddress());
+      response.setFunctionCode(request.functionCode());
+      response.setTransactionId(coalesced.transactionId());
+      if (coalesced.isException()) {
+        response.setError(coalesced.error());
+      } else {
+        response.setData(request.data());
+      }
+      emitFinished(waiter, request, response);
+    }
+    elementPool_.release(element);
   }
 
   void scheduleNextRequest(int delay) {
@@ -64,34 +461,74 @@ public:
     /*after some delay, the request will be sent,so we change the state to
      * sending request*/
     sessionState_.setState(SessionState::kSendingRequest);
-    QTimer::singleShot(delay, this, [&]() {
-      if (elementQueue_.empty()) {
-        return;
-      }
-      smart_assert(sessionState_.state() ==
-                   SessionState::kSendingRequest)(sessionState_.state());
-      /**
-       * take out the first request,send it out,
-       */
-      auto &ele = elementQueue_.front();
-
-      // set next transactionId
-      if (transferMode_ == TransferMode::kMbap) {
-        ele->request->setTransactionId(nextTransactionId_++);
+    if (delay > 0) {
+      timerWheel().schedule(&sendTimer_, delay);
+      return;
+    }
+    QTimer::singleShot(0, this, [this]() { sendNextRequest(); });
+  }
+
+  void sendNextRequest() {
+    if (elementQueue_.empty()) {
+      return;
+    }
+    smart_assert(sessionState_.state() ==
+                 SessionState::kSendingRequest)(sessionState_.state());
+    /**
+     * take out the first request,send it out,
+     */
+    auto &ele = elementQueue_.front();
+
+    // set next transactionId
+    if (transferMode_ == TransferMode::kMbap) {
+      ele->transactionId = nextTransactionId_++;
+      if (!ele->prepared) {
+        ele->request->setTransactionId(ele->transactionId);
       }
+    }
 
+    if (ele->prepared) {
+      writePreparedFrame(*ele->prepared, ele->transactionId);
+    } else {
       encoder_->Encode(ele->request.get(), writerBuffer_);
-      ele->totalBytes = writerBuffer_.Len();
-      if (enableDump_) {
-        log(log_prefix_, LogLevel::kDebug, "{} will send: {}", device_->name(),
-            dump(transferMode_, writerBuffer_));
-      }
+    }
+    ele->totalBytes = writerBuffer_.Len();
+    if (enableDump_) {
+      log(log_prefix_, LogLevel::kDebug, "{} will send: {}", device_->name(),
+          dump(transferMode_, writerBuffer_));
+    }
 
-      uint8_t *p = nullptr;
-      int len = writerBuffer_.Len();
-      writerBuffer_.ZeroCopyRead(&p, len);
-      device_->write(reinterpret_cast<const char *>(p), len);
-    });
+    uint8_t *p = nullptr;
+    int len = writerBuffer_.Len();
+    writerBuffer_.ZeroCopyRead(&p, len);
+    device_->write(reinterpret_cast<const char *>(p), len);
+  }
+
+  /**
+   * the timer wheel of the thread the client works on, taken at the first
+   * use, so a client may be moved to its thread before it is opened
+   */
+  ThreadTimerWheel &timerWheel() {
+    if (!timerWheel_) {
+      timerWheel_ = ThreadTimerWheel::current();
+    }
+    return *timerWheel_;
+  }
+
+  /**
+   * copy the cached frame, in mbap mode the first 2 bytes are the
+   * transaction id, nothing else changes between sends
+   */
+  void writePreparedFrame(const PreparedRequest &prepared,
+                          uint16_t transactionId) {
+    const auto &frame = prepared.frame;
+    uint8_t *p = writerBuffer_.BeginWrite(frame.size());
+    std::copy(frame.begin(), frame.end(), p);
+    if (prepared.transferMode == TransferMode::kMbap) {
+      p[0] = transactionId / 256;
+      p[1] = transactionId % 256;
+    }
+    writerBuffer_.CommitWrite(frame.size());
   }
 
   void initMemberValues() {
@@ -102,7 +539,9 @@ public:
     retryTimes_ = 0; /// default no retry
     transferMode_ = TransferMode::kRtu;
 
-    waitResponseTimer_ = new QTimer(this);
+    sendTimer_.setCallback([this]() { sendNextRequest(); });
+    waitResponseTimer_.setCallback(
+        [this]() { q_ptr->onIoDeviceResponseTimeout(); });
     checkSizeFuncTable_ = creatDefaultCheckSizeFuncTableForClient();
     decoder_ = createModbusFrameDecoder(transferMode_, checkSizeFuncTable_);
     encoder_ = createModbusFrameEncoder(transferMode_);
@@ -119,14 +558,19 @@ public:
    * removed.
    */
   ElementQueue elementQueue_;
+  ElementPool elementPool_;
   StateManager<SessionState> sessionState_;
   ReconnectableIoDevice *device_ = nullptr;
   int waitConversionDelay_;
   int t3_5_;
   int waitResponseTimeout_;
   int retryTimes_;
-  QTimer *waitResponseTimer_ = nullptr;
-  bool waitTimerAlive_ = true;
+  /// declared before its timers, they are cancelled first
+  std::shared_ptr<ThreadTimerWheel> timerWheel_;
+  /// the t3.5 delay before a request is sent
+  TimerWheel::Timer sendTimer_;
+  /// a timer cancelled never fires, no stale timeout to filter out
+  TimerWheel::Timer waitResponseTimer_;
   QString errorString_;
 
   /// the default transfer mode must be rtu mode
@@ -144,7 +588,40 @@ public:
 
   pp::bytes::Buffer readBuffer_;
   pp::bytes::Buffer writerBuffer_;
+  /// reused when a request has to be marshaled in two parts
+  ByteArray scratchArray_;
+  /**
+   * enabled by enableChangeFilter(), keyed by the poll. the poll is held, so
+   * its address is not reused by another PreparedRequest until it is disabled
+   */
+  struct PollChangeFilter {
+    PreparedRequestPtr poll;
+    std::shared_ptr<ChangeFilter> filter;
+  };
+  std::unordered_map<const PreparedRequest *, PollChangeFilter> changeFilters_;
+  /// the sequence numbers of the emitted requestFinished that are filtered
+  std::deque<std::pair<uint64_t, std::shared_ptr<ChangeFilter>>>
+      filteredFinished_;
+  uint64_t finishedEmitted_ = 0;
+  uint64_t finishedProcessed_ = 0;
+  std::vector<AddressRange> changedRanges_;
+  ResponseCache responseCache_;
+  ElementQueue cacheHits_;
+  /// defualt is disabled
+  bool enableSingleFlight_ = false;
+  std::unordered_map<std::string, Element *> singleFlight_;
+  std::string singleFlightKey_;
+  /// defualt is disabled
+  bool enableWriteCoalescing_ = false;
+  /// defualt is disabled
+  bool enableRtuResync_ = false;
+  /// defualt is disabled
+  bool enableRtuSilenceDetection_ = false;
+  /// the requests of submitRequest(), taken on kRequestsSubmittedEvent
+  MpscQueue<SubmittedRequest> submitted_;
+  std::atomic<bool> submitPending_{false};
   std::string log_prefix_;
+  QModbusClient *q_ptr = nullptr;
 };
 
 class ReconnectableIoDevicePrivate : public QObject {
@@ -158,6 +635,17 @@ public:
 
   ~ReconnectableIoDevicePrivate() override = default;
 
+  /// see QModbusClientPrivate::timerWheel()
+  ThreadTimerWheel &timerWheel() {
+    if (!timerWheel_) {
+      timerWheel_ = ThreadTimerWheel::current();
+    }
+    return *timerWheel_;
+  }
+
+  std::shared_ptr<ThreadTimerWheel> timerWheel_;
+  /// the reopenDelay_ before a reconnect
+  TimerWheel::Timer reopenTimer_;
   int openRetryTimes_ = 0;
   int openRetryTimesBack_ = 0;
   int reopenDelay_ = 1000;
@@ -5,6 +5,8 @@
 #include <deque>
 #include <memory>
 #include <modbus/base/modbus.h>
+#include <modbus/tools/modbus_client.h>
+#include <vector>
 
 namespace modbus {
 
@@ -49,13 +51,108 @@ struct Element {
   size_t totalBytes = 0;
   int retryTimes = 0;
   std::unique_ptr<Request> request = nullptr;
+  /// set if sent by sendPreparedRequest(), request is null then
+  PreparedRequestPtr prepared;
+  /// the transaction id of the last send, only used in mbap mode
+  uint16_t transactionId = 0;
+  /// set if sent by submitRequest()
+  RequestCompletion completion;
+  /// identical reads attached by single flight, completed with this one
+  std::vector<Element *> waiters;
+  /// set if this element is in the single flight index
+  bool singleFlight = false;
+  /**
+   * set if this element carries the single writes coalesced into it, they
+   * are its waiters. coalescedValues are the values of [coalescedStart,
+   * coalescedStart + size), 0/1 for coils
+   */
+  bool coalesced = false;
+  FunctionCode coalescedCode = FunctionCode::kInvalidCode;
+  Address coalescedStart = 0;
+  std::vector<uint16_t> coalescedValues;
+
+  const Request &currentRequest() const {
+    return prepared ? prepared->request : *request;
+  }
 };
 
 using ElementQueue = std::deque<Element *>;
 inline void createElement(std::unique_ptr<Request> &request, Element *element) {
-  element->request.swap(request);
+  element->request = std::move(request);
 }
 
+/**
+ * a free list of elements, owned by one client.
+ *
+ * a released element keeps its request(and the user data of the request),
+ * the response and the dump array, so the next request built on it reuses
+ * their storage instead of allocating again. at most maxFreeSize elements
+ * are kept, the rest are deleted.
+ */
+class ElementPool {
+public:
+  static const size_t kDefaultMaxFreeSize = 32;
+  static const int kDumpReserveSize = 256;
+
+  explicit ElementPool(size_t maxFreeSize = kDefaultMaxFreeSize)
+      : maxFreeSize_(maxFreeSize) {
+    free_.reserve(maxFreeSize_);
+  }
+  ~ElementPool() {
+    for (auto element : free_) {
+      delete element;
+    }
+  }
+
+  Element *acquire() {
+    if (free_.empty()) {
+      auto element = new Element();
+      /// reserve() marks the capacity as reserved, resize(0) keeps it then
+      element->dumpReadArray.reserve(kDumpReserveSize);
+      return element;
+    }
+    auto element = free_.back();
+    free_.pop_back();
+    return element;
+  }
+
+  /// the waiters of element are released too
+  void release(Element *element) {
+    if (free_.size() >= maxFreeSize_) {
+      for (auto waiter : element->waiters) {
+        release(waiter);
+      }
+      delete element;
+      return;
+    }
+    element->response.setServerAddress(0);
+    element->response.setFunctionCode(FunctionCode::kInvalidCode);
+    element->response.setTransactionId(0);
+    element->response.setData(nullptr, 0);
+    element->dumpReadArray.resize(0);
+    element->bytesWritten = 0;
+    element->totalBytes = 0;
+    element->retryTimes = 0;
+    element->prepared.reset();
+    element->transactionId = 0;
+    element->completion = nullptr;
+    element->singleFlight = false;
+    element->coalesced = false;
+    element->coalescedValues.resize(0);
+    for (auto waiter : element->waiters) {
+      release(waiter);
+    }
+    element->waiters.clear();
+    free_.push_back(element);
+  }
+
+  size_t freeSize() const { return free_.size(); }
+
+private:
+  std::vector<Element *> free_;
+  size_t maxFreeSize_;
+};
+
 } // namespace modbus
 
 #endif /* MODBUS_CLIENT_TYPES_H */
@@ -0,0 +1,68 @@
+#ifndef MODBUS_DIRTY_RANGES_H
+#define MODBUS_DIRTY_RANGES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <modbus/base/modbus_types.h>
+#include <vector>
+
+namespace modbus {
+
+/**
+ * The changed addresses of one table since the last take(), kept as sorted,
+ * disjoint address ranges. Overlapping and adjacent marks are merged, so a
+ * bulk write of 2000 coils is one range, not 2000 addresses.
+ */
+class DirtyRanges {
+public:
+  void mark(Address start, Quantity quantity) {
+    if (quantity == 0) {
+      return;
+    }
+    uint32_t first = start;
+    uint32_t last = first + quantity;
+
+    /// the first range that ends at or after start, it may touch the mark
+    auto begin = std::lower_bound(
+        ranges_.begin(), ranges_.end(), first,
+        [](const AddressRange &range, uint32_t address) {
+          return end(range) < address;
+        });
+    auto it = begin;
+    for (; it != ranges_.end() && it->start <= last; ++it) {
+      first = std::min<uint32_t>(first, it->start);
+      last = std::max<uint32_t>(last, end(*it));
+    }
+
+    const AddressRange merged(static_cast<Address>(first),
+                              static_cast<Quantity>(last - first));
+    if (begin == it) {
+      ranges_.insert(begin, merged);
+      return;
+    }
+    *begin = merged;
+    ranges_.erase(begin + 1, it);
+  }
+
+  bool empty() const { return ranges_.empty(); }
+  const std::vector<AddressRange> &ranges() const { return ranges_; }
+  void clear() { ranges_.clear(); }
+
+  /// return the ranges marked so far and start over
+  std::vector<AddressRange> take() {
+    std::vector<AddressRange> ranges;
+    ranges.swap(ranges_);
+    return ranges;
+  }
+
+private:
+  static uint32_t end(const AddressRange &range) {
+    return static_cast<uint32_t>(range.start) + range.quantity;
+  }
+
+  std::vector<AddressRange> ranges_;
+};
+
+} // namespace modbus
+
+#endif /* MODBUS_DIRTY_RANGES_H */
@@ -0,0 +1,159 @@
+#include "modbus_epoll_thread.h"
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <base/modbus_logger.h>
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace modbus {
+
+namespace {
+const int kMaxEvents = 64;
+
+void notify(int fd) {
+  const uint64_t one = 1;
+  ssize_t n = ::write(fd, &one, sizeof(one));
+  (void)n;
+}
+
+void drain(int fd) {
+  uint64_t value = 0;
+  ssize_t n = ::read(fd, &value, sizeof(value));
+  (void)n;
+}
+} // namespace
+
+EpollThread::EpollThread(int64_t tick) : wheel_(tick) {
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  watch(wakeFd_, &wakeFd_, EPOLLIN);
+  watch(timerFd_, &timerFd_, EPOLLIN);
+}
+
+EpollThread::~EpollThread() {
+  stop();
+  ::close(timerFd_);
+  ::close(wakeFd_);
+  ::close(epollFd_);
+}
+
+void EpollThread::start() {
+  if (!thread_.joinable()) {
+    thread_ = std::thread([this]() { run(); });
+  }
+}
+
+void EpollThread::stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  stop_.store(true);
+  notify(wakeFd_);
+  thread_.join();
+}
+
+void EpollThread::wakeUp() {
+  if (!wakePending_.exchange(true)) {
+    notify(wakeFd_);
+  }
+}
+
+void EpollThread::watch(int fd, void *ptr, uint32_t events) {
+  struct epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = events;
+  event.data.ptr = ptr;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event);
+}
+
+void EpollThread::modify(int fd, void *ptr, uint32_t events) {
+  struct epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = events;
+  event.data.ptr = ptr;
+  epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &event);
+}
+
+void EpollThread::unwatch(int fd) {
+  epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void EpollThread::run() {
+  struct epoll_event events[kMaxEvents];
+  while (!stop_.load()) {
+    const int n = epoll_wait(epollFd_, events, kMaxEvents, -1);
+    if (n < 0 && errno != EINTR) {
+      log("", LogLevel::kError, "epoll thread: epoll_wait {}",
+          std::strerror(errno));
+      return;
+    }
+    for (int i = 0; i < n; i++) {
+      void *ptr = events[i].data.ptr;
+      if (ptr == &wakeFd_) {
+        drain(wakeFd_);
+        /// the wakeUp() after it signal the eventfd again
+        wakePending_.store(false);
+        if (!stop_.load()) {
+          onWakeUp();
+        }
+        continue;
+      }
+      if (ptr == &timerFd_) {
+        drain(timerFd_);
+        armed_ = -1;
+        continue;
+      }
+      onEvents(ptr, events[i].events);
+    }
+    wheel_.advance();
+    rearm();
+  }
+}
+
+void EpollThread::rearm() {
+  const int64_t next = wheel_.nextExpiry();
+  /// an earlier arm is kept, the early wakeup is harmless
+  if (next == armed_ || (next >= 0 && armed_ >= 0 && armed_ < next)) {
+    return;
+  }
+  armed_ = next;
+  struct itimerspec spec;
+  std::memset(&spec, 0, sizeof(spec));
+  if (next >= 0) {
+    /// a zero time disarms the timer
+    const int64_t at = std::max<int64_t>(next, 1);
+    spec.it_value.tv_sec = at / 1000000;
+    spec.it_value.tv_nsec = (at % 1000000) * 1000;
+  }
+  timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+void RequestJob::finish(Error error) {
+  if (error != Error::kTimeout && !request.isBrocast()) {
+    return;
+  }
+  response.setServerAddress(request.serverAddress());
+  response.setFunctionCode(request.functionCode());
+  response.setTransactionId(request.transactionId());
+  response.setData(nullptr, 0);
+  if (error != Error::kNoError) {
+    response.setError(error);
+  }
+}
+
+QEvent::Type jobsFinishedEvent() {
+  static const QEvent::Type type =
+      static_cast<QEvent::Type>(QEvent::registerEventType());
+  return type;
+}
+
+} // namespace modbus
+
+#endif // __linux__
@@ -0,0 +1,196 @@
+#ifndef MODBUS_EPOLL_THREAD_H
+#define MODBUS_EPOLL_THREAD_H
+
+#if defined(__linux__)
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <modbus/base/modbus.h>
+#include <modbus/base/modbus_mpsc_queue.h>
+#include <modbus/base/modbus_timer_wheel.h>
+#include <thread>
+#include <vector>
+
+namespace modbus {
+
+/**
+ * A thread polling file descriptors with epoll, the loop of the engines
+ * servicing many lines on a few threads.
+ *
+ * wakeUp() has onWakeUp() called on the thread, the calls before it runs
+ * make one write to an eventfd. The timers of wheel() fire on the thread,
+ * a timerfd is armed to the next expiry of the wheel, so the thread has one
+ * kernel timer however many timers it runs.
+ *
+ * The subclass starts the thread once it is constructed, and stops it in
+ * its destructor, before its members are gone.
+ */
+class EpollThread {
+public:
+  /// the tick of the wheel, microseconds
+  explicit EpollThread(int64_t tick);
+  virtual ~EpollThread();
+  EpollThread(const EpollThread &) = delete;
+  EpollThread &operator=(const EpollThread &) = delete;
+
+  void start();
+  /// join the thread, no callback is called after it
+  void stop();
+  /// any thread
+  void wakeUp();
+
+protected:
+  /// on the thread, after one or more wakeUp()
+  virtual void onWakeUp() = 0;
+  /// on the thread, the events of the fd watched with ptr
+  virtual void onEvents(void *ptr, uint32_t events) = 0;
+
+  void watch(int fd, void *ptr, uint32_t events);
+  void modify(int fd, void *ptr, uint32_t events);
+  void unwatch(int fd);
+  TimerWheel &wheel() { return wheel_; }
+
+private:
+  void run();
+  void rearm();
+
+  int epollFd_ = -1;
+  int wakeFd_ = -1;
+  int timerFd_ = -1;
+  TimerWheel wheel_;
+  /// the time the timerfd is armed to, -1 if disarmed
+  int64_t armed_ = -1;
+  std::atomic<bool> stop_{false};
+  std::atomic<bool> wakePending_{false};
+  std::thread thread_;
+};
+
+/// a request of an engine, from its sendRequest() to its requestFinished()
+struct RequestJob : public MpscNode {
+  Request request;
+  Response response;
+  int retryTimes = 0;
+
+  /// the response of a request that timed out or was a brocast is made up
+  void finish(Error error);
+};
+
+/// the event posted to the engine when jobs are finished
+QEvent::Type jobsFinishedEvent();
+
+/**
+ * The jobs finished by the threads of an engine, handed back to the thread
+ * of the engine. The first push() after take() posts one event to it.
+ */
+template <typename Job> class FinishedJobs {
+public:
+  explicit FinishedJobs(QObject *engine) : engine_(engine) {}
+  ~FinishedJobs() {
+    while (Job *job = queue_.pop()) {
+      delete job;
+    }
+  }
+
+  /// any thread
+  void push(Job *job) {
+    queue_.push(job);
+    if (!pending_.exchange(true)) {
+      QCoreApplication::postEvent(engine_, new QEvent(jobsFinishedEvent()));
+    }
+  }
+
+  /**
+   * on the thread of the engine, false if e is not jobsFinishedEvent(). f
+   * is called with each job, which is deleted then
+   */
+  template <typename F> bool take(QEvent *e, F f) {
+    if (e->type() != jobsFinishedEvent()) {
+      return false;
+    }
+    /// the jobs finished after it post the event again
+    pending_.store(false);
+    while (Job *job = queue_.pop()) {
+      f(job);
+      delete job;
+    }
+    return true;
+  }
+
+private:
+  QObject *engine_;
+  MpscQueue<Job> queue_;
+  std::atomic<bool> pending_{false};
+};
+
+/**
+ * An EpollThread of an engine, servicing the lines(ports, devices) handed
+ * to it, Line and Job derive from MpscNode. The lines and the jobs are
+ * taken by the subclass in onWakeUp(), the jobs go back to the engine with
+ * finish().
+ */
+template <typename Line, typename Job> class LineThread : public EpollThread {
+public:
+  LineThread(int64_t tick, int index, FinishedJobs<Job> *finished)
+      : EpollThread(tick), index_(index), finished_(finished) {}
+
+  int index() const { return index_; }
+
+  /// any thread
+  void attach(Line *line) {
+    attaching_.push(line);
+    wakeUp();
+  }
+
+  /// any thread
+  void post(Job *job) {
+    inbox_.push(job);
+    wakeUp();
+  }
+
+  /// the jobs not taken by the thread, after it is stopped
+  void dropJobs() {
+    while (Job *job = inbox_.pop()) {
+      delete job;
+    }
+  }
+
+  /// the lines on the thread, counted by the engine when they are added
+  int lineCount = 0;
+
+protected:
+  Line *takeLine() { return attaching_.pop(); }
+  Job *takeJob() { return inbox_.pop(); }
+
+  /// hand job back to the engine, see RequestJob::finish()
+  void finish(Job *job, Error error) {
+    job->finish(error);
+    finished_->push(job);
+  }
+
+private:
+  const int index_;
+  FinishedJobs<Job> *finished_;
+  MpscQueue<Line> attaching_;
+  MpscQueue<Job> inbox_;
+};
+
+/// the thread with the fewest lines, a new line goes to it
+template <typename Thread>
+Thread *leastLoaded(const std::vector<std::unique_ptr<Thread>> &threads) {
+  Thread *thread = threads.front().get();
+  for (auto &candidate : threads) {
+    if (candidate->lineCount < thread->lineCount) {
+      thread = candidate.get();
+    }
+  }
+  return thread;
+}
+
+} // namespace modbus
+
+#endif // __linux__
+
+#endif // MODBUS_EPOLL_THREAD_H
@@ -0,0 +1,351 @@
+#include <QMap>
+#include <array>
+#include <base/modbus_frame.h>
+#include <base/modbus_logger.h>
+#include <memory>
+#include <modbus/tools/modbus_gateway.h>
+#include <unordered_map>
+
+namespace modbus {
+
+/// the user data of the requests forwarded, to find their transaction
+struct GatewayTag {
+  uint32_t id = 0;
+};
+
+/// a tcp client of the gateway
+struct GatewaySession {
+  explicit GatewaySession(AbstractConnection *conn)
+      : connection(conn),
+        decoder(createModbusFrameDecoder(
+            TransferMode::kMbap, creatDefaultCheckSizeFuncTableForServer(),
+            true)),
+        encoder(createModbusFrameEncoder(TransferMode::kMbap)) {}
+  ~GatewaySession() { connection->deleteLater(); }
+
+  AbstractConnection *connection = nullptr;
+  std::unique_ptr<ModbusFrameDecoder> decoder;
+  std::unique_ptr<ModbusFrameEncoder> encoder;
+  Adu request;
+  pp::bytes::Buffer writeBuffer;
+};
+
+using GatewaySessionPtr = std::shared_ptr<GatewaySession>;
+
+/// a request forwarded to a bus, waiting for its response
+struct GatewayTransaction {
+  std::weak_ptr<GatewaySession> session;
+  uint16_t transactionId = 0;
+  ServerAddress serverAddress = 0;
+  FunctionCode functionCode = FunctionCode::kInvalidCode;
+  QModbusClient *bus = nullptr;
+};
+
+class QModbusGatewayPrivate {
+  Q_DECLARE_PUBLIC(QModbusGateway)
+public:
+  explicit QModbusGatewayPrivate(QModbusGateway *q) : q_ptr(q) {
+    routes_.fill(nullptr);
+  }
+
+  void setServer(AbstractServer *server) {
+    server_ = server;
+    server_->handleNewConnFunc(
+        std::bind(&QModbusGatewayPrivate::incomingConnection, this,
+                  std::placeholders::_1));
+  }
+
+  void incomingConnection(AbstractConnection *connection) {
+    Q_Q(QModbusGateway);
+    QObject::connect(connection, &AbstractConnection::disconnected, q,
+                     [this](quintptr fd) { removeClient(fd); });
+    QObject::connect(
+        connection, &AbstractConnection::messageArrived, q,
+        [this](quintptr fd, const BytesBufferPtr &buffer) {
+          onMessageArrived(fd, buffer);
+        });
+    sessions_[connection->fd()] = std::make_shared<GatewaySession>(connection);
+  }
+
+  void removeClient(quintptr fd) {
+    auto it = sessions_.find(fd);
+    if (it == sessions_.end()) {
+      return;
+    }
+    log(log_prefix_, LogLevel::kInfo, "{} closed",
+        it.value()->connection->fullName());
+    /// the responses still pending for it are dropped when they arrive
+    sessions_.erase(it);
+  }
+
+  void onMessageArrived(quintptr fd, const BytesBufferPtr &buffer) {
+    auto it = sessions_.find(fd);
+    if (it == sessions_.end()) {
+      return;
+    }
+    GatewaySessionPtr session = it.value();
+    if (enableDump_) {
+      log(log_prefix_, LogLevel::kDebug, "R[{}]:[{}]",
+          session->connection->fullName(),
+          dump(TransferMode::kMbap, *buffer));
+    }
+
+    /// a tcp client may send several requests in one segment
+    while (buffer->Len() > 0) {
+      session->decoder->Decode(*buffer, &session->request);
+      if (!session->decoder->IsDone()) {
+        return;
+      }
+      const Error error = session->decoder->LasError();
+      session->decoder->Clear();
+      if (error != Error::kNoError) {
+        log(log_prefix_, LogLevel::kError, "{} invalid request",
+            session->connection->fullName());
+        replyError(session, session->request, error);
+        continue;
+      }
+      /// framed by the mbap length, unknown function codes pass through
+      forwardRequest(session, session->request);
+    }
+  }
+
+  void forwardRequest(const GatewaySessionPtr &session, const Adu &request) {
+    if (request.isBrocast()) {
+      forwardBrocast(request);
+      return;
+    }
+
+    QModbusClient *bus = routes_[request.serverAddress()];
+    if (!bus || !bus->isOpened()) {
+      log(log_prefix_, LogLevel::kWarning, "{} no path to server address {}",
+          session->connection->fullName(), request.serverAddress());
+      replyError(session, request, Error::kUnavailableGatewayPath);
+      return;
+    }
+    int &pending = busPending_[bus];
+    if (maxPendingPerBus_ > 0 && pending >= maxPendingPerBus_) {
+      log(log_prefix_, LogLevel::kWarning,
+          "{} the bus of server address {} is busy",
+          session->connection->fullName(), request.serverAddress());
+      replyError(session, request, Error::kUnavailableGatewayPath);
+      return;
+    }
+
+    GatewayTag tag;
+    tag.id = nextTagId_++;
+    GatewayTransaction &transaction = pending_[tag.id];
+    transaction.session = session;
+    transaction.transactionId = request.transactionId();
+    transaction.serverAddress = request.serverAddress();
+    transaction.functionCode = request.functionCode();
+    transaction.bus = bus;
+    pending++;
+
+    std::unique_ptr<Request> forwarded(new Request(
+        request.serverAddress(), request.functionCode(), tag, request.data()));
+    bus->sendRequest(forwarded);
+  }
+
+  void forwardBrocast(const Adu &request) {
+    QList<QModbusClient *> buses;
+    for (auto bus : routes_) {
+      if (bus && bus->isOpened() && !buses.contains(bus)) {
+        buses.append(bus);
+      }
+    }
+    for (auto bus : buses) {
+      std::unique_ptr<Request> forwarded(new Request(request));
+      bus->sendRequest(forwarded);
+    }
+  }
+
+  void onRequestFinished(const Request &request, const Response &response) {
+    const any userData = request.userData();
+    const GatewayTag *tag = any::any_cast<GatewayTag>(&userData);
+    if (!tag) {
+      /// sent to the bus by someone else
+      return;
+    }
+    auto it = pending_.find(tag->id);
+    if (it == pending_.end()) {
+      return;
+    }
+    const GatewayTransaction transaction = it->second;
+    pending_.erase(it);
+    busPending_[transaction.bus]--;
+
+    /// the client reports a timeout and a frame that failed its check(crc,
+    /// size) as exceptions of its own, they are not the device's
+    const Error error = response.error();
+    if (error == Error::kTimeout || error == Error::kStorageParityError) {
+      replyError(transaction, Error::kGatewayTargetDeviceResponseLoss);
+      return;
+    }
+    if (response.isException()) {
+      replyError(transaction, error);
+      return;
+    }
+    Adu reply(transaction.serverAddress, transaction.functionCode);
+    reply.setData(response.data());
+    replyResponse(transaction.session.lock(), transaction.transactionId,
+                  &reply);
+  }
+
+  /**
+   * the bus dropped its queue(closed or lost the connection), the requests
+   * forwarded to it will never complete
+   */
+  void failBus(QModbusClient *bus) {
+    std::vector<GatewayTransaction> failed;
+    for (auto it = pending_.begin(); it != pending_.end();) {
+      if (it->second.bus == bus) {
+        failed.push_back(it->second);
+        it = pending_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    busPending_.remove(bus);
+    for (const auto &transaction : failed) {
+      replyError(transaction, Error::kGatewayTargetDeviceResponseLoss);
+    }
+  }
+
+  void watchBus(QModbusClient *bus) {
+    Q_Q(QModbusGateway);
+    if (buses_.contains(bus)) {
+      return;
+    }
+    buses_.append(bus);
+    QObject::connect(bus, &QModbusClient::requestFinished, q,
+                     [this](const Request &request, const Response &response) {
+                       onRequestFinished(request, response);
+                     });
+    QObject::connect(bus, &QModbusClient::clientClosed, q,
+                     [this, bus]() { failBus(bus); });
+    QObject::connect(bus, &QModbusClient::connectionIsLostWillReconnect, q,
+                     [this, bus]() { failBus(bus); });
+    QObject::connect(bus, &QObject::destroyed, q,
+                     [this, bus]() { removeBus(bus); });
+  }
+
+  void removeBus(QModbusClient *bus) {
+    for (auto &route : routes_) {
+      if (route == bus) {
+        route = nullptr;
+      }
+    }
+    buses_.removeAll(bus);
+    failBus(bus);
+  }
+
+  void replyError(const GatewayTransaction &transaction, Error error) {
+    Adu request(transaction.serverAddress, transaction.functionCode);
+    request.setTransactionId(transaction.transactionId);
+    replyError(transaction.session.lock(), request, error);
+  }
+
+  void replyError(const GatewaySessionPtr &session, const Adu &request,
+                  Error error) {
+    Adu reply(request.serverAddress(), request.functionCode());
+    reply.setError(error);
+    replyResponse(session, request.transactionId(), &reply);
+  }
+
+  void replyResponse(const GatewaySessionPtr &session, uint16_t transactionId,
+                     Adu *reply) {
+    if (!session) {
+      return;
+    }
+    reply->setTransactionId(transactionId);
+    auto &writeBuffer = session->writeBuffer;
+    session->encoder->Encode(reply, writeBuffer);
+
+    uint8_t *p = nullptr;
+    const int len = writeBuffer.Len();
+    writeBuffer.ZeroCopyRead(&p, len);
+    session->connection->write(reinterpret_cast<const char *>(p), len);
+
+    if (enableDump_) {
+      log(log_prefix_, LogLevel::kDebug, "S[{}]:[{}]",
+          session->connection->fullName(),
+          dump(TransferMode::kMbap, reinterpret_cast<const char *>(p), len));
+    }
+  }
+
+  QModbusGateway *q_ptr = nullptr;
+  AbstractServer *server_ = nullptr;
+  QMap<quintptr, GatewaySessionPtr> sessions_;
+  /// indexed by server address
+  std::array<QModbusClient *, 256> routes_;
+  QList<QModbusClient *> buses_;
+  QMap<QModbusClient *, int> busPending_;
+  std::unordered_map<uint32_t, GatewayTransaction> pending_;
+  uint32_t nextTagId_ = 0;
+  int maxPendingPerBus_ = QModbusGateway::kDefaultMaxPendingPerBus;
+  bool enableDump_ = false;
+  std::string log_prefix_;
+};
+
+const int QModbusGateway::kDefaultMaxPendingPerBus;
+
+QModbusGateway::QModbusGateway(AbstractServer *server, QObject *parent)
+    : QObject(parent), d_ptr(new QModbusGatewayPrivate(this)) {
+  qRegisterMetaType<Request>("Request");
+  qRegisterMetaType<Response>("Response");
+  Q_D(QModbusGateway);
+  d->setServer(server);
+}
+
+QModbusGateway::~QModbusGateway() = default;
+
+void QModbusGateway::addRoute(ServerAddress serverAddress,
+                              QModbusClient *bus) {
+  Q_D(QModbusGateway);
+  d->routes_[serverAddress] = bus;
+  if (bus) {
+    d->watchBus(bus);
+  }
+}
+
+void QModbusGateway::removeRoute(ServerAddress serverAddress) {
+  Q_D(QModbusGateway);
+  d->routes_[serverAddress] = nullptr;
+}
+
+QModbusClient *QModbusGateway::route(ServerAddress serverAddress) const {
+  const Q_D(QModbusGateway);
+  return d->routes_[serverAddress];
+}
+
+void QModbusGateway::setMaxPendingPerBus(int maxPending) {
+  Q_D(QModbusGateway);
+  d->maxPendingPerBus_ = maxPending;
+}
+
+int QModbusGateway::maxPendingPerBus() const {
+  const Q_D(QModbusGateway);
+  return d->maxPendingPerBus_;
+}
+
+size_t QModbusGateway::pendingRequestSize() const {
+  const Q_D(QModbusGateway);
+  return d->pending_.size();
+}
+
+void QModbusGateway::enableDump(bool enable) {
+  Q_D(QModbusGateway);
+  d->enableDump_ = enable;
+}
+
+void QModbusGateway::setPrefix(const QString &prefix) {
+  Q_D(QModbusGateway);
+  d->log_prefix_ = prefix.toStdString();
+}
+
+bool QModbusGateway::listenAndServe() {
+  Q_D(QModbusGateway);
+  return d->server_->listenAndServe();
+}
+
+} // namespace modbus
@@ -0,0 +1,32 @@
+#ifndef __MODBUS_QIODEVICE_READER_H_
+#define __MODBUS_QIODEVICE_READER_H_
+
+#include <QIODevice>
+#include <bytes/buffer.h>
+
+namespace modbus {
+
+/**
+ * read everything the device has buffered straight into the tail of buffer.
+ * the space is reserved once from bytesAvailable(), so there is no temporary
+ * QByteArray or stack buffer in between.
+ */
+inline size_t readAvailable(QIODevice *device, pp::bytes::Buffer &buffer) {
+  size_t total = 0;
+  qint64 available = device->bytesAvailable();
+  while (available > 0) {
+    uint8_t *p = buffer.BeginWrite(static_cast<size_t>(available));
+    qint64 n = device->read(reinterpret_cast<char *>(p), available);
+    if (n <= 0) {
+      break;
+    }
+    buffer.CommitWrite(static_cast<size_t>(n));
+    total += static_cast<size_t>(n);
+    available = device->bytesAvailable();
+  }
+  return total;
+}
+
+} // namespace modbus
+
+#endif // __MODBUS_QIODEVICE_READER_H_
@@ -1,5 +1,6 @@
 #include <QtSerialPort/QSerialPort>
 
+#include "modbus_qiodevice_reader.h"
 #include <modbus/tools/modbus_client.h>
 
 namespace modbus {
@@ -14,6 +15,7 @@ public:
   bool
   setBaudRate(qint32 baudRate,
               QSerialPort::Directions directions = QSerialPort::AllDirections) {
+    silence_.setBaudRate(baudRate);
     return serialPort_.setBaudRate(baudRate, directions);
   }
 
@@ -37,6 +39,8 @@ public:
     if (!success) {
       return;
     }
+    silence_.reset();
+    unread_ = 0;
     emit opened();
   }
 
@@ -50,11 +54,26 @@ public:
 
   void write(const char *data, size_t size) override {
     serialPort_.write(data, size);
+    silence_.sent(RtuSilence::now(), size);
   }
 
-  QByteArray readAll() override { return serialPort_.readAll(); }
+  QByteArray readAll() override {
+    unread_ = 0;
+    return serialPort_.readAll();
+  }
+
+  size_t readInto(pp::bytes::Buffer &buffer) override {
+    const size_t size = readAvailable(&serialPort_, buffer);
+    unread_ = serialPort_.bytesAvailable();
+    return size;
+  }
+
+  void clear() override {
+    serialPort_.clear();
+    unread_ = 0;
+  }
 
-  void clear() override { serialPort_.clear(); }
+  RtuSilence *silence() override { return &silence_; }
 
 private:
   void setupEnvironment() {
@@ -78,10 +97,27 @@ private:
     connect(&serialPort_, &QSerialPort::bytesWritten, this,
             &QtSerialPort::bytesWritten);
     connect(&serialPort_, &QSerialPort::readyRead, this,
-            &QtSerialPort::readyRead);
+            &QtSerialPort::onReadyRead);
+  }
+
+  /**
+   * the client reads the bytes later(queued), so they are timestamped here,
+   * when QSerialPort has just read them from the port
+   */
+  void onReadyRead() {
+    const qint64 available = serialPort_.bytesAvailable();
+    if (available > unread_) {
+      silence_.received(RtuSilence::now(),
+                        static_cast<size_t>(available - unread_));
+      unread_ = available;
+    }
+    emit readyRead();
   }
 
   QSerialPort serialPort_;
+  RtuSilence silence_;
+  /// the bytes available already timestamped
+  qint64 unread_ = 0;
 };
 
 QModbusClient *
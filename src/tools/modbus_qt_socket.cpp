@@ -4,6 +4,7 @@
 #include <QtNetwork/QAbstractSocket>
 #include <QtNetwork/QTcpSocket>
 #include <QtNetwork/QUdpSocket>
+#include "modbus_qiodevice_reader.h"
 #include <modbus/tools/modbus_client.h>
 
 namespace modbus {
@@ -45,6 +46,10 @@ public:
 
   QByteArray readAll() override { return socket_->readAll(); }
 
+  size_t readInto(pp::bytes::Buffer &buffer) override {
+    return readAvailable(socket_, buffer);
+  }
+
   void clear() override {}
 
 private:
@@ -115,6 +120,26 @@ public:
     return datagram;
   }
 
+  size_t readInto(pp::bytes::Buffer &buffer) override {
+    size_t total = 0;
+    while (socket_->hasPendingDatagrams()) {
+      qint64 size = socket_->pendingDatagramSize();
+      if (size <= 0) {
+        /// drop the empty datagram
+        socket_->readDatagram(nullptr, 0);
+        continue;
+      }
+      uint8_t *p = buffer.BeginWrite(static_cast<size_t>(size));
+      qint64 n = socket_->readDatagram(reinterpret_cast<char *>(p), size);
+      if (n <= 0) {
+        break;
+      }
+      buffer.CommitWrite(static_cast<size_t>(n));
+      total += static_cast<size_t>(n);
+    }
+    return total;
+  }
+
   void clear() override {}
 
 private:
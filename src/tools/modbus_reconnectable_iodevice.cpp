@@ -9,6 +9,7 @@ namespace modbus {
 ReconnectableIoDevice::ReconnectableIoDevice(modbus::AbstractIoDevice *iodevice,
                                              QObject *parent)
     : QObject(parent), d_ptr(new ReconnectableIoDevicePrivate(iodevice, this)) {
+  d_ptr->reopenTimer_.setCallback([this]() { open(); });
   setupEnvironment();
 }
 
@@ -68,6 +69,11 @@ void ReconnectableIoDevice::open() {
 
 void ReconnectableIoDevice::close() {
   Q_D(ReconnectableIoDevice);
+  if (d->reopenTimer_.isActive()) {
+    /// closed already, it does not reconnect any more
+    d->reopenTimer_.cancel();
+    return;
+  }
   d->forceClose_ = true;
   closeButNotSetForceCloseFlag();
 }
@@ -82,6 +88,11 @@ QByteArray ReconnectableIoDevice::readAll() {
   return d->ioDevice_->readAll();
 }
 
+size_t ReconnectableIoDevice::readInto(pp::bytes::Buffer &buffer) {
+  Q_D(ReconnectableIoDevice);
+  return d->ioDevice_->readInto(buffer);
+}
+
 void ReconnectableIoDevice::clear() {
   Q_D(ReconnectableIoDevice);
   return d->ioDevice_->clear();
@@ -92,6 +103,11 @@ std::string ReconnectableIoDevice::name() {
   return d->ioDevice_->name();
 }
 
+RtuSilence *ReconnectableIoDevice::silence() {
+  Q_D(ReconnectableIoDevice);
+  return d->ioDevice_->silence();
+}
+
 void ReconnectableIoDevice::setPrefix(const QString &prefix) {
   Q_D(ReconnectableIoDevice);
   d->log_prefix_ = prefix.toStdString();
@@ -150,7 +166,7 @@ void ReconnectableIoDevice::onIoDeviceClosed() {
       d->ioDevice_->name() + " closed, try reconnect after " +
           std::to_string(d->reopenDelay_) + "ms");
   d->openRetryTimes_ > 0 ? --d->openRetryTimes_ : 0;
-  QTimer::singleShot(d->reopenDelay_, this, &ReconnectableIoDevice::open);
+  d->timerWheel().schedule(&d->reopenTimer_, d->reopenDelay_);
 }
 
 bool ReconnectableIoDevice::isOpened() {
@@ -0,0 +1,216 @@
+#ifndef MODBUS_RESPONSE_CACHE_H
+#define MODBUS_RESPONSE_CACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <modbus/base/modbus.h>
+#include <unordered_map>
+
+namespace modbus {
+
+/**
+ * The responses of the reads(function code 0x01-0x04) of one client, keyed
+ * by server address + function code + start address + quantity.
+ *
+ * A response is served while it is younger than the ttl. A write to the same
+ * server(any server for a broadcast) drops the responses of the reads that
+ * overlap the written coils/holding registers.
+ */
+class ResponseCache {
+public:
+  using Clock = std::chrono::steady_clock;
+  /// expired entries are purged when the cache grows over this size
+  static const size_t kPurgeSize = 1024;
+
+  /// ttl in milliseconds, 0 disables the cache and drops all responses
+  void setTtl(int ttl) {
+    ttl_ = ttl < 0 ? 0 : ttl;
+    if (ttl_ == 0) {
+      entries_.clear();
+    }
+  }
+  int ttl() const { return ttl_; }
+  bool enabled() const { return ttl_ > 0; }
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+  void clear() { entries_.clear(); }
+
+  /**
+   * if request is a read and its response is in the cache, copy the response
+   * and return true. only reads are counted as hits/misses
+   */
+  bool lookup(const Request &request, Response *response,
+              Clock::time_point now = Clock::now()) {
+    Range range;
+    if (!enabled() || !readRange(request, &range)) {
+      return false;
+    }
+    auto it = entries_.find(key(request.serverAddress(), range));
+    if (it == entries_.end() || isExpired(it->second, now)) {
+      misses_++;
+      return false;
+    }
+    hits_++;
+    *response = it->second.response;
+    return true;
+  }
+
+  void store(const Request &request, const Response &response,
+             Clock::time_point now = Clock::now()) {
+    Range range;
+    if (!enabled() || response.isException() || !readRange(request, &range)) {
+      return;
+    }
+    if (entries_.size() >= kPurgeSize) {
+      purgeExpired(now);
+    }
+    Entry &entry = entries_[key(request.serverAddress(), range)];
+    entry.serverAddress = request.serverAddress();
+    entry.range = range;
+    entry.response = response;
+    entry.time = now;
+  }
+
+  /**
+   * drop the responses that request writes to, nothing happens if request is
+   * not a write
+   */
+  void invalidate(const Request &request) {
+    Range written;
+    if (entries_.empty() || !writeRange(request, &written)) {
+      return;
+    }
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      const Entry &entry = it->second;
+      const bool sameServer = request.isBrocast() ||
+                              entry.serverAddress == request.serverAddress();
+      if (sameServer && entry.range.functionCode == written.functionCode &&
+          overlap(entry.range, written)) {
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+private:
+  /**
+   * for a write, functionCode is the read function code of the object
+   * written, 0x01 for coils and 0x03 for holding registers
+   */
+  struct Range {
+    FunctionCode functionCode = FunctionCode::kInvalidCode;
+    Address start = 0;
+    Quantity quantity = 0;
+  };
+
+  struct Entry {
+    ServerAddress serverAddress = 0;
+    Range range;
+    Response response;
+    Clock::time_point time;
+  };
+
+  static uint16_t uint16At(const ByteArray &data, size_t index) {
+    return data[index] * 256 + data[index + 1];
+  }
+
+  static bool readRange(const Request &request, Range *range) {
+    const auto &data = request.data();
+    switch (request.functionCode()) {
+    case FunctionCode::kReadCoils:
+    case FunctionCode::kReadInputDiscrete:
+    case FunctionCode::kReadHoldingRegisters:
+    case FunctionCode::kReadInputRegister:
+      break;
+    default:
+      return false;
+    }
+    if (data.size() < 4 || request.isBrocast()) {
+      return false;
+    }
+    range->functionCode = request.functionCode();
+    range->start = uint16At(data, 0);
+    range->quantity = uint16At(data, 2);
+    return true;
+  }
+
+  static bool writeRange(const Request &request, Range *range) {
+    const auto &data = request.data();
+    switch (request.functionCode()) {
+    case FunctionCode::kWriteSingleCoil:
+    case FunctionCode::kWriteMultipleCoils:
+      range->functionCode = FunctionCode::kReadCoils;
+      break;
+    case FunctionCode::kWriteSingleRegister:
+    case FunctionCode::kWriteMultipleRegisters:
+    case FunctionCode::kMaskWriteRegister:
+    case FunctionCode::kReadWriteMultipleRegisters:
+      range->functionCode = FunctionCode::kReadHoldingRegisters;
+      break;
+    default:
+      return false;
+    }
+
+    switch (request.functionCode()) {
+    case FunctionCode::kWriteSingleCoil:
+    case FunctionCode::kWriteSingleRegister:
+    case FunctionCode::kMaskWriteRegister:
+      if (data.size() < 2) {
+        return false;
+      }
+      range->start = uint16At(data, 0);
+      range->quantity = 1;
+      return true;
+    case FunctionCode::kReadWriteMultipleRegisters:
+      if (data.size() < 8) {
+        return false;
+      }
+      range->start = uint16At(data, 4);
+      range->quantity = uint16At(data, 6);
+      return true;
+    default:
+      if (data.size() < 4) {
+        return false;
+      }
+      range->start = uint16At(data, 0);
+      range->quantity = uint16At(data, 2);
+      return true;
+    }
+  }
+
+  static bool overlap(const Range &a, const Range &b) {
+    return a.start < b.start + b.quantity && b.start < a.start + a.quantity;
+  }
+
+  static uint64_t key(ServerAddress serverAddress, const Range &range) {
+    return (static_cast<uint64_t>(serverAddress) << 40) |
+           (static_cast<uint64_t>(range.functionCode) << 32) |
+           (static_cast<uint64_t>(range.start) << 16) | range.quantity;
+  }
+
+  bool isExpired(const Entry &entry, Clock::time_point now) const {
+    return now - entry.time >= std::chrono::milliseconds(ttl_);
+  }
+
+  void purgeExpired(Clock::time_point now) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (isExpired(it->second, now)) {
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  int ttl_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  std::unordered_map<uint64_t, Entry> entries_;
+};
+
+} // namespace modbus
+
+#endif /* MODBUS_RESPONSE_CACHE_H */
@@ -0,0 +1,447 @@
+#include <modbus/tools/modbus_serial_engine.h>
+
+#if defined(__linux__)
+
+#include "modbus_epoll_thread.h"
+#include <base/modbus_logger.h>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <modbus_frame.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <vector>
+
+namespace modbus {
+
+namespace {
+const size_t kReadSize = 256;
+/// the tick of the timers of the ports, microseconds
+const int64_t kTimerTick = 100;
+} // namespace
+
+struct EnginePort;
+
+/// a request from sendRequest() to requestFinished()
+struct EngineJob : public RequestJob {
+  EnginePort *port = nullptr;
+};
+
+enum class EnginePortState {
+  kIdle,
+  /// waiting t3.5 before the next request, or the brocast delay
+  kFrameDelay,
+  kSendingRequest,
+  kWaitingResponse,
+  /// failed, waiting reopenDelay
+  kClosed
+};
+
+class EngineThread;
+/**
+ * the state of a port, only touched by its thread once it is attached.
+ * times are microseconds of RtuSilence::now()
+ */
+struct EnginePort : public MpscNode {
+  EnginePort(SerialEngine::PortId id, const SerialEnginePort &config,
+             const std::string &path, int fd)
+      : id(id), config(config), path(path), fd(fd),
+        decoder(sharedCheckSizeFuncTableForClient()),
+        silence(config.termios.baudRate) {}
+
+  const SerialEngine::PortId id;
+  const SerialEnginePort config;
+  const std::string path;
+  int fd;
+  EngineThread *thread = nullptr;
+  /// set by its thread once it polls it
+  bool attached = false;
+  EnginePortState state = EnginePortState::kIdle;
+  /// the timer of the state
+  TimerWheel::Timer timer;
+  /// the time the line got silent
+  int64_t idleSince = 0;
+  bool watchingWritable = false;
+  /// the first one is on the line
+  std::deque<EngineJob *> queue;
+  pp::bytes::Buffer readBuffer;
+  pp::bytes::Buffer writeBuffer;
+  ModbusRtuFrameDecoder decoder;
+  ModbusRtuFrameEncoder encoder;
+  RtuSilence silence;
+};
+
+/**
+ * a thread polling its ports, the timer of each port is on the wheel of the
+ * thread, with a tick of kTimerTick
+ */
+class EngineThread : public LineThread<EnginePort, EngineJob> {
+public:
+  EngineThread(int index, FinishedJobs<EngineJob> *finished)
+      : LineThread(kTimerTick, index, finished) {
+    start();
+  }
+
+  ~EngineThread() override { stop(); }
+
+protected:
+  void onWakeUp() override {
+    attachPorts();
+    const int64_t now = RtuSilence::now();
+    while (EngineJob *job = takeJob()) {
+      EnginePort *port = job->port;
+      if (!port->attached) {
+        /// attached before the job was posted, it shows up now
+        attachPorts();
+      }
+      if (port->state == EnginePortState::kClosed) {
+        finish(job, Error::kTimeout);
+        continue;
+      }
+      job->retryTimes = port->config.retryTimes;
+      port->queue.push_back(job);
+      schedule(port, now);
+    }
+  }
+
+  void onEvents(void *ptr, uint32_t events) override {
+    EnginePort *port = static_cast<EnginePort *>(ptr);
+    if (events & EPOLLOUT) {
+      onWritable(port);
+    }
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+      onReadable(port);
+    }
+  }
+
+private:
+  void attachPorts() {
+    while (EnginePort *port = takeLine()) {
+      port->attached = true;
+      port->timer.setCallback(
+          [this, port]() { onTimer(port, RtuSilence::now()); });
+      watch(port->fd, port, EPOLLIN);
+    }
+  }
+
+  void watchWritable(EnginePort *port, bool enable) {
+    if (port->watchingWritable == enable) {
+      return;
+    }
+    modify(port->fd, port, enable ? EPOLLIN | EPOLLOUT : EPOLLIN);
+    port->watchingWritable = enable;
+  }
+
+  /// the timer of port fires at
+  void startTimer(EnginePort *port, int64_t at, int64_t now) {
+    wheel().schedule(&port->timer, at - now);
+  }
+
+  /// send the next request once the line has been silent for t3.5
+  void schedule(EnginePort *port, int64_t now) {
+    if (port->state != EnginePortState::kIdle || port->queue.empty()) {
+      return;
+    }
+    const int64_t at = port->idleSince + port->silence.t3_5();
+    if (at > now) {
+      port->state = EnginePortState::kFrameDelay;
+      startTimer(port, at, now);
+      return;
+    }
+    port->state = EnginePortState::kSendingRequest;
+    port->readBuffer.Reset();
+    port->decoder.Clear();
+    port->writeBuffer.Reset();
+    port->encoder.Encode(&port->queue.front()->request, port->writeBuffer);
+    flush(port, now);
+  }
+
+  void flush(EnginePort *port, int64_t now) {
+    uint8_t *p = nullptr;
+    const size_t len = port->writeBuffer.Len();
+    port->writeBuffer.ZeroCopyPeekAt(&p, 0, len);
+    const ssize_t n = ::write(port->fd, p, len);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        watchWritable(port, true);
+        return;
+      }
+      fail(port, std::string("write ") + std::strerror(errno), now);
+      return;
+    }
+    port->writeBuffer.ZeroCopyRead(&p, static_cast<size_t>(n));
+    port->silence.sent(now, static_cast<size_t>(n));
+    if (port->writeBuffer.Len() > 0) {
+      watchWritable(port, true);
+      return;
+    }
+    watchWritable(port, false);
+
+    /// the bytes are still leaving the uart
+    port->idleSince = now + n * port->silence.characterTime();
+    EngineJob *job = port->queue.front();
+    if (job->request.isBrocast()) {
+      port->queue.pop_front();
+      finish(job, Error::kNoError);
+      port->state = EnginePortState::kFrameDelay;
+      startTimer(port,
+                 port->idleSince +
+                     int64_t(port->config.waitConversionDelay) * 1000,
+                 now);
+      return;
+    }
+    port->state = EnginePortState::kWaitingResponse;
+    startTimer(port,
+               port->idleSince +
+                   int64_t(port->config.waitResponseTimeout) * 1000,
+               now);
+  }
+
+  void onWritable(EnginePort *port) {
+    if (port->fd >= 0 && port->state == EnginePortState::kSendingRequest) {
+      flush(port, RtuSilence::now());
+    }
+  }
+
+  void onReadable(EnginePort *port) {
+    if (port->fd < 0) {
+      return;
+    }
+    const int64_t now = RtuSilence::now();
+    const size_t offset = port->readBuffer.Len();
+    size_t total = 0;
+    for (;;) {
+      uint8_t *p = port->readBuffer.BeginWrite(kReadSize);
+      const ssize_t n = ::read(port->fd, p, kReadSize);
+      if (n > 0) {
+        port->readBuffer.CommitWrite(static_cast<size_t>(n));
+        total += static_cast<size_t>(n);
+        if (static_cast<size_t>(n) < kReadSize) {
+          break;
+        }
+      } else if (n == 0) {
+        fail(port, "hung up", now);
+        return;
+      } else if (errno != EINTR) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          fail(port, std::string("read ") + std::strerror(errno), now);
+          return;
+        }
+        break;
+      }
+    }
+    if (total == 0) {
+      return;
+    }
+    port->silence.received(now, total);
+    port->idleSince = now;
+    const RtuSilenceGaps gaps = port->silence.take();
+
+    if (port->state != EnginePortState::kWaitingResponse) {
+      log("", LogLevel::kWarning, "{}: got unexpected data, discard them.[{}]",
+          port->path, dump(TransferMode::kRtu, port->readBuffer));
+      port->readBuffer.Reset();
+      return;
+    }
+    if (port->config.enableRtuSilenceDetection && !gaps.empty()) {
+      port->decoder.Silence(port->readBuffer, offset, gaps);
+    }
+
+    EngineJob *job = port->queue.front();
+    Response &response = job->response;
+    port->decoder.Decode(port->readBuffer, &response);
+    if (!port->decoder.IsDone()) {
+      return;
+    }
+    const Error lastError = port->decoder.LasError();
+    port->decoder.Clear();
+    if (response.serverAddress() != job->request.serverAddress() ||
+        response.functionCode() != job->request.functionCode()) {
+      log("", LogLevel::kWarning, "{}: got unexpected response, discard it",
+          port->path);
+      port->readBuffer.Reset();
+      return;
+    }
+    if (lastError != Error::kNoError) {
+      response.setError(lastError);
+    }
+
+    port->readBuffer.Reset();
+    port->queue.pop_front();
+    finish(job, response.error());
+    port->state = EnginePortState::kIdle;
+    port->timer.cancel();
+    schedule(port, now);
+  }
+
+  void onTimer(EnginePort *port, int64_t now) {
+    switch (port->state) {
+    case EnginePortState::kFrameDelay:
+      port->state = EnginePortState::kIdle;
+      schedule(port, now);
+      break;
+    case EnginePortState::kWaitingResponse: {
+      port->decoder.Clear();
+      port->readBuffer.Reset();
+      port->state = EnginePortState::kIdle;
+      EngineJob *job = port->queue.front();
+      if (job->retryTimes-- > 0) {
+        log("", LogLevel::kWarning,
+            "{}: waiting response timeout, retry it, retrytimes {}",
+            port->path, job->retryTimes);
+      } else {
+        log("", LogLevel::kWarning, "{}: waiting response timeout",
+            port->path);
+        port->queue.pop_front();
+        finish(job, Error::kTimeout);
+      }
+      schedule(port, now);
+      break;
+    }
+    case EnginePortState::kClosed:
+      reopen(port, now);
+      break;
+    default:
+      break;
+    }
+  }
+
+  /// close the port, its requests finish with kTimeout
+  void fail(EnginePort *port, const std::string &why, int64_t now) {
+    log("", LogLevel::kError, "{}: {}, close it", port->path, why);
+    unwatch(port->fd);
+    ::close(port->fd);
+    port->fd = -1;
+    port->watchingWritable = false;
+    port->readBuffer.Reset();
+    port->writeBuffer.Reset();
+    port->decoder.Clear();
+    while (!port->queue.empty()) {
+      finish(port->queue.front(), Error::kTimeout);
+      port->queue.pop_front();
+    }
+    port->state = EnginePortState::kClosed;
+    startTimer(port, now + int64_t(port->config.reopenDelay) * 1000, now);
+  }
+
+  void reopen(EnginePort *port, int64_t now) {
+    std::string errorString;
+    port->fd = openTermios(port->path, port->config.termios, &errorString);
+    if (port->fd < 0) {
+      log("", LogLevel::kWarning, "{}", errorString);
+      startTimer(port, now + int64_t(port->config.reopenDelay) * 1000, now);
+      return;
+    }
+    watch(port->fd, port, EPOLLIN);
+    port->silence.reset();
+    port->idleSince = now;
+    port->state = EnginePortState::kIdle;
+  }
+};
+
+class SerialEnginePrivate {
+public:
+  explicit SerialEnginePrivate(SerialEngine *q) : finished_(q), q_ptr(q) {}
+
+  /// requestFinished is emitted on the thread of the engine
+  FinishedJobs<EngineJob> finished_;
+  std::vector<std::unique_ptr<EngineThread>> threads_;
+  std::vector<std::unique_ptr<EnginePort>> ports_;
+  QString errorString_;
+  SerialEngine *q_ptr;
+};
+
+SerialEngine::SerialEngine(int threadCount, QObject *parent)
+    : QObject(parent), d_ptr(new SerialEnginePrivate(this)) {
+  Q_D(SerialEngine);
+  threadCount = std::max(threadCount, 1);
+  for (int i = 0; i < threadCount; i++) {
+    d->threads_.emplace_back(new EngineThread(i, &d->finished_));
+  }
+}
+
+SerialEngine::~SerialEngine() {
+  Q_D(SerialEngine);
+  for (auto &thread : d->threads_) {
+    thread->stop();
+    thread->dropJobs();
+  }
+  d->threads_.clear();
+  for (auto &port : d->ports_) {
+    for (auto job : port->queue) {
+      delete job;
+    }
+    if (port->fd >= 0) {
+      ::close(port->fd);
+    }
+  }
+}
+
+SerialEngine::PortId SerialEngine::addPort(const SerialEnginePort &port) {
+  Q_D(SerialEngine);
+  std::string errorString;
+  const std::string path = termiosPortLocation(port.portName);
+  const int fd = openTermios(path, port.termios, &errorString);
+  if (fd < 0) {
+    d->errorString_ = QString::fromStdString(errorString);
+    return -1;
+  }
+
+  EngineThread *thread = leastLoaded(d->threads_);
+  const PortId id = static_cast<PortId>(d->ports_.size());
+  EnginePort *enginePort = new EnginePort(id, port, path, fd);
+  enginePort->thread = thread;
+  enginePort->idleSince = RtuSilence::now();
+  d->ports_.emplace_back(enginePort);
+  thread->lineCount++;
+  thread->attach(enginePort);
+  return id;
+}
+
+bool SerialEngine::sendRequest(PortId port, const Request &request) {
+  Q_D(SerialEngine);
+  if (port < 0 || port >= static_cast<PortId>(d->ports_.size())) {
+    return false;
+  }
+  EngineJob *job = new EngineJob();
+  job->port = d->ports_[port].get();
+  job->request = request;
+  job->port->thread->post(job);
+  return true;
+}
+
+int SerialEngine::threadCount() const {
+  const Q_D(SerialEngine);
+  return static_cast<int>(d->threads_.size());
+}
+
+int SerialEngine::portCount() const {
+  const Q_D(SerialEngine);
+  return static_cast<int>(d->ports_.size());
+}
+
+int SerialEngine::threadOf(PortId port) const {
+  const Q_D(SerialEngine);
+  if (port < 0 || port >= static_cast<PortId>(d->ports_.size())) {
+    return -1;
+  }
+  return d->ports_[port]->thread->index();
+}
+
+QString SerialEngine::errorString() const {
+  const Q_D(SerialEngine);
+  return d->errorString_;
+}
+
+bool SerialEngine::event(QEvent *e) {
+  Q_D(SerialEngine);
+  const bool taken = d->finished_.take(e, [this](EngineJob *job) {
+    emit requestFinished(job->port->id, job->request, job->response);
+  });
+  return taken || QObject::event(e);
+}
+
+} // namespace modbus
+
+#endif // __linux__
@@ -1,15 +1,27 @@
+#include "modbus_qiodevice_reader.h"
 #include <QSerialPort>
 #include <base/modbus_frame.h>
 #include <base/modbus_logger.h>
 #include <bytes/buffer.h>
+#include <modbus/tools/modbus_client.h>
 #include <modbus/tools/modbus_server.h>
 
 namespace modbus {
-class SerialConnection : public AbstractConnection {
+/// the only connection of a serial server, opened by it
+class AbstractSerialConnection : public AbstractConnection {
+  Q_OBJECT
+public:
+  explicit AbstractSerialConnection(QObject *parent = nullptr)
+      : AbstractConnection(parent) {}
+  ~AbstractSerialConnection() override = default;
+  virtual bool open() = 0;
+};
+
+class SerialConnection : public AbstractSerialConnection {
   Q_OBJECT
 public:
   explicit SerialConnection(QSerialPort *serialPort, QObject *parent = nullptr)
-      : AbstractConnection(parent), serialPort_(serialPort),
+      : AbstractSerialConnection(parent), serialPort_(serialPort),
         readBuffer_(new pp::bytes::Buffer()) {
     connect(serialPort_, &QSerialPort::aboutToClose, this,
             [&]() { emit disconnected(fd()); });
@@ -18,7 +30,7 @@ public:
   }
   ~SerialConnection() override = default;
 
-  bool open() {
+  bool open() override {
     bool success = serialPort_->open(QIODevice::ReadWrite);
     if (!success) {
       log(prefix(), LogLevel::kError, "open {} {}",
@@ -26,12 +38,15 @@ public:
           serialPort_->errorString().toStdString());
       return false;
     }
+    silence_.setBaudRate(serialPort_->baudRate());
+    silence_.reset();
     return true;
   }
   quintptr fd() const override { return quintptr(serialPort_->handle()); }
 
   void write(const char *data, size_t size) override {
     serialPort_->write(data, size);
+    silence_.sent(RtuSilence::now(), size);
   }
 
   std::string name() const override {
@@ -42,18 +57,83 @@ public:
     return serialPort_->portName().toStdString();
   }
 
+  size_t readInto(pp::bytes::Buffer &buffer) override {
+    return readAvailable(serialPort_, buffer);
+  }
+
+  RtuSilence *silence() override { return &silence_; }
+
 private:
   void onClientReadyRead() {
-    while (serialPort_->bytesAvailable() > 0) {
-      char buf[1024] = {0};
-      int size = serialPort_->read(buf, sizeof(buf));
-      readBuffer_->Write(buf, size);
-    }
+    /// read at once, so the time of the read is the time of the bytes
+    const size_t size = readInto(*readBuffer_);
+    silence_.received(RtuSilence::now(), size);
     emit messageArrived(fd(), readBuffer_);
   }
 
   QSerialPort *serialPort_;
   BytesBufferPtr readBuffer_;
+  RtuSilence silence_;
+};
+
+/// a serial port backend of the client, e.g. TermiosSerialPort
+class IoDeviceConnection : public AbstractSerialConnection {
+  Q_OBJECT
+public:
+  explicit IoDeviceConnection(AbstractIoDevice *device,
+                              QObject *parent = nullptr)
+      : AbstractSerialConnection(parent), device_(device),
+        readBuffer_(new pp::bytes::Buffer()) {
+    device_->setParent(this);
+    connect(device_, &AbstractIoDevice::closed, this,
+            [&]() { emit disconnected(fd()); });
+    connect(device_, &AbstractIoDevice::readyRead, this,
+            &IoDeviceConnection::onClientReadyRead);
+  }
+  ~IoDeviceConnection() override = default;
+
+  /// the backends of serial ports open synchronously
+  bool open() override {
+    bool opened = false;
+    QString errorString;
+    auto onOpened = connect(device_, &AbstractIoDevice::opened, this,
+                            [&]() { opened = true; });
+    auto onError =
+        connect(device_, &AbstractIoDevice::error, this,
+                [&](const QString &error) { errorString = error; });
+    device_->open();
+    disconnect(onOpened);
+    disconnect(onError);
+    if (!opened) {
+      log(prefix(), LogLevel::kError, "open {} {}", device_->name(),
+          errorString.toStdString());
+    }
+    return opened;
+  }
+  quintptr fd() const override { return quintptr(device_); }
+
+  void write(const char *data, size_t size) override {
+    device_->write(data, size);
+  }
+
+  std::string name() const override { return device_->name(); }
+
+  std::string fullName() const override { return device_->name(); }
+
+  size_t readInto(pp::bytes::Buffer &buffer) override {
+    return device_->readInto(buffer);
+  }
+
+  RtuSilence *silence() override { return device_->silence(); }
+
+private:
+  void onClientReadyRead() {
+    readInto(*readBuffer_);
+    emit messageArrived(fd(), readBuffer_);
+  }
+
+  AbstractIoDevice *device_;
+  BytesBufferPtr readBuffer_;
 };
 
 class SerialServer : public AbstractServer {
@@ -62,6 +142,10 @@ public:
   explicit SerialServer(QSerialPort *serialPort, QObject *parent = nullptr)
       : AbstractServer(parent),
         serialConnection_(new SerialConnection(serialPort, this)) {}
+  explicit SerialServer(AbstractIoDevice *serialPort,
+                        QObject *parent = nullptr)
+      : AbstractServer(parent),
+        serialConnection_(new IoDeviceConnection(serialPort, this)) {}
 
   bool listenAndServe() override {
     bool success = serialConnection_->open();
@@ -73,7 +157,7 @@ public:
   }
 
 private:
-  SerialConnection *serialConnection_;
+  AbstractSerialConnection *serialConnection_;
 };
 
 QModbusServer *createQModbusSerialServer(const QString &serialName,
@@ -95,6 +179,14 @@ QModbusServer *createQModbusSerialServer(const QString &serialName,
   return modbusServer;
 }
 
+QModbusServer *createQModbusSerialServer(AbstractIoDevice *serialPort,
+                                         QObject *parent) {
+  auto serialServer = new SerialServer(serialPort, parent);
+  auto modbusServer = new QModbusServer(serialServer, parent);
+  modbusServer->setTransferMode(TransferMode::kRtu);
+  return modbusServer;
+}
+
 } // namespace modbus
 
 #include "modbus_serial_server.moc"
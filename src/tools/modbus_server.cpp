@@ -4,6 +4,7 @@
 #include <modbus/base/single_bit_access.h>
 #include <modbus/base/smart_assert.h>
 #include <modbus/tools/modbus_server.h>
+#include <modbus/tools/modbus_termios_serialport.h>
 
 namespace modbus {
 QModbusServer::QModbusServer(AbstractServer *server, QObject *parent)
@@ -12,6 +13,7 @@ QModbusServer::QModbusServer(AbstractServer *server, QObject *parent)
   qRegisterMetaType<Address>("Address");
   qRegisterMetaType<QVector<SixteenBitValue>>("QVector<SixteenBitValue>");
   qRegisterMetaType<ByteArray>("ByteArray");
+  qRegisterMetaType<QVector<AddressRange>>("QVector<AddressRange>");
   Q_D(QModbusServer);
   d->setServer(server);
   d->setEnv();
@@ -54,6 +56,41 @@ void QModbusServer::setPrefix(const QString &prefix) {
   d->log_prefix_ = prefix.toStdString();
 }
 
+bool QModbusServer::mapRegisters(StorageKind kind, const QString &fileName) {
+  Q_D(QModbusServer);
+  return d->mapRegisters(kind, fileName);
+}
+
+bool QModbusServer::enableSnapshot(const QString &fileName, int msec) {
+  Q_D(QModbusServer);
+  return d->enableSnapshot(fileName, msec);
+}
+
+void QModbusServer::saveSnapshot() {
+  Q_D(QModbusServer);
+  d->saveSnapshot();
+}
+
+void QModbusServer::setChangeNotifyInterval(int msec) {
+  Q_D(QModbusServer);
+  d->setChangeNotifyInterval(msec);
+}
+
+int QModbusServer::changeNotifyInterval() const {
+  const Q_D(QModbusServer);
+  return d->changeNotifyInterval();
+}
+
+void QModbusServer::enablePerAddressSignals(bool enable) {
+  Q_D(QModbusServer);
+  d->enablePerAddressSignals(enable);
+}
+
+void QModbusServer::enableRtuSilenceDetection(bool enable) {
+  Q_D(QModbusServer);
+  d->enableRtuSilenceDetection_ = enable;
+}
+
 ServerAddress QModbusServer::serverAddress() const {
   const Q_D(QModbusServer);
   return d->serverAddress();
@@ -81,6 +118,23 @@ void QModbusServer::setCanWriteSixteenBitValueFunc(
   d->setCanWriteSixteenBitValueFunc(func);
 }
 
+void QModbusServer::setCanWriteSingleBitRangeFunc(
+    const canWriteSingleBitRangeFunc &func) {
+  Q_D(QModbusServer);
+  d->setCanWriteSingleBitRangeFunc(func);
+}
+
+void QModbusServer::setCanWriteSixteenBitRangeFunc(
+    const canWriteSixteenBitRangeFunc &func) {
+  Q_D(QModbusServer);
+  d->setCanWriteSixteenBitRangeFunc(func);
+}
+
+void QModbusServer::setRawRequestHandler(const rawRequestHandlerFunc &func) {
+  Q_D(QModbusServer);
+  d->rawRequestHandler_ = func;
+}
+
 // read write
 void QModbusServer::handleHoldingRegisters(Address startAddress,
                                            Quantity quantity) {
@@ -169,6 +223,14 @@ QModbusServer *createServer(const QString &url, QObject *parent) {
 
   log("", LogLevel::kInfo, "instanced modbus server on {}", url.toStdString());
   if (config.scheme == "modbus.file") {
+#if defined(__linux__)
+    if (config.options.value("backend") == "termios") {
+      return createQModbusTermiosSerialServer(config.serialName,
+                                              config.baudRate, config.dataBits,
+                                              config.parity, config.stopBits,
+                                              parent);
+    }
+#endif
     return createQModbusSerialServer(config.serialName, config.baudRate,
                                      config.dataBits, config.parity,
                                      config.stopBits, parent);
@@ -1,23 +1,23 @@
 #ifndef __MODBUS_SERVER_P_H_
 #define __MODBUS_SERVER_P_H_
 
+#include "modbus_dirty_ranges.h"
 #include "modbusserver_client_session.h"
+#include <QFile>
+#include <QMetaMethod>
+#include <QTimer>
 #include <algorithm>
 #include <base/modbus_frame.h>
 #include <base/modbus_logger.h>
+#include <cstring>
 #include <fmt/core.h>
 #include <fmt/ostream.h>
+#include <modbus/base/modbus_shared_registers.h>
+#include <modbus/base/modbus_storage_snapshot.h>
 #include <modbus/base/smart_assert.h>
 #include <modbus/tools/modbus_server.h>
 
 namespace modbus {
-enum class StorageKind {
-  kCoils,
-  kInputDiscrete,
-  kHoldingRegisters,
-  kInputRegisters
-};
-
 #define sessionIteratorOrReturn(it, fd)                                        \
   auto it = sessionList_.find(fd);                                             \
   if (it == sessionList_.end()) {                                              \
@@ -27,6 +27,12 @@ enum class StorageKind {
 #define DeferRun(functor)                                                      \
   std::shared_ptr<void> _##__LINE__(nullptr, std::bind(functor))
 
+/// a register table mapped from a file, the file must outlive the mapping
+struct SharedRegisterFile {
+  QFile file;
+  SharedRegisters registers;
+};
+
 struct HandleFuncEntry {
   FunctionCode functionCode;
   SingleBitAccess *singleBitAccess;
@@ -46,7 +52,15 @@ public:
     kStorageParityError
   };
 
-  explicit QModbusServerPrivate(QModbusServer *q) : q_ptr(q) {}
+  explicit QModbusServerPrivate(QModbusServer *q) : q_ptr(q) {
+    changeNotifyTimer_.setSingleShot(true);
+    connect(&changeNotifyTimer_, &QTimer::timeout, this,
+            &QModbusServerPrivate::flushChanges);
+    connect(&snapshotTimer_, &QTimer::timeout, this,
+            &QModbusServerPrivate::saveSnapshot);
+  }
+
+  ~QModbusServerPrivate() { closeSnapshot(); }
 
   int maxClients() const { return maxClient_; }
   TransferMode transferMode() const { return transferMode_; }
@@ -76,6 +90,66 @@ public:
 
   void enableDump(bool enable) { enableDump_ = enable; }
 
+  void enablePerAddressSignals(bool enable) { perAddressSignals_ = enable; }
+
+  void setChangeNotifyInterval(int msec) {
+    changeNotifyInterval_ = std::max(0, msec);
+    if (changeNotifyInterval_ == 0) {
+      changeNotifyTimer_.stop();
+      flushChanges();
+    }
+  }
+  int changeNotifyInterval() const { return changeNotifyInterval_; }
+
+  void markChanged(StorageKind kind, Address start, Quantity quantity) {
+    dirtyRanges_[static_cast<int>(kind)].mark(start, quantity);
+    if (snapshot_.isAttached()) {
+      snapshotDirty_[static_cast<int>(kind)].mark(start, quantity);
+    }
+  }
+
+  /**
+   * called once a request or a local write is done, the changes are delivered
+   * right away, or by the next tick if an interval is set
+   */
+  void notifyChanges() {
+    if (changeNotifyInterval_ == 0) {
+      flushChanges();
+    } else if (!changeNotifyTimer_.isActive()) {
+      changeNotifyTimer_.start(changeNotifyInterval_);
+    }
+  }
+
+  void flushChanges() {
+    Q_Q(QModbusServer);
+    for (int i = 0; i < 4; i++) {
+      auto &dirty = dirtyRanges_[i];
+      if (dirty.empty()) {
+        continue;
+      }
+      const auto taken = dirty.take();
+      QVector<AddressRange> ranges;
+      ranges.reserve(taken.size());
+      for (const auto &range : taken) {
+        ranges.append(range);
+      }
+      switch (static_cast<StorageKind>(i)) {
+      case StorageKind::kCoils:
+        emit q->coilsChanged(ranges);
+        break;
+      case StorageKind::kInputDiscrete:
+        emit q->inputDiscreteChanged(ranges);
+        break;
+      case StorageKind::kHoldingRegisters:
+        emit q->holdingRegistersChanged(ranges);
+        break;
+      case StorageKind::kInputRegisters:
+        emit q->inputRegistersChanged(ranges);
+        break;
+      }
+    }
+  }
+
   // read write
   void handleCoils(Address startAddress, Quantity quantity) {
     coils_.setStartAddress(startAddress);
@@ -106,6 +180,7 @@ public:
     handleFunc(kReadHoldingRegisters, &holdingRegister_);
     handleFunc(kWriteSingleRegister, &holdingRegister_);
     handleFunc(kWriteMultipleRegisters, &holdingRegister_);
+    handleFunc(kMaskWriteRegister, &holdingRegister_);
     handleFunc(kReadWriteMultipleRegisters, &holdingRegister_);
   }
 
@@ -180,10 +255,355 @@ public:
           address, access.startAddress(), access.quantity());
       return false;
     }
-    *value = v;
+    auto *shared = sharedRegisters(&access);
+    *value = shared ? SixteenBitValue(shared->value(address)) : v;
+    return true;
+  }
+
+  SixteenBitAccess *sixteenBitStorage(StorageKind kind) {
+    switch (kind) {
+    case StorageKind::kHoldingRegisters:
+      return &holdingRegister_;
+    case StorageKind::kInputRegisters:
+      return &inputRegister_;
+    default:
+      return nullptr;
+    }
+  }
+
+  /// the shared mapping of the table if mapRegisters() was called for it
+  SharedRegisters *sharedRegisters(const SixteenBitAccess *set) {
+    StorageKind kind = StorageKind::kHoldingRegisters;
+    if (set == &inputRegister_) {
+      kind = StorageKind::kInputRegisters;
+    } else if (set != &holdingRegister_) {
+      return nullptr;
+    }
+    auto &shared = sharedRegisterFiles_[static_cast<int>(kind)];
+    return shared ? &shared->registers : nullptr;
+  }
+
+  /**
+   * serve the table from a file mapped into memory, a new file is created
+   * with the layout of SharedRegisters and the current values, an existing
+   * one must have the same start address and quantity and keeps its values
+   */
+  bool mapRegisters(StorageKind kind, const QString &fileName) {
+    SixteenBitAccess *set = sixteenBitStorage(kind);
+    if (!set || set->quantity() == 0) {
+      log(log_prefix_, LogLevel::kError,
+          "map {}: only handled register tables can be mapped",
+          fileName.toStdString());
+      return false;
+    }
+
+    std::unique_ptr<SharedRegisterFile> shared(new SharedRegisterFile);
+    shared->file.setFileName(fileName);
+    if (!shared->file.open(QIODevice::ReadWrite)) {
+      log(log_prefix_, LogLevel::kError, "map {}: open failed",
+          fileName.toStdString());
+      return false;
+    }
+    const bool created = shared->file.size() == 0;
+    const qint64 size = SharedRegisters::requiredSize(set->quantity());
+    if (created && !shared->file.resize(size)) {
+      log(log_prefix_, LogLevel::kError, "map {}: resize failed",
+          fileName.toStdString());
+      return false;
+    }
+    uchar *memory = shared->file.map(0, shared->file.size());
+    if (!memory) {
+      log(log_prefix_, LogLevel::kError, "map {}: map failed",
+          fileName.toStdString());
+      return false;
+    }
+
+    auto &registers = shared->registers;
+    bool ok = created ? registers.format(memory, size, set->startAddress(),
+                                         set->quantity())
+                      : registers.attach(memory, shared->file.size());
+    if (!ok || registers.startAddress() != set->startAddress() ||
+        registers.quantity() != set->quantity()) {
+      log(log_prefix_, LogLevel::kError,
+          "map {}: layout mismatch, expect start {} quantity {}",
+          fileName.toStdString(), set->startAddress(), set->quantity());
+      return false;
+    }
+    if (created) {
+      registers.write(set->startAddress(), set->valueArray().data(),
+                      set->quantity());
+    }
+    sharedRegisterFiles_[static_cast<int>(kind)] = std::move(shared);
+    return true;
+  }
+
+  void snapshotTables(SnapshotTable (&tables)[StorageSnapshot::kTableCount]) {
+    const SingleBitAccess *bits[] = {&coils_, &inputDiscrete_};
+    for (int i = 0; i < 2; i++) {
+      tables[i].startAddress = bits[i]->startAddress();
+      tables[i].quantity = bits[i]->quantity();
+    }
+    const SixteenBitAccess *registers[] = {&holdingRegister_, &inputRegister_};
+    for (int i = 0; i < 2; i++) {
+      tables[i + 2].startAddress = registers[i]->startAddress();
+      tables[i + 2].quantity = registers[i]->quantity();
+    }
+  }
+
+  bool enableSnapshot(const QString &fileName, int msec) {
+    closeSnapshot();
+
+    std::unique_ptr<QFile> file(new QFile(fileName));
+    if (!file->open(QIODevice::ReadWrite)) {
+      log(log_prefix_, LogLevel::kError, "snapshot {}: open failed",
+          fileName.toStdString());
+      return false;
+    }
+    snapshotFile_ = std::move(file);
+
+    if (snapshotFile_->size() > 0) {
+      snapshotMemory_ = snapshotFile_->map(0, snapshotFile_->size());
+      if (snapshotMemory_ &&
+          snapshot_.attach(snapshotMemory_, snapshotFile_->size())) {
+        restoreSnapshot();
+      } else {
+        log(log_prefix_, LogLevel::kWarning,
+            "snapshot {}: invalid snapshot, start a new one",
+            fileName.toStdString());
+      }
+    }
+    if (!snapshot_.isAttached() && !rebuildSnapshot()) {
+      closeSnapshot();
+      return false;
+    }
+    snapshotTimer_.start(std::max(1, msec));
     return true;
   }
 
+  /**
+   * copy the values back into the tables handled with the same address
+   * range as in the snapshot, the registers with one copy per table. the
+   * bits are kept in a map, only the ones that differ are set. a table
+   * handled with another range keeps it, saveSnapshot() starts a new
+   * snapshot then. a mapped table is shared with other processes, its
+   * mapping is newer than the snapshot and is left alone
+   */
+  void restoreSnapshot() {
+    SnapshotTable tables[StorageSnapshot::kTableCount];
+    snapshotTables(tables);
+    for (int i = 0; i < StorageSnapshot::kTableCount; i++) {
+      const StorageKind kind = static_cast<StorageKind>(i);
+      const SnapshotTable &table = snapshot_.table(kind);
+      if (table.quantity == 0) {
+        continue;
+      }
+      if (table != tables[i]) {
+        log(log_prefix_, LogLevel::kWarning,
+            "snapshot {}: table {} was [{}, {}), handled as [{}, {}) now, "
+            "not restored",
+            snapshotFile_->fileName().toStdString(), i, table.startAddress,
+            table.startAddress + table.quantity, tables[i].startAddress,
+            tables[i].startAddress + tables[i].quantity);
+        continue;
+      }
+      const uint8_t *data = snapshot_.data(kind);
+      SingleBitAccess *bits = nullptr;
+      if (kind == StorageKind::kCoils) {
+        bits = &coils_;
+      } else if (kind == StorageKind::kInputDiscrete) {
+        bits = &inputDiscrete_;
+      } else if (sharedRegisters(sixteenBitStorage(kind))) {
+        continue;
+      }
+
+      if (bits) {
+        for (uint32_t n = 0; n < table.quantity; n++) {
+          const Address address = table.startAddress + n;
+          const bool value = data[n / 8] & (1 << n % 8);
+          if (value != bits->value(address)) {
+            bits->setValue(address, value);
+          }
+        }
+        continue;
+      }
+      sixteenBitStorage(kind)->setValueArray(data);
+    }
+  }
+
+  /// a new snapshot with the current tables, all the values are written
+  bool rebuildSnapshot() {
+    SnapshotTable tables[StorageSnapshot::kTableCount];
+    snapshotTables(tables);
+
+    snapshot_.detach();
+    if (snapshotMemory_) {
+      snapshotFile_->unmap(snapshotMemory_);
+      snapshotMemory_ = nullptr;
+    }
+    const qint64 size = StorageSnapshot::requiredSize(tables);
+    if (snapshotFile_->resize(size)) {
+      snapshotMemory_ = snapshotFile_->map(0, size);
+    }
+    if (!snapshotMemory_ || !snapshot_.format(snapshotMemory_, size, tables)) {
+      log(log_prefix_, LogLevel::kError, "snapshot {}: create failed",
+          snapshotFile_->fileName().toStdString());
+      return false;
+    }
+    for (int i = 0; i < StorageSnapshot::kTableCount; i++) {
+      const StorageKind kind = static_cast<StorageKind>(i);
+      snapshotDirty_[i].clear();
+      snapshotSequences_[i].clear();
+      if (sharedRegisters(sixteenBitStorage(kind))) {
+        /// all its blocks, their sequence counters are kept
+        saveSharedBlocks(kind);
+      } else {
+        saveSnapshotRange(kind, 0, tables[i].quantity);
+      }
+    }
+    return true;
+  }
+
+  /// write the pages changed since the last save
+  void saveSnapshot() {
+    if (!snapshot_.isAttached()) {
+      return;
+    }
+    SnapshotTable tables[StorageSnapshot::kTableCount];
+    snapshotTables(tables);
+    for (int i = 0; i < StorageSnapshot::kTableCount; i++) {
+      if (tables[i] != snapshot_.table(static_cast<StorageKind>(i))) {
+        rebuildSnapshot();
+        return;
+      }
+    }
+
+    for (int i = 0; i < StorageSnapshot::kTableCount; i++) {
+      const StorageKind kind = static_cast<StorageKind>(i);
+      for (const auto &range : snapshotDirty_[i].take()) {
+        saveSnapshotRange(kind, range.start - tables[i].startAddress,
+                          range.quantity);
+      }
+      saveSharedBlocks(kind);
+    }
+  }
+
+  /**
+   * a mapped table is written by other processes too, without a dirty mark.
+   * the blocks whose sequence counters moved since the last save are saved
+   */
+  void saveSharedBlocks(StorageKind kind) {
+    auto &saved = snapshotSequences_[static_cast<int>(kind)];
+    const SharedRegisters *shared = sharedRegisters(sixteenBitStorage(kind));
+    if (!shared) {
+      saved.clear();
+      return;
+    }
+    /// all of them the first time
+    const bool all = saved.size() != shared->blockCount();
+    saved.resize(shared->blockCount());
+
+    const uint32_t perBlock = SharedRegisters::kBlockRegisters;
+    /// the run of blocks moved, saved at once
+    uint32_t first = 0;
+    uint32_t count = 0;
+    for (uint32_t block = 0; block < saved.size(); block++) {
+      const uint32_t sequence = shared->blockSequence(block);
+      if (!all && sequence == saved[block]) {
+        continue;
+      }
+      saved[block] = sequence;
+      if (count > 0 && first + count == block) {
+        count++;
+        continue;
+      }
+      if (count > 0) {
+        saveSnapshotRange(kind, first * perBlock, count * perBlock);
+      }
+      first = block;
+      count = 1;
+    }
+    if (count > 0) {
+      saveSnapshotRange(kind, first * perBlock, count * perBlock);
+    }
+  }
+
+  /**
+   * copy the pages holding the values [offset, offset + count) of the table
+   * into the snapshot
+   */
+  void saveSnapshotRange(StorageKind kind, uint32_t offset, uint32_t count) {
+    const SnapshotTable &table = snapshot_.table(kind);
+    const uint32_t perPage = StorageSnapshot::valuesPerPage(kind);
+    const uint32_t first = offset / perPage * perPage;
+    const uint32_t last = std::min<uint32_t>(
+        table.quantity, (offset + count + perPage - 1) / perPage * perPage);
+    if (first >= last) {
+      return;
+    }
+    uint8_t *data = snapshot_.data(kind);
+
+    if (kind == StorageKind::kCoils || kind == StorageKind::kInputDiscrete) {
+      const SingleBitAccess &bits =
+          kind == StorageKind::kCoils ? coils_ : inputDiscrete_;
+      for (uint32_t n = first; n < last; n += 8) {
+        uint8_t byte = 0;
+        for (uint32_t bit = 0; bit < 8 && n + bit < last; bit++) {
+          byte |= bits.value(table.startAddress + n + bit) << bit;
+        }
+        data[n / 8] = byte;
+      }
+      return;
+    }
+
+    const SixteenBitAccess *set = sixteenBitStorage(kind);
+    if (auto *shared = sharedRegisters(set)) {
+      shared->read(table.startAddress + first, last - first,
+                   data + first * 2);
+      return;
+    }
+    std::memcpy(data + first * 2, set->valueArray().data() + first * 2,
+                (last - first) * 2);
+  }
+
+  void closeSnapshot() {
+    snapshotTimer_.stop();
+    saveSnapshot();
+    snapshot_.detach();
+    if (snapshotMemory_) {
+      snapshotFile_->unmap(snapshotMemory_);
+      snapshotMemory_ = nullptr;
+    }
+    snapshotFile_.reset();
+    for (auto &dirty : snapshotDirty_) {
+      dirty.clear();
+    }
+    for (auto &sequences : snapshotSequences_) {
+      sequences.clear();
+    }
+  }
+
+  /**
+   * encode a read response of the registers from the table or its mapping.
+   * kSlaveDeviceBusy if the mapping stays locked by another process
+   */
+  Error marshalRegistersResponse(const SixteenBitAccess &my, Address address,
+                                 Quantity quantity, ByteArray *array) {
+    auto *shared = sharedRegisters(&my);
+    if (!shared) {
+      my.marshalMultipleReadResponse(address, quantity, array);
+      return Error::kNoError;
+    }
+    array->resize(1 + quantity * 2);
+    (*array)[0] = quantity * 2;
+    if (!shared->read(address, quantity, array->data() + 1)) {
+      log(log_prefix_, LogLevel::kError,
+          "read mapped registers [{}, {}): locked by another process",
+          address, address + quantity);
+      return Error::kSlaveDeviceBusy;
+    }
+    return Error::kNoError;
+  }
+
   bool coilsValue(const SingleBitAccess &access, Address address) {
     return access.value(address);
   }
@@ -263,6 +683,12 @@ public:
     case kWriteMultipleRegisters: {
       processWriteHoldingRegistersRequest(request, response);
     } break;
+    case kMaskWriteRegister: {
+      processMaskWriteRegisterRequest(request, response);
+    } break;
+    case kReadWriteMultipleRegisters: {
+      processReadWriteMultipleRegistersRequest(request, response);
+    } break;
     default:
       smart_assert(0 && "unsuported function")(request->functionCode());
       break;
@@ -271,6 +697,20 @@ public:
 
   void processBrocastRequest(const Adu *request) {}
 
+  void processRawRequest(const Adu *request, Adu *response) {
+    ByteArray data;
+    const Error error = rawRequestHandler_(
+        request->serverAddress(), request->functionCode(), request->data(),
+        &data);
+    if (error != Error::kNoError) {
+      createErrorReponse(request->functionCode(), error, response);
+      return;
+    }
+    response->setServerAddress(serverAddress_);
+    response->setFunctionCode(request->functionCode());
+    response->setData(data);
+  }
+
   void createErrorReponse(FunctionCode functionCode, Error errorCode,
                           Adu *response) {
     response->setServerAddress(serverAddress_);
@@ -300,32 +740,46 @@ public:
     response->setData(access.marshalAddressQuantity());
   }
 
+  /// one byte(0 or 1) per bit, the form passed to canWriteSingleBitRangeFunc
+  static ByteArray singleBitValues(const SingleBitAccess &access) {
+    ByteArray values(access.quantity());
+    for (size_t i = 0; i < values.size(); i++) {
+      values[i] = access.value(access.startAddress() + i);
+    }
+    return values;
+  }
+
   Error writeCoilsInternal(StorageKind kind, SingleBitAccess *my,
                            const SingleBitAccess *you) {
     Q_Q(QModbusServer);
     Address reqStartAddress = you->startAddress();
-    for (size_t i = 0; i < you->quantity(); i++) {
-      Address address = reqStartAddress + i;
-      auto value = you->value(address);
-      auto error = canWriteSingleBitValue(address, value);
+    const ByteArray values = singleBitValues(*you);
+    if (!isRequestedWrite(kind, reqStartAddress, values, 1)) {
+      auto error = canWriteSingleBits(kind, reqStartAddress, values);
       if (error != Error::kNoError) {
         return error;
       }
     }
 
-    for (size_t i = 0; i < you->quantity(); i++) {
+    for (size_t i = 0; i < values.size(); i++) {
       Address address = reqStartAddress + i;
-      auto value = you->value(address);
+      bool value = values[i];
       auto oldValue = my->value(address);
-      if (value != oldValue) {
-        my->setValue(address, value);
-        if (kind == StorageKind::kCoils) {
-          emit q->coilsValueChanged(address, value);
-        } else if (kind == StorageKind::kInputDiscrete) {
-          emit q->inputDiscreteValueChanged(address, value);
-        }
+      if (value == oldValue) {
+        continue;
+      }
+      my->setValue(address, value);
+      markChanged(kind, address, 1);
+      if (!perAddressSignals_) {
+        continue;
+      }
+      if (kind == StorageKind::kCoils) {
+        emit q->coilsValueChanged(address, value);
+      } else if (kind == StorageKind::kInputDiscrete) {
+        emit q->inputDiscreteValueChanged(address, value);
       }
     }
+    notifyChanges();
     return Error::kNoError;
   }
 
@@ -343,19 +797,23 @@ public:
     }
 
     Address reqStartAddress = you.startAddress();
-    for (size_t i = 0; i < you.quantity(); i++) {
-      Address address = reqStartAddress + i;
-      auto value = you.value(address);
-      auto error = canWriteSingleBitValue(address, value);
-      if (error != Error::kNoError) {
-        return error;
-      }
+    const ByteArray values = singleBitValues(you);
+    error = canWriteSingleBits(StorageKind::kCoils, reqStartAddress, values);
+    if (error != Error::kNoError) {
+      return error;
     }
-    for (size_t i = 0; i < you.quantity(); i++) {
-      Address address = reqStartAddress + i;
-      auto value = you.value(address);
-      emit q->writeCoilsRequested(address, value);
+    requestedWrite_ = {StorageKind::kCoils, reqStartAddress, &values};
+    DeferRun([this]() { requestedWrite_.values = nullptr; });
+    /// a signal per coil is a lot for a 0x0f of 1968 coils, skip it if no
+    /// application listens
+    static const QMetaMethod writeCoilsRequested =
+        QMetaMethod::fromSignal(&QModbusServer::writeCoilsRequested);
+    if (q->isSignalConnected(writeCoilsRequested)) {
+      for (size_t i = 0; i < values.size(); i++) {
+        emit q->writeCoilsRequested(reqStartAddress + i, values[i]);
+      }
     }
+    emit q->writeMultipleCoilsRequested(reqStartAddress, values);
 
     return Error::kNoError;
   }
@@ -402,26 +860,85 @@ public:
     response->setData(access.marshalSingleWriteRequest());
   }
 
+  void setCanWriteSingleBitRangeFunc(const canWriteSingleBitRangeFunc &func) {
+    canWriteSingleBitRange_ = func;
+  }
+
+  void
+  setCanWriteSixteenBitRangeFunc(const canWriteSixteenBitRangeFunc &func) {
+    canWriteSixteenBitRange_ = func;
+  }
+
+  /// the per-value form is adapted to a range function
   void setCanWriteSingleBitValueFunc(const canWriteSingleBitValueFunc &func) {
-    canWriteSingleBitValue_ = func;
+    if (!func) {
+      canWriteSingleBitRange_ = nullptr;
+      return;
+    }
+    canWriteSingleBitRange_ = [func](StorageKind, Address startAddress,
+                                     const ByteArray &values) -> Error {
+      for (size_t i = 0; i < values.size(); i++) {
+        auto error = func(startAddress + i, values[i] != 0);
+        if (error != Error::kNoError) {
+          return error;
+        }
+      }
+      return Error::kNoError;
+    };
   }
 
   void setCanWriteSixteenBitValueFunc(const canWriteSixteenBitValueFunc &func) {
-    canWriteSixteenBitValue_ = func;
+    if (!func) {
+      canWriteSixteenBitRange_ = nullptr;
+      return;
+    }
+    canWriteSixteenBitRange_ = [func](StorageKind, Address startAddress,
+                                      const ByteArray &values) -> Error {
+      for (size_t i = 0; i + 1 < values.size(); i += 2) {
+        SixteenBitValue value(values[i], values[i + 1]);
+        auto error = func(startAddress + i / 2, value);
+        if (error != Error::kNoError) {
+          return error;
+        }
+      }
+      return Error::kNoError;
+    };
+  }
+
+  /**
+   * true if the values are part of the master write being requested, the
+   * application writes it back while the request signals are emitted. it
+   * was validated when it was requested, it is not validated again. width
+   * is the bytes per value, 1 for single bit tables, 2 for registers
+   */
+  bool isRequestedWrite(StorageKind kind, Address startAddress,
+                        const ByteArray &values, size_t width) const {
+    const ByteArray *requested = requestedWrite_.values;
+    if (!requested || requestedWrite_.kind != kind ||
+        startAddress < requestedWrite_.startAddress) {
+      return false;
+    }
+    const size_t offset = (startAddress - requestedWrite_.startAddress) * width;
+    return offset + values.size() <= requested->size() &&
+           std::equal(values.begin(), values.end(),
+                      requested->begin() + offset);
   }
 
-  Error canWriteSingleBitValue(Address startAddress, bool value) {
-    if (canWriteSingleBitValue_) {
-      return canWriteSingleBitValue_(startAddress, value);
+  Error canWriteSingleBits(StorageKind kind, Address startAddress,
+                           const ByteArray &values) {
+    if (canWriteSingleBitRange_) {
+      return canWriteSingleBitRange_(kind, startAddress, values);
     }
     return Error::kNoError;
   }
 
-  // TODO(jinzhao):how to use it?it's useable?
-  Error canWriteSixteenBitValue(Address startAddress,
-                                const SixteenBitValue &value) {
-    if (canWriteSixteenBitValue_) {
-      return canWriteSixteenBitValue_(startAddress, value);
+  Error canWriteSixteenBits(StorageKind kind, const SixteenBitAccess &access) {
+    if (isRequestedWrite(kind, access.startAddress(), access.valueArray(), 2)) {
+      return Error::kNoError;
+    }
+    if (canWriteSixteenBitRange_) {
+      return canWriteSixteenBitRange_(kind, access.startAddress(),
+                                      access.valueArray());
     }
     return Error::kNoError;
   }
@@ -488,19 +1005,15 @@ public:
       return;
     }
 
-    Address reqStartAddress = access.startAddress();
-    Quantity reqQuantity = access.quantity();
-    SixteenBitAccess responseAccess;
-    responseAccess.setStartAddress(reqStartAddress);
-    responseAccess.setQuantity(reqQuantity);
-    for (size_t i = 0; i < reqQuantity; i++) {
-      Address address = reqStartAddress + i;
-      auto value = entry.sixteenBitAccess->value(address);
-      responseAccess.setValue(address, value.toUint16());
+    error = marshalRegistersResponse(my, access.startAddress(),
+                                     access.quantity(),
+                                     response->mutableData());
+    if (error != Error::kNoError) {
+      createErrorReponse(request->functionCode(), error, response);
+      return;
     }
     response->setFunctionCode(request->functionCode());
     response->setServerAddress(serverAddress_);
-    response->setData(responseAccess.marshalMultipleReadResponse());
   }
 
   Error writeRegisterValuesInternal(StorageKind kind, SixteenBitAccess *set,
@@ -512,35 +1025,57 @@ public:
       return error;
     }
 
+    error = canWriteSixteenBits(kind, access);
+    if (error != Error::kNoError) {
+      return error;
+    }
+
     Quantity quantity = access.quantity();
 
-    for (size_t i = 0; i < quantity; i++) {
-      Address reqStartAddress = access.startAddress() + i;
-      auto value = access.value(reqStartAddress);
-      error = canWriteSixteenBitValue(reqStartAddress, value);
-      if (error != Error::kNoError) {
-        return error;
+    bool changed = false;
+    if (auto *shared = sharedRegisters(set)) {
+      /// the mapping is the storage, other processes may write it too. the
+      /// old values are taken by the locked write, not read before it
+      const ByteArray &values = access.valueArray();
+      ByteArray old(values.size());
+      if (!shared->write(access.startAddress(), values.data(), quantity,
+                         old.data())) {
+        return Error::kSlaveDeviceBusy;
       }
+      for (size_t i = 0; i < quantity; i++) {
+        if (old[i * 2] != values[i * 2] ||
+            old[i * 2 + 1] != values[i * 2 + 1]) {
+          markChanged(kind, access.startAddress() + i, 1);
+          changed = true;
+        }
+      }
+    } else {
+      for (size_t i = 0; i < quantity; i++) {
+        Address address = access.startAddress() + i;
+        auto value = access.value(address);
+        if (set->value(address) == value) {
+          continue;
+        }
+        set->setValue(address, value.toUint16());
+        markChanged(kind, address, 1);
+        changed = true;
+      }
+    }
+    if (!changed) {
+      return Error::kNoError;
     }
 
     QVector<SixteenBitValue> new_values;
-    QVector<SixteenBitValue> old_values;
+    new_values.reserve(quantity);
     for (size_t i = 0; i < quantity; i++) {
-      Address reqStartAddress = access.startAddress() + i;
-      auto value = access.value(reqStartAddress);
-      auto oldValue = set->value(reqStartAddress);
-      new_values.push_back(value);
-      old_values.push_back(oldValue);
-      set->setValue(reqStartAddress, value.toUint16());
-    }
-
-    if (new_values != old_values) {
-      if (kind == StorageKind::kHoldingRegisters) {
-        emit q->holdingRegisterValueChanged(access.startAddress(), new_values);
-      } else if (kind == StorageKind::kInputRegisters) {
-        emit q->inputRegisterValueChanged(access.startAddress(), new_values);
-      }
+      new_values.push_back(access.value(access.startAddress() + i));
+    }
+    if (kind == StorageKind::kHoldingRegisters) {
+      emit q->holdingRegisterValueChanged(access.startAddress(), new_values);
+    } else if (kind == StorageKind::kInputRegisters) {
+      emit q->inputRegisterValueChanged(access.startAddress(), new_values);
     }
+    notifyChanges();
     return Error::kNoError;
   }
 
@@ -550,16 +1085,14 @@ public:
     if (error != Error::kNoError) {
       return error;
     }
-    Quantity quantity = access.quantity();
-    for (size_t i = 0; i < quantity; i++) {
-      Address reqStartAddress = access.startAddress() + i;
-      auto value = access.value(reqStartAddress);
-      auto error = canWriteSixteenBitValue(reqStartAddress, value);
-      if (error != Error::kNoError) {
-        return error;
-      }
+    error = canWriteSixteenBits(StorageKind::kHoldingRegisters, access);
+    if (error != Error::kNoError) {
+      return error;
     }
     Q_Q(QModbusServer);
+    requestedWrite_ = {StorageKind::kHoldingRegisters, access.startAddress(),
+                       &access.valueArray()};
+    DeferRun([this]() { requestedWrite_.values = nullptr; });
     emit q->writeHodingRegistersRequested(access.startAddress(),
                                           access.value());
     return Error::kNoError;
@@ -676,6 +1209,126 @@ public:
     response->setData(access.marshalMultipleReadRequest());
   }
 
+  /**
+   * the masks are applied to the mapping in one locked write, a value
+   * another process wrote after access was computed is kept. the validator
+   * sees the value as computed from the register when it was read
+   */
+  Error maskWriteSharedRegister(SharedRegisters *shared,
+                                const SixteenBitAccess &access,
+                                uint16_t andMask, uint16_t orMask) {
+    Q_Q(QModbusServer);
+    auto error = canWriteSixteenBits(StorageKind::kHoldingRegisters, access);
+    if (error != Error::kNoError) {
+      return error;
+    }
+    const Address address = access.startAddress();
+    uint16_t previous = 0;
+    if (!shared->maskWrite(address, andMask, orMask, &previous)) {
+      return Error::kSlaveDeviceBusy;
+    }
+    const uint16_t value =
+        SixteenBitAccess::maskWrite(previous, andMask, orMask);
+    if (value == previous) {
+      return Error::kNoError;
+    }
+    markChanged(StorageKind::kHoldingRegisters, address, 1);
+    emit q->holdingRegisterValueChanged(address, {SixteenBitValue(value)});
+    notifyChanges();
+    return Error::kNoError;
+  }
+
+  /**
+   * unlike 0x06/0x10, the masks are applied to the storage right away, the
+   * result depends on the current value, so it can't wait for the
+   * application to write it back. the new value goes through
+   * canWriteSixteenBitRange, holdingRegisterValueChanged is emitted if it
+   * changed
+   */
+  void processMaskWriteRegisterRequest(const Adu *request, Adu *response) {
+    SixteenBitAccess access;
+    uint16_t andMask = 0;
+    uint16_t orMask = 0;
+
+    bool ok = access.unmarshalMaskWriteRequest(request->data(), &andMask,
+                                               &orMask);
+    if (ok == false) {
+      log(log_prefix_, LogLevel::kError, "invalid request");
+      createErrorReponse(request->functionCode(), Error::kStorageParityError,
+                         response);
+      return;
+    }
+
+    const Address address = access.startAddress();
+    auto error = validateSixteenAccess(access, holdingRegister_);
+    if (error != Error::kNoError) {
+      createErrorReponse(request->functionCode(), error, response);
+      return;
+    }
+
+    SixteenBitValue current;
+    registerValue(holdingRegister_, address, &current);
+    access.setValue(address, SixteenBitAccess::maskWrite(current.toUint16(),
+                                                         andMask, orMask));
+    if (auto *shared = sharedRegisters(&holdingRegister_)) {
+      error = maskWriteSharedRegister(shared, access, andMask, orMask);
+    } else {
+      error = writeRegisterValuesInternal(StorageKind::kHoldingRegisters,
+                                          &holdingRegister_, access);
+    }
+    if (error != Error::kNoError) {
+      createErrorReponse(request->functionCode(), error, response);
+      return;
+    }
+
+    response->setFunctionCode(request->functionCode());
+    response->setServerAddress(serverAddress_);
+    response->setData(request->data());
+  }
+
+  /**
+   * function code 0x17, the write part goes the way of 0x10, it is requested
+   * through writeHodingRegistersRequested before the read. an application
+   * that writes the values back in a direct connection has them in the
+   * response when the ranges overlap. both ranges are validated before the
+   * write is requested. requests are processed one by one in the event loop,
+   * no other session can see the registers between the write and the read
+   */
+  void processReadWriteMultipleRegistersRequest(const Adu *request,
+                                                Adu *response) {
+    SixteenBitAccess readAccess;
+    SixteenBitAccess writeAccess;
+
+    bool ok = readAccess.unmarshalReadWriteRequest(request->data(),
+                                                   &writeAccess);
+    if (ok == false) {
+      log(log_prefix_, LogLevel::kError, "invalid request");
+      createErrorReponse(request->functionCode(), Error::kStorageParityError,
+                         response);
+      return;
+    }
+
+    auto error = validateSixteenAccess(readAccess, holdingRegister_);
+    if (error == Error::kNoError) {
+      error = handleClientWriteHodingRegisters(writeAccess, holdingRegister_);
+    }
+    if (error != Error::kNoError) {
+      createErrorReponse(request->functionCode(), error, response);
+      return;
+    }
+
+    error = marshalRegistersResponse(holdingRegister_,
+                                     readAccess.startAddress(),
+                                     readAccess.quantity(),
+                                     response->mutableData());
+    if (error != Error::kNoError) {
+      createErrorReponse(request->functionCode(), error, response);
+      return;
+    }
+    response->setFunctionCode(request->functionCode());
+    response->setServerAddress(serverAddress_);
+  }
+
   Error validateSixteenAccess(const SixteenBitAccess &access,
                               const SixteenBitAccess &myAccess) {
     Address myStartAddress = myAccess.startAddress();
@@ -715,8 +1368,29 @@ public:
   QMap<qintptr, ClientSessionPtr> sessionList_;
   AbstractServer *server_ = nullptr;
   ServerAddress serverAddress_ = 1;
-  canWriteSingleBitValueFunc canWriteSingleBitValue_;
-  canWriteSixteenBitValueFunc canWriteSixteenBitValue_;
+  canWriteSingleBitRangeFunc canWriteSingleBitRange_;
+  canWriteSixteenBitRangeFunc canWriteSixteenBitRange_;
+  /// the master write validated and being requested, values is null if none
+  struct {
+    StorageKind kind;
+    Address startAddress;
+    const ByteArray *values;
+  } requestedWrite_ = {StorageKind::kCoils, 0, nullptr};
+  rawRequestHandlerFunc rawRequestHandler_;
+  bool perAddressSignals_ = false;
+  int changeNotifyInterval_ = 0;
+  QTimer changeNotifyTimer_;
+  /// indexed by StorageKind
+  DirtyRanges dirtyRanges_[4];
+  std::unique_ptr<SharedRegisterFile> sharedRegisterFiles_[4];
+  std::unique_ptr<QFile> snapshotFile_;
+  uchar *snapshotMemory_ = nullptr;
+  StorageSnapshot snapshot_;
+  QTimer snapshotTimer_;
+  /// the changes not in the snapshot yet, indexed by StorageKind
+  DirtyRanges snapshotDirty_[4];
+  /// the sequence counters of the blocks of the mapped tables last saved
+  std::vector<uint32_t> snapshotSequences_[4];
   QModbusServer *q_ptr;
 
   SingleBitAccess inputDiscrete_;
@@ -724,6 +1398,7 @@ public:
   SixteenBitAccess inputRegister_;
   SixteenBitAccess holdingRegister_;
   bool enableDump_ = true;
+  bool enableRtuSilenceDetection_ = false;
 
   std::string log_prefix_;
 };
@@ -0,0 +1,564 @@
+#include <modbus/tools/modbus_tcp_device_manager.h>
+
+#if defined(__linux__)
+
+#include "modbus_epoll_thread.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <base/modbus_logger.h>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <modbus_frame.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace modbus {
+
+namespace {
+const size_t kReadSize = 4096;
+/// the tick of the timers of the devices, microseconds
+const int64_t kTimerTick = 1000;
+/// the mbap header, the length counts the bytes after it
+const size_t kMbapHeaderSize = 6;
+/// the largest length of a modbus tcp adu, the unit id and the pdu
+const size_t kMaxMbapLength = 254;
+} // namespace
+
+struct TcpSession;
+
+/// a request from sendRequest() to requestFinished()
+struct TcpJob : public RequestJob {
+  TcpSession *session = nullptr;
+  /// the next request of the session, once it is taken by the thread
+  TcpJob *sessionNext = nullptr;
+};
+
+enum class TcpSessionState {
+  /// failed, waiting reconnectDelay
+  kClosed,
+  kConnecting,
+  kIdle,
+  kSendingRequest,
+  kWaitingResponse
+};
+
+class ManagerThread;
+/**
+ * a device, only touched by its thread once it is attached. it is kept
+ * small, there are thousands of them
+ */
+struct TcpSession : public MpscNode {
+  TcpSession(TcpDeviceManager::DeviceId id, const TcpDevice &device)
+      : id(id), connectTimeout(device.connectTimeout),
+        waitResponseTimeout(device.waitResponseTimeout),
+        retryTimes(device.retryTimes), reconnectDelay(device.reconnectDelay) {}
+
+  const TcpDeviceManager::DeviceId id;
+  ManagerThread *thread = nullptr;
+  int fd = -1;
+  TcpSessionState state = TcpSessionState::kClosed;
+  /// set by its thread once it polls it
+  bool attached = false;
+  bool watchingWritable = false;
+  uint16_t transactionId = 0;
+  const int connectTimeout;
+  const int waitResponseTimeout;
+  const int retryTimes;
+  const int reconnectDelay;
+  union {
+    struct sockaddr sa;
+    struct sockaddr_in in4;
+    struct sockaddr_in6 in6;
+  } address;
+  socklen_t addressLength = 0;
+  /// the timer of the state
+  TimerWheel::Timer timer;
+  /// the requests, the first one is on the wire
+  TcpJob *front = nullptr;
+  TcpJob *back = nullptr;
+  /// the bytes of a frame not complete yet
+  std::vector<uint8_t> readPending;
+  /// the bytes of the request the socket did not take yet
+  std::vector<uint8_t> writePending;
+};
+
+static std::string addressString(const TcpSession *session) {
+  char host[INET6_ADDRSTRLEN] = {0};
+  uint16_t port = 0;
+  if (session->address.sa.sa_family == AF_INET6) {
+    inet_ntop(AF_INET6, &session->address.in6.sin6_addr, host, sizeof(host));
+    port = ntohs(session->address.in6.sin6_port);
+  } else {
+    inet_ntop(AF_INET, &session->address.in4.sin_addr, host, sizeof(host));
+    port = ntohs(session->address.in4.sin_port);
+  }
+  return std::string(host) + ":" + std::to_string(port);
+}
+
+/**
+ * a thread polling its devices. the buffers and the codec are shared by the
+ * devices, the timer of each device is on the wheel of the thread
+ */
+class ManagerThread : public LineThread<TcpSession, TcpJob> {
+public:
+  ManagerThread(int index, FinishedJobs<TcpJob> *finished)
+      : LineThread(kTimerTick, index, finished),
+        decoder_(sharedCheckSizeFuncTableForClient(), true) {
+    start();
+  }
+
+  ~ManagerThread() override { stop(); }
+
+protected:
+  void onWakeUp() override {
+    attachSessions();
+    while (TcpJob *job = takeJob()) {
+      TcpSession *session = job->session;
+      if (!session->attached) {
+        /// attached before the job was posted, it shows up now
+        attachSessions();
+      }
+      if (session->state == TcpSessionState::kClosed) {
+        finish(job, Error::kTimeout);
+        continue;
+      }
+      job->retryTimes = session->retryTimes;
+      if (session->back != nullptr) {
+        session->back->sessionNext = job;
+      } else {
+        session->front = job;
+      }
+      session->back = job;
+      sendNext(session);
+    }
+  }
+
+  void onEvents(void *ptr, uint32_t events) override {
+    TcpSession *session = static_cast<TcpSession *>(ptr);
+    if (session->fd < 0) {
+      return;
+    }
+    if (session->state == TcpSessionState::kConnecting) {
+      onConnect(session);
+      return;
+    }
+    if (events & EPOLLOUT) {
+      onWritable(session);
+    }
+    if (session->fd >= 0 && (events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+      onReadable(session);
+    }
+  }
+
+private:
+  void attachSessions() {
+    while (TcpSession *session = takeLine()) {
+      session->attached = true;
+      session->timer.setCallback([this, session]() { onTimer(session); });
+      connect(session);
+    }
+  }
+
+  void startTimer(TcpSession *session, int delay) {
+    wheel().schedule(&session->timer, int64_t(delay) * 1000);
+  }
+
+  void watchWritable(TcpSession *session, bool enable) {
+    if (session->watchingWritable == enable) {
+      return;
+    }
+    modify(session->fd, session, enable ? EPOLLIN | EPOLLOUT : EPOLLIN);
+    session->watchingWritable = enable;
+  }
+
+  void connect(TcpSession *session) {
+    session->fd = ::socket(session->address.sa.sa_family,
+                           SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (session->fd < 0) {
+      fail(session, std::string("socket ") + std::strerror(errno));
+      return;
+    }
+    const int one = 1;
+    setsockopt(session->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (::connect(session->fd, &session->address.sa,
+                  session->addressLength) == 0) {
+      watch(session->fd, session, EPOLLIN);
+      connected(session);
+      return;
+    }
+    if (errno != EINPROGRESS) {
+      fail(session, std::string("connect ") + std::strerror(errno));
+      return;
+    }
+    /// writable once connected, or failed
+    watch(session->fd, session, EPOLLIN | EPOLLOUT);
+    session->watchingWritable = true;
+    session->state = TcpSessionState::kConnecting;
+    startTimer(session, session->connectTimeout);
+  }
+
+  void onConnect(TcpSession *session) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(session->fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0) {
+      error = errno;
+    }
+    if (error == EINPROGRESS) {
+      return;
+    }
+    if (error != 0) {
+      fail(session, std::string("connect ") + std::strerror(error));
+      return;
+    }
+    watchWritable(session, false);
+    connected(session);
+  }
+
+  void connected(TcpSession *session) {
+    session->timer.cancel();
+    session->state = TcpSessionState::kIdle;
+    sendNext(session);
+  }
+
+  /// send the requests until one waits for its response
+  void sendNext(TcpSession *session) {
+    while (session->state == TcpSessionState::kIdle &&
+           session->front != nullptr) {
+      Request &request = session->front->request;
+      request.setTransactionId(++session->transactionId);
+      writeBuffer_.Reset();
+      encoder_.Encode(&request, writeBuffer_);
+
+      uint8_t *p = nullptr;
+      const size_t len = writeBuffer_.Len();
+      writeBuffer_.ZeroCopyPeekAt(&p, 0, len);
+      ssize_t n = ::send(session->fd, p, len, MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+          fail(session, std::string("send ") + std::strerror(errno));
+          return;
+        }
+        n = 0;
+      }
+      if (static_cast<size_t>(n) < len) {
+        session->writePending.assign(p + n, p + len);
+        session->state = TcpSessionState::kSendingRequest;
+        watchWritable(session, true);
+        return;
+      }
+      sent(session);
+    }
+  }
+
+  void onWritable(TcpSession *session) {
+    if (session->state != TcpSessionState::kSendingRequest) {
+      return;
+    }
+    std::vector<uint8_t> &pending = session->writePending;
+    const ssize_t n =
+        ::send(session->fd, pending.data(), pending.size(), MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        fail(session, std::string("send ") + std::strerror(errno));
+      }
+      return;
+    }
+    pending.erase(pending.begin(), pending.begin() + n);
+    if (!pending.empty()) {
+      return;
+    }
+    std::vector<uint8_t>().swap(pending);
+    watchWritable(session, false);
+    sent(session);
+    sendNext(session);
+  }
+
+  /// the request is on the wire
+  void sent(TcpSession *session) {
+    TcpJob *job = session->front;
+    if (job->request.isBrocast()) {
+      popFront(session);
+      finish(job, Error::kNoError);
+      session->state = TcpSessionState::kIdle;
+      return;
+    }
+    session->state = TcpSessionState::kWaitingResponse;
+    startTimer(session, session->waitResponseTimeout);
+  }
+
+  void onReadable(TcpSession *session) {
+    readBuffer_.Reset();
+    if (!session->readPending.empty()) {
+      readBuffer_.Write(session->readPending);
+      session->readPending.clear();
+    }
+    for (;;) {
+      uint8_t *p = readBuffer_.BeginWrite(kReadSize);
+      const ssize_t n = ::recv(session->fd, p, kReadSize, 0);
+      if (n > 0) {
+        readBuffer_.CommitWrite(static_cast<size_t>(n));
+        if (static_cast<size_t>(n) < kReadSize) {
+          break;
+        }
+      } else if (n == 0) {
+        fail(session, "closed by the device");
+        return;
+      } else if (errno != EINTR) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          fail(session, std::string("recv ") + std::strerror(errno));
+          return;
+        }
+        break;
+      }
+    }
+
+    /// the frames are cut by the mbap header, the decoder sees whole ones
+    while (readBuffer_.Len() >= kMbapHeaderSize) {
+      uint8_t *p = nullptr;
+      readBuffer_.ZeroCopyPeekAt(&p, 0, kMbapHeaderSize);
+      const size_t length = p[4] * 256 + p[5];
+      if (p[2] != 0 || p[3] != 0 || length > kMaxMbapLength) {
+        fail(session, "got a bad mbap header");
+        return;
+      }
+      if (readBuffer_.Len() < kMbapHeaderSize + length) {
+        break;
+      }
+      Response response;
+      decoder_.Clear();
+      decoder_.Decode(readBuffer_, &response);
+      onFrame(session, response, decoder_.LasError());
+      if (session->fd < 0) {
+        return;
+      }
+    }
+    const size_t left = readBuffer_.Len();
+    if (left > 0) {
+      uint8_t *p = nullptr;
+      readBuffer_.ZeroCopyPeekAt(&p, 0, left);
+      session->readPending.assign(p, p + left);
+    }
+  }
+
+  void onFrame(TcpSession *session, Response &response, Error error) {
+    if (session->state != TcpSessionState::kWaitingResponse) {
+      log("", LogLevel::kWarning, "{}: got unexpected data, discard it",
+          addressString(session));
+      return;
+    }
+    TcpJob *job = session->front;
+    const Request &request = job->request;
+    if (response.transactionId() != request.transactionId()) {
+      log("", LogLevel::kWarning,
+          "{}: got response, unexpected transaction Id, discard it",
+          addressString(session));
+      return;
+    }
+    if (response.serverAddress() != request.serverAddress() ||
+        response.functionCode() != request.functionCode()) {
+      log("", LogLevel::kWarning, "{}: got unexpected response, discard it",
+          addressString(session));
+      return;
+    }
+    if (error != Error::kNoError) {
+      response.setError(error);
+    }
+    session->timer.cancel();
+    session->state = TcpSessionState::kIdle;
+    popFront(session);
+    job->response = response;
+    finish(job, response.error());
+    sendNext(session);
+  }
+
+  void onTimer(TcpSession *session) {
+    switch (session->state) {
+    case TcpSessionState::kConnecting:
+      fail(session, "connect timeout");
+      break;
+    case TcpSessionState::kWaitingResponse: {
+      session->state = TcpSessionState::kIdle;
+      TcpJob *job = session->front;
+      if (job->retryTimes-- > 0) {
+        log("", LogLevel::kWarning,
+            "{}: waiting response timeout, retry it, retrytimes {}",
+            addressString(session), job->retryTimes);
+      } else {
+        log("", LogLevel::kWarning, "{}: waiting response timeout",
+            addressString(session));
+        popFront(session);
+        finish(job, Error::kTimeout);
+      }
+      sendNext(session);
+      break;
+    }
+    case TcpSessionState::kClosed:
+      connect(session);
+      break;
+    default:
+      break;
+    }
+  }
+
+  /// close the device, its requests finish with kTimeout
+  void fail(TcpSession *session, const std::string &why) {
+    log("", LogLevel::kError, "{}: {}, close it", addressString(session),
+        why);
+    if (session->fd >= 0) {
+      unwatch(session->fd);
+      ::close(session->fd);
+      session->fd = -1;
+    }
+    session->watchingWritable = false;
+    std::vector<uint8_t>().swap(session->readPending);
+    std::vector<uint8_t>().swap(session->writePending);
+    while (TcpJob *job = session->front) {
+      popFront(session);
+      finish(job, Error::kTimeout);
+    }
+    session->state = TcpSessionState::kClosed;
+    startTimer(session, session->reconnectDelay);
+  }
+
+  void popFront(TcpSession *session) {
+    TcpJob *job = session->front;
+    session->front = job->sessionNext;
+    if (session->front == nullptr) {
+      session->back = nullptr;
+    }
+    job->sessionNext = nullptr;
+  }
+
+  pp::bytes::Buffer readBuffer_;
+  pp::bytes::Buffer writeBuffer_;
+  ModbusMbapFrameDecoder decoder_;
+  ModbusMbapFrameEncoder encoder_;
+};
+
+class TcpDeviceManagerPrivate {
+public:
+  explicit TcpDeviceManagerPrivate(TcpDeviceManager *q)
+      : finished_(q), q_ptr(q) {}
+
+  /// requestFinished is emitted on the thread of the manager
+  FinishedJobs<TcpJob> finished_;
+  std::vector<std::unique_ptr<ManagerThread>> threads_;
+  std::vector<std::unique_ptr<TcpSession>> sessions_;
+  QString errorString_;
+  TcpDeviceManager *q_ptr;
+};
+
+TcpDeviceManager::TcpDeviceManager(int threadCount, QObject *parent)
+    : QObject(parent), d_ptr(new TcpDeviceManagerPrivate(this)) {
+  Q_D(TcpDeviceManager);
+  threadCount = std::max(threadCount, 1);
+  for (int i = 0; i < threadCount; i++) {
+    d->threads_.emplace_back(new ManagerThread(i, &d->finished_));
+  }
+}
+
+TcpDeviceManager::~TcpDeviceManager() {
+  Q_D(TcpDeviceManager);
+  for (auto &thread : d->threads_) {
+    thread->stop();
+    thread->dropJobs();
+  }
+  d->threads_.clear();
+  for (auto &session : d->sessions_) {
+    while (TcpJob *job = session->front) {
+      session->front = job->sessionNext;
+      delete job;
+    }
+    if (session->fd >= 0) {
+      ::close(session->fd);
+    }
+  }
+}
+
+TcpDeviceManager::DeviceId
+TcpDeviceManager::addDevice(const TcpDevice &device) {
+  Q_D(TcpDeviceManager);
+  if (device.host.empty()) {
+    d->errorString_ = "the host is empty";
+    return -1;
+  }
+  struct addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *result = nullptr;
+  const int error = getaddrinfo(device.host.c_str(),
+                                std::to_string(device.port).c_str(), &hints,
+                                &result);
+  if (error != 0 || result == nullptr) {
+    d->errorString_ =
+        QString::fromStdString(device.host + ": " + gai_strerror(error));
+    return -1;
+  }
+
+  const DeviceId id = static_cast<DeviceId>(d->sessions_.size());
+  TcpSession *session = new TcpSession(id, device);
+  std::memcpy(&session->address, result->ai_addr, result->ai_addrlen);
+  session->addressLength = result->ai_addrlen;
+  freeaddrinfo(result);
+
+  ManagerThread *thread = leastLoaded(d->threads_);
+  session->thread = thread;
+  d->sessions_.emplace_back(session);
+  thread->lineCount++;
+  thread->attach(session);
+  return id;
+}
+
+bool TcpDeviceManager::sendRequest(DeviceId device, const Request &request) {
+  Q_D(TcpDeviceManager);
+  if (device < 0 || device >= static_cast<DeviceId>(d->sessions_.size())) {
+    return false;
+  }
+  TcpJob *job = new TcpJob();
+  job->session = d->sessions_[device].get();
+  job->request = request;
+  job->session->thread->post(job);
+  return true;
+}
+
+int TcpDeviceManager::threadCount() const {
+  const Q_D(TcpDeviceManager);
+  return static_cast<int>(d->threads_.size());
+}
+
+int TcpDeviceManager::deviceCount() const {
+  const Q_D(TcpDeviceManager);
+  return static_cast<int>(d->sessions_.size());
+}
+
+int TcpDeviceManager::threadOf(DeviceId device) const {
+  const Q_D(TcpDeviceManager);
+  if (device < 0 || device >= static_cast<DeviceId>(d->sessions_.size())) {
+    return -1;
+  }
+  return d->sessions_[device]->thread->index();
+}
+
+QString TcpDeviceManager::errorString() const {
+  const Q_D(TcpDeviceManager);
+  return d->errorString_;
+}
+
+bool TcpDeviceManager::event(QEvent *e) {
+  Q_D(TcpDeviceManager);
+  const bool taken = d->finished_.take(e, [this](TcpJob *job) {
+    emit requestFinished(job->session->id, job->request, job->response);
+  });
+  return taken || QObject::event(e);
+}
+
+} // namespace modbus
+
+#endif // __linux__
@@ -1,3 +1,4 @@
+#include "modbus_qiodevice_reader.h"
 #include <QHostAddress>
 #include <QNetworkInterface>
 #include <QTcpServer>
@@ -5,6 +6,7 @@
 #include <base/modbus_frame.h>
 #include <base/modbus_logger.h>
 #include <bytes/buffer.h>
+#include <modbus/tools/modbus_gateway.h>
 #include <modbus/tools/modbus_server.h>
 
 namespace modbus {
@@ -45,14 +47,13 @@ public:
     }
     return QString("%1:%2").arg(address).arg(socket_.peerPort()).toStdString();
   }
+  size_t readInto(pp::bytes::Buffer &buffer) override {
+    return readAvailable(&socket_, buffer);
+  }
 
 private:
   void onClientReadyRead() {
-    while (socket_.bytesAvailable() > 0) {
-      char buf[1024] = {0};
-      int size = socket_.read(buf, sizeof(buf));
-      readBuffer_->Write(buf, size);
-    }
+    readInto(*readBuffer_);
     emit messageArrived(socket_.socketDescriptor(), readBuffer_);
   }
 
@@ -124,6 +125,12 @@ QModbusServer *createQModbusTcpServer(uint16_t port, QObject *parent) {
   return modbusServer;
 }
 
+QModbusGateway *createQModbusTcpGateway(uint16_t port, QObject *parent) {
+  auto tcpServer = new TcpServer(parent);
+  tcpServer->setListenPort(port);
+  return new QModbusGateway(tcpServer, parent);
+}
+
 static QList<QString> localIpList() {
   QList<QString> ipList;
   auto interfaceList = QNetworkInterface::allInterfaces();
@@ -0,0 +1,198 @@
+#include <modbus/tools/modbus_termios.h>
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <base/modbus_logger.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace modbus {
+
+namespace {
+speed_t toSpeed(int baudRate) {
+  switch (baudRate) {
+  case 1200:
+    return B1200;
+  case 2400:
+    return B2400;
+  case 4800:
+    return B4800;
+  case 9600:
+    return B9600;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  case 460800:
+    return B460800;
+  case 500000:
+    return B500000;
+  case 576000:
+    return B576000;
+  case 921600:
+    return B921600;
+  case 1000000:
+    return B1000000;
+  case 2000000:
+    return B2000000;
+  case 4000000:
+    return B4000000;
+  default:
+    return B0;
+  }
+}
+
+tcflag_t toCharacterSize(int dataBits) {
+  switch (dataBits) {
+  case 5:
+    return CS5;
+  case 6:
+    return CS6;
+  case 7:
+    return CS7;
+  default:
+    return CS8;
+  }
+}
+
+tcflag_t toParityFlags(char parity) {
+  switch (parity) {
+  case 'E':
+  case 'e':
+    return PARENB;
+  case 'O':
+  case 'o':
+    return PARENB | PARODD;
+  case 'S':
+  case 's':
+    return PARENB | CMSPAR;
+  case 'M':
+  case 'm':
+    return PARENB | CMSPAR | PARODD;
+  default:
+    return 0;
+  }
+}
+
+bool configure(int fd, const std::string &path, const TermiosConfig &config,
+               std::string *errorString) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0) {
+    *errorString = path + ": tcgetattr " + std::strerror(errno);
+    return false;
+  }
+  cfmakeraw(&tio);
+  const tcflag_t parity = toParityFlags(config.parity);
+  tio.c_cflag &= ~(CSIZE | PARENB | PARODD | CMSPAR | CSTOPB | CRTSCTS);
+  tio.c_cflag |= CLOCAL | CREAD | toCharacterSize(config.dataBits) | parity;
+  if (parity != 0) {
+    /// a byte with a parity error is read as 0, the crc fails then
+    tio.c_iflag |= INPCK;
+  }
+  if (config.stopBits == 2) {
+    tio.c_cflag |= CSTOPB;
+  }
+  tio.c_cc[VMIN] =
+      static_cast<cc_t>(std::min(std::max(config.readBatching, 1), 255));
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, toSpeed(config.baudRate));
+  cfsetospeed(&tio, toSpeed(config.baudRate));
+  if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+    *errorString = path + ": tcsetattr " + std::strerror(errno);
+    return false;
+  }
+  tcflush(fd, TCIOFLUSH);
+  return true;
+}
+
+bool enableLowLatency(int fd) {
+  struct serial_struct serial;
+  if (ioctl(fd, TIOCGSERIAL, &serial) != 0) {
+    return false;
+  }
+  serial.flags |= ASYNC_LOW_LATENCY;
+  return ioctl(fd, TIOCSSERIAL, &serial) == 0;
+}
+
+bool configureRs485(int fd, const std::string &path, const Rs485Config &config,
+                    std::string *errorString) {
+  struct serial_rs485 rs485;
+  std::memset(&rs485, 0, sizeof(rs485));
+  rs485.flags = SER_RS485_ENABLED;
+  if (config.rtsOnSend) {
+    rs485.flags |= SER_RS485_RTS_ON_SEND;
+  }
+  if (config.rtsAfterSend) {
+    rs485.flags |= SER_RS485_RTS_AFTER_SEND;
+  }
+  if (config.receiveDuringSend) {
+    rs485.flags |= SER_RS485_RX_DURING_TX;
+  }
+  rs485.delay_rts_before_send = config.delayRtsBeforeSend;
+  rs485.delay_rts_after_send = config.delayRtsAfterSend;
+  if (ioctl(fd, TIOCSRS485, &rs485) != 0) {
+    *errorString = path + ": rs-485 " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+} // namespace
+
+std::string termiosPortLocation(const std::string &name) {
+  std::string location = name;
+  while (location.size() > 1 && location.back() == '/') {
+    location.pop_back();
+  }
+  if (location.empty() || location[0] == '/' || location[0] == '.') {
+    return location;
+  }
+  if (location.compare(0, 4, "dev/") == 0) {
+    return "/" + location;
+  }
+  return "/dev/" + location;
+}
+
+bool isTermiosBaudRate(int baudRate) { return toSpeed(baudRate) != B0; }
+
+int openTermios(const std::string &path, const TermiosConfig &config,
+                std::string *errorString) {
+  if (!isTermiosBaudRate(config.baudRate)) {
+    *errorString = path + ": unsupported baud rate";
+    return -1;
+  }
+  const int fd =
+      ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    *errorString = path + ": " + std::strerror(errno);
+    return -1;
+  }
+  if (!configure(fd, path, config, errorString) ||
+      (config.rs485.enabled &&
+       !configureRs485(fd, path, config.rs485, errorString))) {
+    ::close(fd);
+    return -1;
+  }
+  /// like QSerialPort, other processes may not open it meanwhile
+  ioctl(fd, TIOCEXCL);
+  if (config.lowLatency && !enableLowLatency(fd)) {
+    log("", LogLevel::kWarning, "{}: low latency mode is not supported",
+        path);
+  }
+  return fd;
+}
+
+} // namespace modbus
+
+#endif // __linux__
@@ -0,0 +1,341 @@
+#include <modbus/tools/modbus_termios_serialport.h>
+
+#if defined(__linux__)
+
+#include <QEvent>
+#include <QSocketNotifier>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <modbus/tools/modbus_server.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace modbus {
+
+namespace {
+/**
+ * calls func when the fd is ready. the activated signal of QSocketNotifier
+ * is overloaded differently across qt versions, so the event is handled here
+ */
+class FdNotifier : public QSocketNotifier {
+public:
+  FdNotifier(int fd, Type type, const std::function<void()> &func,
+             QObject *parent = nullptr)
+      : QSocketNotifier(fd, type, parent), func_(func) {}
+
+protected:
+  bool event(QEvent *e) override {
+    if (e->type() == QEvent::SockAct) {
+      func_();
+      return true;
+    }
+    return QSocketNotifier::event(e);
+  }
+
+private:
+  std::function<void()> func_;
+};
+} // namespace
+
+class TermiosSerialPortPrivate {
+public:
+  void closeFd() {
+    /// the notifiers may be in their own event handler
+    readNotifier_->setEnabled(false);
+    readNotifier_->deleteLater();
+    readNotifier_ = nullptr;
+    writeNotifier_->setEnabled(false);
+    writeNotifier_->deleteLater();
+    writeNotifier_ = nullptr;
+    ::close(fd_);
+    fd_ = -1;
+    writeBuffer_.Reset();
+  }
+
+  std::string portName_;
+  TermiosConfig config_;
+
+  int fd_ = -1;
+  FdNotifier *readNotifier_ = nullptr;
+  FdNotifier *writeNotifier_ = nullptr;
+  /// the bytes the tty did not take yet
+  pp::bytes::Buffer writeBuffer_;
+  RtuSilence silence_;
+};
+
+TermiosSerialPort::TermiosSerialPort(QObject *parent)
+    : AbstractIoDevice(parent), d_ptr(new TermiosSerialPortPrivate()) {}
+
+TermiosSerialPort::~TermiosSerialPort() {
+  Q_D(TermiosSerialPort);
+  if (d->fd_ >= 0) {
+    d->closeFd();
+  }
+}
+
+void TermiosSerialPort::setPortName(const QString &name) {
+  Q_D(TermiosSerialPort);
+  d->portName_ = termiosPortLocation(name.toStdString());
+}
+
+bool TermiosSerialPort::setBaudRate(qint32 baudRate) {
+  Q_D(TermiosSerialPort);
+  if (!isTermiosBaudRate(baudRate)) {
+    return false;
+  }
+  d->config_.baudRate = baudRate;
+  return true;
+}
+
+void TermiosSerialPort::setDataBits(QSerialPort::DataBits dataBits) {
+  Q_D(TermiosSerialPort);
+  d->config_.dataBits = dataBits;
+}
+
+void TermiosSerialPort::setParity(QSerialPort::Parity parity) {
+  Q_D(TermiosSerialPort);
+  switch (parity) {
+  case QSerialPort::EvenParity:
+    d->config_.parity = 'E';
+    break;
+  case QSerialPort::OddParity:
+    d->config_.parity = 'O';
+    break;
+  case QSerialPort::SpaceParity:
+    d->config_.parity = 'S';
+    break;
+  case QSerialPort::MarkParity:
+    d->config_.parity = 'M';
+    break;
+  default:
+    d->config_.parity = 'N';
+    break;
+  }
+}
+
+void TermiosSerialPort::setStopBits(QSerialPort::StopBits stopBits) {
+  Q_D(TermiosSerialPort);
+  d->config_.stopBits = stopBits == QSerialPort::TwoStop ? 2 : 1;
+}
+
+void TermiosSerialPort::setLowLatency(bool enable) {
+  Q_D(TermiosSerialPort);
+  d->config_.lowLatency = enable;
+}
+
+void TermiosSerialPort::setReadBatching(int minBytes) {
+  Q_D(TermiosSerialPort);
+  d->config_.readBatching = std::min(std::max(minBytes, 1), 255);
+}
+
+void TermiosSerialPort::setRs485(const Rs485Config &config) {
+  Q_D(TermiosSerialPort);
+  d->config_.rs485 = config;
+}
+
+int TermiosSerialPort::handle() const {
+  const Q_D(TermiosSerialPort);
+  return d->fd_;
+}
+
+bool TermiosSerialPort::isOpen() const {
+  const Q_D(TermiosSerialPort);
+  return d->fd_ >= 0;
+}
+
+void TermiosSerialPort::open() {
+  Q_D(TermiosSerialPort);
+  if (d->fd_ >= 0) {
+    return;
+  }
+
+  std::string errorString;
+  d->fd_ = openTermios(d->portName_, d->config_, &errorString);
+  if (d->fd_ < 0) {
+    emit error(QString::fromStdString(errorString));
+    return;
+  }
+
+  d->readNotifier_ = new FdNotifier(d->fd_, QSocketNotifier::Read,
+                                    [this]() { onReadable(); }, this);
+  d->writeNotifier_ = new FdNotifier(d->fd_, QSocketNotifier::Write,
+                                     [this]() { onWritable(); }, this);
+  d->writeNotifier_->setEnabled(false);
+  d->silence_.setBaudRate(d->config_.baudRate);
+  d->silence_.reset();
+  emit opened();
+}
+
+void TermiosSerialPort::close() {
+  Q_D(TermiosSerialPort);
+  if (d->fd_ >= 0) {
+    d->closeFd();
+  }
+  emit closed();
+}
+
+void TermiosSerialPort::write(const char *data, size_t size) {
+  Q_D(TermiosSerialPort);
+  if (d->fd_ < 0) {
+    return;
+  }
+  /// write at once, the bytes queued before go first
+  if (d->writeBuffer_.Len() == 0) {
+    const ssize_t n = ::write(d->fd_, data, size);
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      emit error(QString::fromStdString(d->portName_ + ": write " +
+                                        std::strerror(errno)));
+      return;
+    }
+    if (n > 0) {
+      d->silence_.sent(RtuSilence::now(), static_cast<size_t>(n));
+      data += n;
+      size -= static_cast<size_t>(n);
+      emit bytesWritten(n);
+    }
+  }
+  if (size > 0) {
+    d->writeBuffer_.Write(data, size);
+    d->writeNotifier_->setEnabled(true);
+  }
+}
+
+QByteArray TermiosSerialPort::readAll() {
+  pp::bytes::Buffer buffer;
+  const size_t size = readInto(buffer);
+  char *p = nullptr;
+  buffer.ZeroCopyPeekAt(&p, 0, size);
+  return QByteArray(p, static_cast<int>(size));
+}
+
+size_t TermiosSerialPort::readInto(pp::bytes::Buffer &buffer) {
+  Q_D(TermiosSerialPort);
+  if (d->fd_ < 0) {
+    return 0;
+  }
+
+  size_t total = 0;
+  int errorCode = 0;
+  for (;;) {
+    int available = 0;
+    ioctl(d->fd_, FIONREAD, &available);
+    const size_t size = static_cast<size_t>(std::max(available, 256));
+    uint8_t *p = buffer.BeginWrite(size);
+    const ssize_t n = ::read(d->fd_, p, size);
+    if (n > 0) {
+      buffer.CommitWrite(static_cast<size_t>(n));
+      total += static_cast<size_t>(n);
+      if (static_cast<size_t>(n) < size) {
+        break;
+      }
+    } else if (n == 0) {
+      /// hung up
+      errorCode = EIO;
+      break;
+    } else if (errno != EINTR) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        errorCode = errno;
+      }
+      break;
+    }
+  }
+
+  if (errorCode != 0) {
+    emit error(QString::fromStdString(d->portName_ + ": read " +
+                                      std::strerror(errorCode)));
+    return total;
+  }
+  d->readNotifier_->setEnabled(true);
+  return total;
+}
+
+void TermiosSerialPort::clear() {
+  Q_D(TermiosSerialPort);
+  if (d->fd_ < 0) {
+    return;
+  }
+  tcflush(d->fd_, TCIOFLUSH);
+  d->writeBuffer_.Reset();
+  d->writeNotifier_->setEnabled(false);
+}
+
+std::string TermiosSerialPort::name() {
+  Q_D(TermiosSerialPort);
+  return d->portName_;
+}
+
+RtuSilence *TermiosSerialPort::silence() {
+  Q_D(TermiosSerialPort);
+  return &d->silence_;
+}
+
+void TermiosSerialPort::onReadable() {
+  Q_D(TermiosSerialPort);
+  /// level triggered, off until the bytes are read
+  d->readNotifier_->setEnabled(false);
+  int available = 0;
+  if (ioctl(d->fd_, FIONREAD, &available) == 0 && available > 0) {
+    d->silence_.received(RtuSilence::now(), static_cast<size_t>(available));
+  }
+  emit readyRead();
+}
+
+void TermiosSerialPort::onWritable() {
+  Q_D(TermiosSerialPort);
+  uint8_t *p = nullptr;
+  const size_t len = d->writeBuffer_.Len();
+  d->writeBuffer_.ZeroCopyPeekAt(&p, 0, len);
+  const ssize_t n = ::write(d->fd_, p, len);
+  if (n < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      emit error(QString::fromStdString(d->portName_ + ": write " +
+                                        std::strerror(errno)));
+    }
+    return;
+  }
+  d->writeBuffer_.ZeroCopyRead(&p, static_cast<size_t>(n));
+  d->silence_.sent(RtuSilence::now(), static_cast<size_t>(n));
+  if (d->writeBuffer_.Len() == 0) {
+    d->writeNotifier_->setEnabled(false);
+  }
+  emit bytesWritten(n);
+}
+
+QModbusClient *newTermiosSerialClient(const QString &serialName,
+                                      QSerialPort::BaudRate baudRate,
+                                      QSerialPort::DataBits dataBits,
+                                      QSerialPort::Parity parity,
+                                      QSerialPort::StopBits stopBits,
+                                      QObject *parent) {
+  TermiosSerialPort *port = new TermiosSerialPort(parent);
+  port->setPortName(serialName);
+  port->setBaudRate(baudRate);
+  port->setDataBits(dataBits);
+  port->setParity(parity);
+  port->setStopBits(stopBits);
+
+  return new QModbusClient(port, parent);
+}
+
+QModbusServer *createQModbusTermiosSerialServer(const QString &serialName,
+                                                QSerialPort::BaudRate baudRate,
+                                                QSerialPort::DataBits dataBits,
+                                                QSerialPort::Parity parity,
+                                                QSerialPort::StopBits stopBits,
+                                                QObject *parent) {
+  TermiosSerialPort *port = new TermiosSerialPort(parent);
+  port->setPortName(serialName);
+  port->setBaudRate(baudRate);
+  port->setDataBits(dataBits);
+  port->setParity(parity);
+  port->setStopBits(stopBits);
+
+  return createQModbusSerialServer(port, parent);
+}
+
+} // namespace modbus
+
+#endif // __linux__
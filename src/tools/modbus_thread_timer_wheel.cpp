@@ -0,0 +1,49 @@
+#include "modbus_thread_timer_wheel.h"
+
+namespace modbus {
+
+std::shared_ptr<ThreadTimerWheel> ThreadTimerWheel::current() {
+  static thread_local std::weak_ptr<ThreadTimerWheel> instance;
+  std::shared_ptr<ThreadTimerWheel> wheel = instance.lock();
+  if (!wheel) {
+    wheel = std::make_shared<ThreadTimerWheel>();
+    instance = wheel;
+  }
+  return wheel;
+}
+
+ThreadTimerWheel::ThreadTimerWheel() {
+  tick_.setSingleShot(true);
+  tick_.setTimerType(Qt::PreciseTimer);
+  QObject::connect(&tick_, &QTimer::timeout, [this]() { onTick(); });
+}
+
+void ThreadTimerWheel::schedule(TimerWheel::Timer *timer, int delay) {
+  wheel_.schedule(timer, static_cast<int64_t>(delay) * 1000);
+  rearm();
+}
+
+void ThreadTimerWheel::onTick() {
+  /// a callback may drop the last holder, e.g. by deleting a client
+  std::shared_ptr<ThreadTimerWheel> self = shared_from_this();
+  armed_ = -1;
+  wheel_.advance();
+  rearm();
+}
+
+void ThreadTimerWheel::rearm() {
+  const int64_t next = wheel_.nextExpiry();
+  if (next < 0) {
+    armed_ = -1;
+    tick_.stop();
+    return;
+  }
+  if (armed_ >= 0 && armed_ <= next) {
+    return;
+  }
+  armed_ = next;
+  const int64_t delay = next - TimerWheel::steadyNow();
+  tick_.start(delay > 0 ? static_cast<int>((delay + 999) / 1000) : 0);
+}
+
+} // namespace modbus
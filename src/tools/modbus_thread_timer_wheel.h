@@ -0,0 +1,45 @@
+#ifndef MODBUS_THREAD_TIMER_WHEEL_H
+#define MODBUS_THREAD_TIMER_WHEEL_H
+
+#include <QTimer>
+#include <memory>
+#include <modbus/base/modbus_timer_wheel.h>
+
+namespace modbus {
+
+/**
+ * The timer wheel of a thread, shared by the clients and devices living on
+ * it. One QTimer is the tick source, it is armed to the next expiry of the
+ * wheel, so the thread has one Qt timer however many timers are running,
+ * and none while they are all idle. The timers fire in its timeout.
+ *
+ * current() returns the wheel of the calling thread, it is created on the
+ * first call and lives while it is held.
+ */
+class ThreadTimerWheel
+    : public std::enable_shared_from_this<ThreadTimerWheel> {
+public:
+  static std::shared_ptr<ThreadTimerWheel> current();
+
+  ThreadTimerWheel();
+  ThreadTimerWheel(const ThreadTimerWheel &) = delete;
+  ThreadTimerWheel &operator=(const ThreadTimerWheel &) = delete;
+
+  /// delay in milliseconds, a scheduled timer is rescheduled
+  void schedule(TimerWheel::Timer *timer, int delay);
+  /// the tick source is left armed, an early tick is harmless
+  void cancel(TimerWheel::Timer *timer) { wheel_.cancel(timer); }
+
+private:
+  void onTick();
+  void rearm();
+
+  TimerWheel wheel_;
+  QTimer tick_;
+  /// the time tick_ is armed to, -1 if it is stopped
+  int64_t armed_ = -1;
+};
+
+} // namespace modbus
+
+#endif // MODBUS_THREAD_TIMER_WHEEL_H
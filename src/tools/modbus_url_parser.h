@@ -15,6 +15,8 @@ struct Config {
   QSerialPort::DataBits dataBits;
   QSerialPort::Parity parity;
   QSerialPort::StopBits stopBits;
+  /// the options after the serial config, e.g. ?9600-8-n-1&backend=termios
+  QMap<QString, QString> options;
 
   uint16_t port;
   QString host;
@@ -29,8 +31,14 @@ inline Config parseConfig(const QString &url) {
   config.host = qurl.host();
   config.serialName = qurl.path().mid(1);
 
-  QString query = qurl.query();
-  QStringList serialConfig = query.split("-");
+  QStringList query = qurl.query().split("&");
+  for (int i = 1; i < query.size(); i++) {
+    const QStringList option = query[i].split("=");
+    if (option.size() == 2) {
+      config.options[option[0]] = option[1];
+    }
+  }
+  QStringList serialConfig = query[0].split("-");
   if (serialConfig.size() != 4) {
     serialConfig = QString("9600-8-n-1").split("-");
   }
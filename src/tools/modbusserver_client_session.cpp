@@ -9,7 +9,8 @@ ClientSession::ClientSession(QModbusServerPrivate *d,
                              AbstractConnection *connction,
                              const CheckSizeFuncTable &table)
     : d_(d), client(connction) {
-  decoder = createModbusFrameDecoder(d_->transferMode_, table);
+  /// in mbap mode the frames of unknown function codes are decoded too
+  decoder = createModbusFrameDecoder(d_->transferMode_, table, true);
   encoder = createModbusFrameEncoder(d_->transferMode_);
 }
 
@@ -26,6 +27,16 @@ void ClientSession::handleModbusRequest(pp::bytes::Buffer &buffer) {
 }
 
 void ClientSession::processModbusRequest(pp::bytes::Buffer &buffer) {
+  /// always taken, so the gaps do not pile up while it is disabled
+  RtuSilence *silence = client->silence();
+  if (silence) {
+    const RtuSilenceGaps gaps = silence->take();
+    if (d_->enableRtuSilenceDetection_ && !gaps.empty() &&
+        gaps.size <= buffer.Len()) {
+      decoder->Silence(buffer, buffer.Len() - gaps.size, gaps);
+    }
+  }
+
   decoder->Decode(buffer, &request_);
   if (!decoder->IsDone()) {
     log(d_->log_prefix_, LogLevel::kDebug, "{} need more data",
@@ -61,6 +72,14 @@ void ClientSession::processModbusRequest(pp::bytes::Buffer &buffer) {
    *discard the recive buffer,
    */
   if (!d_->handleFuncRouter_.contains(request_.functionCode())) {
+    if (d_->rawRequestHandler_) {
+      d_->processRawRequest(&request_, &response_);
+      /// no response to a brocast
+      if (request_.serverAddress() == Adu::kBrocastAddress) {
+        response_ = Adu();
+      }
+      return;
+    }
     log(d_->log_prefix_, LogLevel::kError, "{} unsupported function code",
         client->fullName(), request_.functionCode());
 
@@ -1,6 +1,8 @@
 #include "base/modbus_frame.h"
 #include "modbus/base/modbus.h"
 #include "modbus/base/modbus_types.h"
+#include "modbus/base/single_bit_access.h"
+#include "modbus/base/sixteen_bit_access.h"
 #include "modbus_test_mocker.h"
 #include <atomic>
 
@@ -59,3 +61,37 @@ TEST(TestAdu, modbusAduMarshalData) {
   EXPECT_EQ(actual.data, expect.data);
   EXPECT_EQ(actual.size, expect.size);
 }
+
+TEST(TestModbusRequest, reuseUserData_sameTypeKeepsValue) {
+  Request request;
+  auto access = request.reuseUserData<SixteenBitAccess>();
+  access->setStartAddress(10);
+  access->setQuantity(4);
+
+  auto reused = request.reuseUserData<SixteenBitAccess>();
+  EXPECT_EQ(access, reused);
+  EXPECT_EQ(reused->startAddress(), 10);
+  EXPECT_EQ(reused->quantity(), 4);
+
+  reused->marshalMultipleReadRequest(request.mutableData());
+  EXPECT_THAT(request.data(), ElementsAre(0x00, 0x0a, 0x00, 0x04));
+}
+
+TEST(TestModbusRequest, reuseUserData_otherTypeIsReplaced) {
+  Request request;
+  request.reuseUserData<SixteenBitAccess>()->setStartAddress(10);
+
+  auto access = request.reuseUserData<SingleBitAccess>();
+  EXPECT_EQ(request.userData().type(), typeid(SingleBitAccess));
+  EXPECT_EQ(access, request.reuseUserData<SingleBitAccess>());
+}
+
+TEST(TestModbusAny, anyCast_otherType_nullptr) {
+  any data = SixteenBitAccess();
+  EXPECT_NE(any::any_cast<SixteenBitAccess>(&data), nullptr);
+  EXPECT_EQ(any::any_cast<SingleBitAccess>(&data), nullptr);
+  EXPECT_THROW(any::any_cast<SingleBitAccess>(data), std::bad_cast);
+
+  any empty;
+  EXPECT_EQ(any::any_cast<SingleBitAccess>(&empty), nullptr);
+}
@@ -0,0 +1,65 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <modbus/base/modbus_change_filter.h>
+
+using namespace testing;
+using namespace modbus;
+
+static ByteArray makeRegisters(size_t registers) {
+  ByteArray data(registers * 2);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<uint8_t>(i);
+  }
+  return data;
+}
+
+TEST(ChangeFilter, firstResponse_allChanged) {
+  ChangeFilter filter;
+  std::vector<AddressRange> changed;
+  EXPECT_TRUE(filter.update(makeRegisters(10), &changed));
+  EXPECT_THAT(changed, ElementsAre(AddressRange(0, 10)));
+
+  EXPECT_FALSE(filter.update(makeRegisters(10), &changed));
+  EXPECT_TRUE(changed.empty());
+
+  // another size, report all again
+  EXPECT_TRUE(filter.update(makeRegisters(11), &changed));
+  EXPECT_THAT(changed, ElementsAre(AddressRange(0, 11)));
+}
+
+TEST(ChangeFilter, changedRegisters_mergedIntoRanges) {
+  ChangeFilter filter;
+  std::vector<AddressRange> changed;
+  ByteArray data = makeRegisters(40);
+  filter.update(data, &changed);
+
+  data[3 * 2] ^= 0xFF;
+  data[4 * 2 + 1] ^= 0xFF;
+  data[9 * 2] ^= 0xFF;
+  data[39 * 2 + 1] ^= 0xFF;
+  EXPECT_TRUE(filter.update(data, &changed));
+  EXPECT_THAT(changed, ElementsAre(AddressRange(3, 2), AddressRange(9, 1),
+                                   AddressRange(39, 1)));
+
+  EXPECT_FALSE(filter.update(data, &changed));
+}
+
+TEST(ChangeFilter, deadband_smallChangeSuppressed) {
+  std::vector<RegisterTag> tags(2);
+  tags[0].offset = 0;
+  tags[0].deadband = 5;
+  tags[1].offset = 1;
+  tags[1].deadbandPercent = 10;
+  ChangeFilter filter{RegisterSchema(tags)};
+
+  std::vector<AddressRange> changed;
+  filter.update(ByteArray({0x00, 100, 0x00, 100}), &changed);
+
+  // +3 and +9%, both inside the deadbands
+  EXPECT_FALSE(filter.update(ByteArray({0x00, 103, 0x00, 109}), &changed));
+  // +6 against the value reported last time
+  EXPECT_TRUE(filter.update(ByteArray({0x00, 106, 0x00, 109}), &changed));
+  EXPECT_THAT(changed, ElementsAre(AddressRange(0, 1)));
+  EXPECT_TRUE(filter.update(ByteArray({0x00, 106, 0x00, 111}), &changed));
+  EXPECT_THAT(changed, ElementsAre(AddressRange(1, 1)));
+}
@@ -0,0 +1,43 @@
+#include "modbus_dirty_ranges.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace modbus;
+
+TEST(DirtyRanges, adjacentMarks_merged) {
+  DirtyRanges dirty;
+  for (modbus::Address address = 0; address < 2000; address++) {
+    dirty.mark(address, 1);
+  }
+  EXPECT_THAT(dirty.take(), ElementsAre(AddressRange(0, 2000)));
+  EXPECT_TRUE(dirty.empty());
+}
+
+TEST(DirtyRanges, disjointMarks_keptSorted) {
+  DirtyRanges dirty;
+  dirty.mark(20, 2);
+  dirty.mark(0, 1);
+  dirty.mark(10, 5);
+  dirty.mark(0, 0);
+  EXPECT_THAT(dirty.ranges(),
+              ElementsAre(AddressRange(0, 1), AddressRange(10, 5),
+                          AddressRange(20, 2)));
+}
+
+TEST(DirtyRanges, overlappingMark_mergesNeighbours) {
+  DirtyRanges dirty;
+  dirty.mark(0, 2);
+  dirty.mark(5, 2);
+  dirty.mark(10, 2);
+  dirty.mark(30, 2);
+  dirty.mark(1, 10);
+  EXPECT_THAT(dirty.ranges(),
+              ElementsAre(AddressRange(0, 12), AddressRange(30, 2)));
+
+  dirty.mark(0xFFF0, 0x10);
+  dirty.mark(0xFFFF, 1);
+  EXPECT_THAT(dirty.ranges(),
+              ElementsAre(AddressRange(0, 12), AddressRange(30, 2),
+                          AddressRange(0xFFF0, 0x10)));
+}
@@ -0,0 +1,278 @@
+#include "modbus_test_mocker.h"
+#include <QSignalSpy>
+#include <QTest>
+#include <modbus/tools/modbus_gateway.h>
+#include <modbus/tools/modbus_server.h>
+
+using namespace testing;
+using namespace modbus;
+
+#define declare_app(name)                                                      \
+  int argc = 1;                                                                \
+  char *argv[] = {(char *)"test"};                                             \
+  QCoreApplication name(argc, argv);
+
+class GatewayTestConnection : public AbstractConnection {
+  Q_OBJECT
+public:
+  explicit GatewayTestConnection(quintptr fd, QObject *parent = nullptr)
+      : AbstractConnection(parent) {
+    EXPECT_CALL(*this, fd()).WillRepeatedly(Return(fd));
+    EXPECT_CALL(*this, fullName()).WillRepeatedly(Return("127.0.0.1:5020"));
+    EXPECT_CALL(*this, write(_, _))
+        .WillRepeatedly(Invoke([&](const char *data, size_t size) {
+          written.push_back(ByteArray(data, data + size));
+        }));
+  }
+  ~GatewayTestConnection() override = default;
+
+  MOCK_CONST_METHOD0(fd, quintptr());
+  MOCK_METHOD2(write, void(const char *data, size_t size));
+  MOCK_CONST_METHOD0(name, std::string());
+  MOCK_CONST_METHOD0(fullName, std::string());
+
+  void receive(const ByteArray &frame) {
+    BytesBufferPtr buffer(new pp::bytes::Buffer());
+    buffer->Write(frame);
+    emit messageArrived(fd(), buffer);
+  }
+
+  std::vector<ByteArray> written;
+};
+
+class GatewayTestServer : public AbstractServer {
+  Q_OBJECT
+public:
+  explicit GatewayTestServer(QObject *parent = nullptr)
+      : AbstractServer(parent) {}
+  ~GatewayTestServer() override = default;
+  MOCK_METHOD0(listenAndServe, bool());
+
+  void newConnection(AbstractConnection *connection) {
+    handleNewConnFunc_(connection);
+  }
+};
+
+/// a serial bus answering every request with response
+static MockSerialPort *createBus(const ByteArray &response) {
+  auto serialPort = new MockSerialPort();
+  EXPECT_CALL(*serialPort, write(_, _)).Times(AnyNumber());
+  EXPECT_CALL(*serialPort, readAll()).WillRepeatedly(Invoke([response]() {
+    return QByteArray(reinterpret_cast<const char *>(response.data()),
+                      static_cast<int>(response.size()));
+  }));
+  return serialPort;
+}
+
+TEST(QModbusGateway, noRoute_unavailableGatewayPath) {
+  GatewayTestServer server;
+  QModbusGateway gateway(&server);
+  auto conn = new GatewayTestConnection(1);
+  server.newConnection(conn);
+
+  conn->receive({0x12, 0x34, 0x00, 0x00, 0x00, 0x06, 0x05, 0x03, 0x00, 0x00,
+                 0x00, 0x01});
+
+  ASSERT_EQ(conn->written.size(), 1U);
+  EXPECT_THAT(conn->written[0], ElementsAre(0x12, 0x34, 0x00, 0x00, 0x00, 0x03,
+                                            0x05, 0x83, 0x0a));
+  EXPECT_EQ(gateway.pendingRequestSize(), 0U);
+}
+
+TEST(QModbusGateway, forwardRequest_responseHasTransactionId) {
+  declare_app(app);
+  {
+    GatewayTestServer server;
+    QModbusGateway gateway(&server);
+    auto conn = new GatewayTestConnection(1);
+    server.newConnection(conn);
+
+    QModbusClient bus(createBus(
+        tool::appendCrc(ByteArray({0x01, 0x03, 0x02, 0x00, 0x2a}))));
+    bus.open();
+    gateway.addRoute(1, &bus);
+    EXPECT_EQ(gateway.route(1), &bus);
+
+    QSignalSpy spy(&bus, &QModbusClient::requestFinished);
+    conn->receive({0x12, 0x34, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x00,
+                   0x00, 0x01});
+    EXPECT_EQ(gateway.pendingRequestSize(), 1U);
+    spy.wait(5000);
+
+    ASSERT_EQ(conn->written.size(), 1U);
+    EXPECT_THAT(conn->written[0],
+                ElementsAre(0x12, 0x34, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03,
+                            0x02, 0x00, 0x2a));
+    EXPECT_EQ(gateway.pendingRequestSize(), 0U);
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(QModbusGateway, pipelinedRequests_eachBusAnswers) {
+  declare_app(app);
+  {
+    GatewayTestServer server;
+    QModbusGateway gateway(&server);
+    auto conn = new GatewayTestConnection(1);
+    server.newConnection(conn);
+
+    QModbusClient bus1(createBus(
+        tool::appendCrc(ByteArray({0x01, 0x03, 0x02, 0x00, 0x01}))));
+    QModbusClient bus2(createBus(
+        tool::appendCrc(ByteArray({0x02, 0x03, 0x02, 0x00, 0x02}))));
+    bus1.open();
+    bus2.open();
+    gateway.addRoute(1, &bus1);
+    gateway.addRoute(2, &bus2);
+
+    /// two transactions in one segment, to different buses
+    conn->receive({0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x00,
+                   0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x06, 0x02, 0x03,
+                   0x00, 0x00, 0x00, 0x01});
+    EXPECT_EQ(gateway.pendingRequestSize(), 2U);
+    EXPECT_EQ(bus1.pendingRequestSize(), 1U);
+    EXPECT_EQ(bus2.pendingRequestSize(), 1U);
+
+    for (int i = 0; i < 50 && gateway.pendingRequestSize() > 0; i++) {
+      QTest::qWait(100);
+    }
+    ASSERT_EQ(conn->written.size(), 2U);
+    EXPECT_THAT(conn->written,
+                UnorderedElementsAre(
+                    ElementsAre(0x00, 0x01, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03,
+                                0x02, 0x00, 0x01),
+                    ElementsAre(0x00, 0x02, 0x00, 0x00, 0x00, 0x05, 0x02, 0x03,
+                                0x02, 0x00, 0x02)));
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(QModbusGateway, unknownFunctionCode_forwardedAsItIs) {
+  declare_app(app);
+  {
+    GatewayTestServer server;
+    QModbusGateway gateway(&server);
+    auto conn = new GatewayTestConnection(1);
+    server.newConnection(conn);
+
+    auto serialPort = new MockSerialPort();
+    ByteArray forwarded;
+    EXPECT_CALL(*serialPort, write(_, _))
+        .WillOnce(Invoke([&](const char *data, size_t size) {
+          forwarded.assign(data, data + size);
+          emit serialPort->bytesWritten(size);
+        }));
+    EXPECT_CALL(*serialPort, readAll()).WillRepeatedly(Return(QByteArray()));
+    QModbusClient bus(serialPort);
+    bus.open();
+    gateway.addRoute(1, &bus);
+
+    /// 0x2b read device identification
+    conn->receive({0x12, 0x34, 0x00, 0x00, 0x00, 0x05, 0x01, 0x2b, 0x0e, 0x01,
+                   0x00});
+    EXPECT_EQ(gateway.pendingRequestSize(), 1U);
+    for (int i = 0; i < 50 && forwarded.empty(); i++) {
+      QTest::qWait(100);
+    }
+    EXPECT_EQ(forwarded,
+              tool::appendCrc(ByteArray({0x01, 0x2b, 0x0e, 0x01, 0x00})));
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(QModbusGateway, deviceNotResponding_targetDeviceResponseLoss) {
+  declare_app(app);
+  {
+    GatewayTestServer server;
+    QModbusGateway gateway(&server);
+    auto conn = new GatewayTestConnection(1);
+    server.newConnection(conn);
+
+    QModbusClient bus(createBus(ByteArray()));
+    bus.setTimeout(100);
+    bus.setRetryTimes(0);
+    bus.open();
+    gateway.addRoute(1, &bus);
+
+    QSignalSpy spy(&bus, &QModbusClient::requestFinished);
+    conn->receive({0x12, 0x34, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x00,
+                   0x00, 0x01});
+    spy.wait(5000);
+
+    ASSERT_EQ(conn->written.size(), 1U);
+    EXPECT_THAT(conn->written[0], ElementsAre(0x12, 0x34, 0x00, 0x00, 0x00,
+                                              0x03, 0x01, 0x83, 0x0b));
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(QModbusGateway, badCrcFromDevice_targetDeviceResponseLoss) {
+  declare_app(app);
+  {
+    GatewayTestServer server;
+    QModbusGateway gateway(&server);
+    auto conn = new GatewayTestConnection(1);
+    server.newConnection(conn);
+
+    /// a read response with a broken crc, its data is not forwarded
+    QModbusClient bus(
+        createBus(ByteArray({0x01, 0x03, 0x02, 0x00, 0x2a, 0x00, 0x00})));
+    bus.setRetryTimes(0);
+    bus.open();
+    gateway.addRoute(1, &bus);
+
+    QSignalSpy spy(&bus, &QModbusClient::requestFinished);
+    conn->receive({0x12, 0x34, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x00,
+                   0x00, 0x01});
+    spy.wait(5000);
+
+    ASSERT_EQ(spy.count(), 1);
+    const Response response = qvariant_cast<Response>(spy.at(0).at(1));
+    EXPECT_EQ(response.error(), Error::kStorageParityError);
+    ASSERT_EQ(conn->written.size(), 1U);
+    EXPECT_THAT(conn->written[0], ElementsAre(0x12, 0x34, 0x00, 0x00, 0x00,
+                                              0x03, 0x01, 0x83, 0x0b));
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(QModbusGateway, busQueueFull_unavailableGatewayPath) {
+  declare_app(app);
+  {
+    GatewayTestServer server;
+    QModbusGateway gateway(&server);
+    gateway.setMaxPendingPerBus(1);
+    auto conn = new GatewayTestConnection(1);
+    server.newConnection(conn);
+
+    QModbusClient bus(createBus(ByteArray()));
+    bus.open();
+    gateway.addRoute(1, &bus);
+
+    conn->receive({0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x00,
+                   0x00, 0x01});
+    conn->receive({0x00, 0x02, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x00,
+                   0x00, 0x01});
+    EXPECT_EQ(gateway.pendingRequestSize(), 1U);
+    ASSERT_EQ(conn->written.size(), 1U);
+    EXPECT_THAT(conn->written[0], ElementsAre(0x00, 0x02, 0x00, 0x00, 0x00,
+                                              0x03, 0x01, 0x83, 0x0a));
+
+    /// the requests of a closed bus never complete
+    bus.close();
+    QTest::qWait(100);
+    EXPECT_EQ(gateway.pendingRequestSize(), 0U);
+    ASSERT_EQ(conn->written.size(), 2U);
+    EXPECT_THAT(conn->written[1], ElementsAre(0x00, 0x01, 0x00, 0x00, 0x00,
+                                              0x03, 0x01, 0x83, 0x0b));
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+#include "modbus_test_gateway.moc"
@@ -199,3 +199,59 @@ TEST(ModbusMbapFrameDecoder, decode_bad_funtioncode) {
   EXPECT_TRUE(decoder.IsDone());
   EXPECT_EQ(Error::kIllegalFunctionCode, decoder.LasError());
 }
+
+TEST(ModbusMbapFrameDecoder, frameByLength_unknownFunctionCode_decoded) {
+  pp::bytes::Buffer buffer;
+  /// 0x2b read device identification, then a 0x03 request
+  buffer.Write("\x00\x01\x00\x00\x00\x05\x01\x2b\x0e\x01\x00"
+               "\x00\x02\x00\x00\x00\x06\x01\x03\x00\x00\x00\x01",
+               23);
+
+  Adu adu;
+  ModbusMbapFrameDecoder decoder(creatDefaultCheckSizeFuncTableForServer(),
+                                 true);
+
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kNoError, decoder.LasError());
+  EXPECT_EQ(adu.transactionId(), 0x01);
+  EXPECT_EQ(adu.functionCode(), 0x2b);
+  EXPECT_THAT(adu.data(), ::testing::ElementsAre(0x0e, 0x01, 0x00));
+
+  decoder.Clear();
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(adu.transactionId(), 0x02);
+  EXPECT_EQ(adu.functionCode(), 0x03);
+  EXPECT_THAT(adu.data(), ::testing::ElementsAre(0x00, 0x00, 0x00, 0x01));
+  EXPECT_EQ(buffer.Len(), 0U);
+}
+
+TEST(ModbusMbapFrameDecoder, frameByLength_functionCodeOnly_emptyData) {
+  pp::bytes::Buffer buffer;
+  buffer.Write("\x00\x01\x00\x00\x00\x02\x01\x07", 8);
+
+  Adu adu;
+  ModbusMbapFrameDecoder decoder(creatDefaultCheckSizeFuncTableForServer(),
+                                 true);
+
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kNoError, decoder.LasError());
+  EXPECT_EQ(adu.functionCode(), 0x07);
+  EXPECT_TRUE(adu.data().empty());
+}
+
+TEST(ModbusMbapFrameDecoder, frameByLength_badLength_frameDropped) {
+  pp::bytes::Buffer buffer;
+  buffer.Write("\x00\x01\x00\x00\x00\x01\x01", 7);
+
+  Adu adu;
+  ModbusMbapFrameDecoder decoder(creatDefaultCheckSizeFuncTableForServer(),
+                                 true);
+
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kStorageParityError, decoder.LasError());
+  EXPECT_EQ(buffer.Len(), 0U);
+}
@@ -0,0 +1,73 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <modbus/base/modbus_mpsc_queue.h>
+#include <thread>
+#include <vector>
+
+using namespace testing;
+using namespace modbus;
+
+struct Item : public MpscNode {
+  int producer = 0;
+  int sequence = 0;
+};
+
+TEST(MpscQueue, empty_popNull) {
+  MpscQueue<Item> queue;
+  EXPECT_EQ(queue.pop(), nullptr);
+}
+
+TEST(MpscQueue, pushPop_fifo) {
+  MpscQueue<Item> queue;
+  Item items[3];
+  for (auto &item : items) {
+    queue.push(&item);
+  }
+  EXPECT_EQ(queue.pop(), &items[0]);
+  EXPECT_EQ(queue.pop(), &items[1]);
+  EXPECT_EQ(queue.pop(), &items[2]);
+  EXPECT_EQ(queue.pop(), nullptr);
+
+  /// a node popped may be pushed again
+  queue.push(&items[1]);
+  EXPECT_EQ(queue.pop(), &items[1]);
+  EXPECT_EQ(queue.pop(), nullptr);
+}
+
+TEST(MpscQueue, manyProducers_allPoppedInOrderOfEachProducer) {
+  const int kProducers = 4;
+  const int kItems = 20000;
+  MpscQueue<Item> queue;
+  std::vector<std::unique_ptr<Item[]>> items;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; p++) {
+    items.emplace_back(new Item[kItems]);
+  }
+  for (int p = 0; p < kProducers; p++) {
+    producers.emplace_back([&, p]() {
+      for (int i = 0; i < kItems; i++) {
+        items[p][i].producer = p;
+        items[p][i].sequence = i;
+        queue.push(&items[p][i]);
+      }
+    });
+  }
+
+  std::vector<int> next(kProducers, 0);
+  int popped = 0;
+  while (popped < kProducers * kItems) {
+    Item *item = queue.pop();
+    if (item == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(item->sequence, next[item->producer]);
+    next[item->producer]++;
+    popped++;
+  }
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  EXPECT_EQ(queue.pop(), nullptr);
+}
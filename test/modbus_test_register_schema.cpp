@@ -0,0 +1,119 @@
+#include <cstring>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <modbus/base/modbus_register_schema.h>
+
+using namespace testing;
+using namespace modbus;
+
+static RegisterTag makeTag(Quantity offset, TagType type,
+                           RegisterWordOrder wordOrder =
+                               RegisterWordOrder::kHighWordFirst) {
+  RegisterTag tag;
+  tag.offset = offset;
+  tag.type = type;
+  tag.wordOrder = wordOrder;
+  return tag;
+}
+
+static void appendFloat(ByteArray &data, float value, bool highWordFirst) {
+  uint32_t raw;
+  std::memcpy(&raw, &value, 4);
+  const uint16_t high = raw >> 16;
+  const uint16_t low = raw & 0xFFFF;
+  const uint16_t first = highWordFirst ? high : low;
+  const uint16_t second = highWordFirst ? low : high;
+  data.push_back(first >> 8);
+  data.push_back(first & 0xFF);
+  data.push_back(second >> 8);
+  data.push_back(second & 0xFF);
+}
+
+TEST(RegisterSchema, floats_mergedIntoOneRun) {
+  std::vector<RegisterTag> tags;
+  ByteArray data;
+  for (int i = 0; i < 120; i++) {
+    tags.push_back(makeTag(i * 2, TagType::kFloat32));
+    appendFloat(data, i * 1.5f, true);
+  }
+
+  RegisterSchema schema(tags);
+  EXPECT_EQ(schema.runCount(), static_cast<size_t>(1));
+  EXPECT_EQ(schema.registersRequired(), 240);
+
+  RegisterValues values;
+  ASSERT_TRUE(schema.decode(data, &values));
+  ASSERT_EQ(values.floats.size(), static_cast<size_t>(120));
+  for (int i = 0; i < 120; i++) {
+    EXPECT_FLOAT_EQ(values.floats[i], i * 1.5f);
+  }
+}
+
+TEST(RegisterSchema, floatLowWordFirst) {
+  std::vector<RegisterTag> tags;
+  ByteArray data;
+  for (int i = 0; i < 7; i++) {
+    tags.push_back(
+        makeTag(i * 2, TagType::kFloat32, RegisterWordOrder::kLowWordFirst));
+    appendFloat(data, -i * 0.25f, false);
+  }
+
+  RegisterSchema schema(tags);
+  RegisterValues values;
+  ASSERT_TRUE(schema.decode(data, &values));
+  for (int i = 0; i < 7; i++) {
+    EXPECT_FLOAT_EQ(values.floats[i], -i * 0.25f);
+  }
+}
+
+TEST(RegisterSchema, integers) {
+  std::vector<RegisterTag> tags;
+  tags.push_back(makeTag(0, TagType::kInt16));
+  tags.push_back(makeTag(1, TagType::kUint16));
+  tags.push_back(makeTag(2, TagType::kInt32));
+  tags.push_back(
+      makeTag(4, TagType::kUint32, RegisterWordOrder::kLowWordFirst));
+  tags.push_back(makeTag(6, TagType::kInt64));
+  RegisterTag little = makeTag(10, TagType::kUint16);
+  little.byteOrder = RegisterByteOrder::kLittleEndian;
+  tags.push_back(little);
+
+  const ByteArray data = {0xFF, 0xFE,                         // -2
+                          0xFF, 0xFE,                         // 65534
+                          0xFF, 0xFF, 0xFF, 0x9C,             // -100
+                          0x00, 0x02, 0x80, 0x00,             // 0x80000002
+                          0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02,
+                          0x34, 0x12};
+
+  RegisterSchema schema(tags);
+  RegisterValues values;
+  ASSERT_TRUE(schema.decode(data, &values));
+  EXPECT_THAT(values.int32s, ElementsAre(-2, 65534, -100, 0x1234));
+  EXPECT_THAT(values.int64s,
+              ElementsAre(0x80000002LL, 0x0000000100000002LL));
+}
+
+TEST(RegisterSchema, scaleAndString) {
+  std::vector<RegisterTag> tags;
+  RegisterTag voltage = makeTag(0, TagType::kUint16);
+  voltage.scale = 0.1f;
+  tags.push_back(voltage);
+  RegisterTag name = makeTag(1, TagType::kString);
+  name.stringRegisters = 3;
+  tags.push_back(name);
+
+  const ByteArray data = {0x08, 0xFC, 'P', 'M', '-', '1', 0x00, 0x00};
+
+  RegisterSchema schema(tags);
+  RegisterValues values;
+  ASSERT_TRUE(schema.decode(data, &values));
+  ASSERT_EQ(values.floats.size(), static_cast<size_t>(1));
+  EXPECT_FLOAT_EQ(values.floats[0], 230.0f);
+  EXPECT_THAT(values.strings, ElementsAre("PM-1"));
+}
+
+TEST(RegisterSchema, dataTooShort_decodeFailed) {
+  RegisterSchema schema({makeTag(0, TagType::kFloat32)});
+  RegisterValues values;
+  EXPECT_FALSE(schema.decode(ByteArray({0x00, 0x01}), &values));
+}
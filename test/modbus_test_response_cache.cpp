@@ -0,0 +1,120 @@
+#include "modbus_response_cache.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace modbus;
+
+static Request makeRequest(ServerAddress serverAddress,
+                           FunctionCode functionCode, const ByteArray &data) {
+  Request request;
+  request.setServerAddress(serverAddress);
+  request.setFunctionCode(functionCode);
+  request.setData(data);
+  return request;
+}
+
+static Response makeResponse(FunctionCode functionCode,
+                             const ByteArray &data) {
+  Response response;
+  response.setServerAddress(0x01);
+  response.setFunctionCode(functionCode);
+  response.setData(data);
+  return response;
+}
+
+TEST(ResponseCache, disabled_nothingCached) {
+  ResponseCache cache;
+  auto read = makeRequest(0x01, FunctionCode::kReadHoldingRegisters,
+                          {0x00, 0x00, 0x00, 0x01});
+  cache.store(read, makeResponse(FunctionCode::kReadHoldingRegisters,
+                                 {0x02, 0x00, 0x01}));
+  Response response;
+  EXPECT_FALSE(cache.lookup(read, &response));
+  EXPECT_EQ(cache.hits(), 0U);
+  EXPECT_EQ(cache.misses(), 0U);
+}
+
+TEST(ResponseCache, hitWithinTtl_missAfterTtl) {
+  ResponseCache cache;
+  cache.setTtl(100);
+  const auto now = ResponseCache::Clock::now();
+  auto read = makeRequest(0x01, FunctionCode::kReadHoldingRegisters,
+                          {0x00, 0x00, 0x00, 0x01});
+  cache.store(read,
+              makeResponse(FunctionCode::kReadHoldingRegisters,
+                           {0x02, 0x00, 0x01}),
+              now);
+
+  Response response;
+  EXPECT_TRUE(
+      cache.lookup(read, &response, now + std::chrono::milliseconds(99)));
+  EXPECT_THAT(response.data(), ElementsAre(0x02, 0x00, 0x01));
+  EXPECT_FALSE(
+      cache.lookup(read, &response, now + std::chrono::milliseconds(100)));
+  EXPECT_EQ(cache.hits(), 1U);
+  EXPECT_EQ(cache.misses(), 1U);
+
+  // another quantity is another read
+  auto other = makeRequest(0x01, FunctionCode::kReadHoldingRegisters,
+                           {0x00, 0x00, 0x00, 0x02});
+  EXPECT_FALSE(cache.lookup(other, &response, now));
+}
+
+TEST(ResponseCache, exceptionResponse_notCached) {
+  ResponseCache cache;
+  cache.setTtl(100);
+  auto read = makeRequest(0x01, FunctionCode::kReadCoils,
+                          {0x00, 0x00, 0x00, 0x01});
+  auto exception = makeResponse(FunctionCode::kReadCoils, {});
+  exception.setError(Error::kSlaveDeviceBusy);
+  cache.store(read, exception);
+
+  Response response;
+  EXPECT_FALSE(cache.lookup(read, &response));
+}
+
+TEST(ResponseCache, overlappingWrite_invalidate) {
+  ResponseCache cache;
+  cache.setTtl(1000);
+  auto read = makeRequest(0x01, FunctionCode::kReadHoldingRegisters,
+                          {0x00, 0x10, 0x00, 0x04});
+  auto input = makeRequest(0x01, FunctionCode::kReadInputRegister,
+                           {0x00, 0x10, 0x00, 0x04});
+  auto response =
+      makeResponse(FunctionCode::kReadHoldingRegisters,
+                   {0x08, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04});
+  cache.store(read, response);
+  cache.store(input, response);
+
+  Response cached;
+  // another server, not overlapping, coils: nothing dropped
+  cache.invalidate(makeRequest(0x02, FunctionCode::kWriteSingleRegister,
+                               {0x00, 0x10, 0x00, 0x01}));
+  cache.invalidate(makeRequest(0x01, FunctionCode::kWriteSingleRegister,
+                               {0x00, 0x14, 0x00, 0x01}));
+  cache.invalidate(makeRequest(0x01, FunctionCode::kWriteSingleCoil,
+                               {0x00, 0x10, 0xff, 0x00}));
+  EXPECT_TRUE(cache.lookup(read, &cached));
+
+  cache.invalidate(makeRequest(0x01, FunctionCode::kWriteMultipleRegisters,
+                               {0x00, 0x0f, 0x00, 0x02, 0x04, 0x00, 0x00,
+                                0x00, 0x00}));
+  EXPECT_FALSE(cache.lookup(read, &cached));
+  // input registers can't be written
+  EXPECT_TRUE(cache.lookup(input, &cached));
+}
+
+TEST(ResponseCache, brocastWrite_invalidateAllServers) {
+  ResponseCache cache;
+  cache.setTtl(1000);
+  auto read = makeRequest(0x05, FunctionCode::kReadCoils,
+                          {0x00, 0x00, 0x00, 0x08});
+  cache.store(read, makeResponse(FunctionCode::kReadCoils, {0x01, 0xff}));
+
+  cache.invalidate(makeRequest(Adu::kBrocastAddress,
+                               FunctionCode::kWriteSingleCoil,
+                               {0x00, 0x07, 0xff, 0x00}));
+  Response cached;
+  EXPECT_FALSE(cache.lookup(read, &cached));
+}
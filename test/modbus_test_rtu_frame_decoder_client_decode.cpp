@@ -196,3 +196,203 @@ TEST(ModbusRtuFrameDecoder, decode_bad_funtioncode) {
   EXPECT_EQ(true, decoder.IsDone());
   EXPECT_EQ(Error::kIllegalFunctionCode, decoder.LasError());
 }
+
+TEST(ModbusRtuFrameDecoder, resync_noiseBeforeFrame_frameDecoded) {
+  pp::bytes::Buffer buffer;
+  /// noise, the tail of a broken frame, then a read coils response
+  buffer.Write(ByteArray({0xff, 0x00, 0x83, 0x12, 0x01, 0x03, 0x08}));
+  buffer.Write(ByteArray({0x01, 0x01, 0x01, 0x05, 0x91, 0x8b}));
+
+  Adu adu;
+  ModbusRtuFrameDecoder decoder(creatDefaultCheckSizeFuncTableForClient(),
+                                true);
+
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kNoError, decoder.LasError());
+  EXPECT_EQ(adu.serverAddress(), 0x01);
+  EXPECT_EQ(adu.functionCode(), 0x01);
+  EXPECT_THAT(adu.data(), ::testing::ElementsAre(0x01, 0x05));
+  EXPECT_EQ(decoder.skippedBytes(), 7U);
+  EXPECT_EQ(buffer.Len(), 0U);
+}
+
+TEST(ModbusRtuFrameDecoder, resync_frameInPieces_needMoreData) {
+  pp::bytes::Buffer buffer;
+  buffer.Write(ByteArray({0x01, 0x01, 0x01}));
+
+  Adu adu;
+  ModbusRtuFrameDecoder decoder(creatDefaultCheckSizeFuncTableForClient(),
+                                true);
+
+  decoder.Decode(buffer, &adu);
+  EXPECT_FALSE(decoder.IsDone());
+
+  buffer.Write(ByteArray({0x05, 0x91, 0x8b}));
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_THAT(adu.data(), ::testing::ElementsAre(0x01, 0x05));
+  EXPECT_EQ(decoder.skippedBytes(), 0U);
+}
+
+TEST(ModbusRtuFrameDecoder, resync_badLengthCandidate_laterFrameWins) {
+  pp::bytes::Buffer buffer;
+  /// a byte count of 0xf0 would wait for 240 more bytes
+  buffer.Write(ByteArray({0x01, 0x03, 0xf0, 0x00}));
+  buffer.Write(ByteArray({0x01, 0x83, 0x02, 0xc0, 0xf1}));
+
+  Adu adu;
+  ModbusRtuFrameDecoder decoder(creatDefaultCheckSizeFuncTableForClient(),
+                                true);
+
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kIllegalDataAddress, decoder.LasError());
+  EXPECT_EQ(adu.functionCode(), 0x03);
+  EXPECT_TRUE(adu.isException());
+  EXPECT_EQ(decoder.skippedBytes(), 4U);
+}
+
+TEST(ModbusRtuFrameDecoder, resync_byteByByte_frameAfterLongNoise) {
+  /// candidates with long byte counts, decoded one byte at a time
+  ByteArray stream;
+  for (int i = 0; i < 300; i++) {
+    stream.insert(stream.end(), {0x01, 0x03, 0xf0});
+  }
+  stream.insert(stream.end(), {0x01, 0x01, 0x01, 0x05, 0x91, 0x8b});
+
+  pp::bytes::Buffer buffer;
+  Adu adu;
+  ModbusRtuFrameDecoder decoder(creatDefaultCheckSizeFuncTableForClient(),
+                                true);
+  for (size_t i = 0; i < stream.size(); i++) {
+    EXPECT_FALSE(decoder.IsDone()) << i;
+    buffer.Write(ByteArray({stream[i]}));
+    decoder.Decode(buffer, &adu);
+  }
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kNoError, decoder.LasError());
+  EXPECT_THAT(adu.data(), ::testing::ElementsAre(0x01, 0x05));
+  EXPECT_EQ(decoder.skippedBytes(), 900U);
+  EXPECT_EQ(buffer.Len(), 0U);
+}
+
+TEST(ModbusRtuFrameDecoder, resync_interCharacterInSkippedBytes_noError) {
+  const ByteArray stream({0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x05,
+                          0x91, 0x8b});
+  Adu adu;
+
+  /// a silence longer than t1.5 in the noise before the frame
+  pp::bytes::Buffer buffer;
+  buffer.Write(stream);
+  ModbusRtuFrameDecoder decoder(creatDefaultCheckSizeFuncTableForClient(),
+                                true);
+  RtuSilenceGaps gaps;
+  gaps.size = stream.size();
+  gaps.interCharacter = 2;
+  decoder.Silence(buffer, 0, gaps);
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kNoError, decoder.LasError());
+
+  /// and in the frame itself
+  decoder.Clear();
+  buffer.Write(stream);
+  gaps.interCharacter = 6;
+  decoder.Silence(buffer, 0, gaps);
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kStorageParityError, decoder.LasError());
+}
+
+TEST(ModbusRtuFrameDecoder, silence_interFrame_dropsPartialFrame) {
+  pp::bytes::Buffer buffer;
+  /// a corrupt byte count of 0xf0 waits for 240 more bytes
+  buffer.Write(ByteArray({0x01, 0x03, 0xf0, 0x00}));
+
+  Adu adu;
+  ModbusRtuFrameDecoder decoder(creatDefaultCheckSizeFuncTableForClient());
+  decoder.Decode(buffer, &adu);
+  EXPECT_FALSE(decoder.IsDone());
+
+  /// the next frame after a silence longer than t3.5
+  const size_t offset = buffer.Len();
+  buffer.Write(ByteArray({0x01, 0x83, 0x02, 0xc0, 0xf1}));
+  RtuSilenceGaps gaps;
+  gaps.size = 5;
+  gaps.interFrame = 0;
+  decoder.Silence(buffer, offset, gaps);
+
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kIllegalDataAddress, decoder.LasError());
+  EXPECT_TRUE(adu.isException());
+  EXPECT_EQ(buffer.Len(), 0U);
+}
+
+TEST(ModbusRtuFrameDecoder, silence_interCharacter_invalidFrame) {
+  pp::bytes::Buffer buffer;
+  buffer.Write(ByteArray({0x01, 0x01, 0x01}));
+
+  Adu adu;
+  ModbusRtuFrameDecoder decoder(creatDefaultCheckSizeFuncTableForClient());
+  decoder.Decode(buffer, &adu);
+  EXPECT_FALSE(decoder.IsDone());
+
+  /// the rest of the frame after a silence longer than t1.5
+  const size_t offset = buffer.Len();
+  buffer.Write(ByteArray({0x05, 0x91, 0x8b}));
+  RtuSilenceGaps gaps;
+  gaps.size = 3;
+  gaps.interCharacter = 0;
+  decoder.Silence(buffer, offset, gaps);
+
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kStorageParityError, decoder.LasError());
+
+  /// the next frame is not affected
+  decoder.Clear();
+  buffer.Write(ByteArray({0x01, 0x01, 0x01, 0x05, 0x91, 0x8b}));
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kNoError, decoder.LasError());
+}
+
+TEST(ModbusRtuFrameDecoder, silence_interCharacterBeforeFrame_noError) {
+  pp::bytes::Buffer buffer;
+  buffer.Write(ByteArray({0x01, 0x01, 0x01, 0x05, 0x91, 0x8b}));
+
+  Adu adu;
+  ModbusRtuFrameDecoder decoder(creatDefaultCheckSizeFuncTableForClient(),
+                                true);
+  RtuSilenceGaps gaps;
+  gaps.size = 6;
+  gaps.interCharacter = 0;
+  decoder.Silence(buffer, 0, gaps);
+
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kNoError, decoder.LasError());
+  EXPECT_THAT(adu.data(), ::testing::ElementsAre(0x01, 0x05));
+}
+
+TEST(ModbusRtuFrameDecoder, server_decode_readWriteMultipleRegisters_request) {
+  /// read 1 register from 0, write 1 register(0x1234) to 0x10
+  const ByteArray frame = tool::appendCrc(ByteArray(
+      {0x01, 0x17, 0x00, 0x00, 0x00, 0x01, 0x00, 0x10, 0x00, 0x01, 0x02, 0x12,
+       0x34}));
+  pp::bytes::Buffer buffer;
+  buffer.Write(frame);
+
+  Adu adu;
+  ModbusRtuFrameDecoder decoder(creatDefaultCheckSizeFuncTableForServer());
+  decoder.Decode(buffer, &adu);
+  EXPECT_EQ(true, decoder.IsDone());
+  EXPECT_EQ(Error::kNoError, decoder.LasError());
+  EXPECT_EQ(adu.functionCode(), FunctionCode::kReadWriteMultipleRegisters);
+  EXPECT_THAT(adu.data(),
+              ::testing::ElementsAre(0x00, 0x00, 0x00, 0x01, 0x00, 0x10, 0x00,
+                                     0x01, 0x02, 0x12, 0x34));
+  EXPECT_EQ(buffer.Len(), 0U);
+}
@@ -0,0 +1,71 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <modbus/base/modbus_rtu_silence.h>
+
+using namespace testing;
+using namespace modbus;
+
+TEST(RtuSilence, silenceTimes) {
+  RtuSilence silence(9600);
+  EXPECT_EQ(silence.characterTime(), 1146);
+  EXPECT_EQ(silence.t1_5(), 1719);
+  EXPECT_EQ(silence.t3_5(), 4011);
+
+  /// fixed above 19200 baud
+  silence.setBaudRate(115200);
+  EXPECT_EQ(silence.characterTime(), 96);
+  EXPECT_EQ(silence.t1_5(), 750);
+  EXPECT_EQ(silence.t3_5(), 1750);
+}
+
+TEST(RtuSilence, unknownLine_noGap) {
+  RtuSilence silence(9600);
+  silence.received(100000, 4);
+  EXPECT_EQ(silence.lastSilence(), -1);
+  const RtuSilenceGaps gaps = silence.take();
+  EXPECT_TRUE(gaps.empty());
+  EXPECT_EQ(gaps.size, 4U);
+}
+
+TEST(RtuSilence, responseInChunks_gapsAndTurnaround) {
+  RtuSilence silence(9600);
+  const int64_t c = silence.characterTime();
+  /// a request of 8 bytes, on the line until 8 * c
+  silence.sent(0, 8);
+
+  /// 3 bytes starting 20ms after the request
+  int64_t t = 8 * c + 20000 + 3 * c;
+  silence.received(t, 3);
+  EXPECT_EQ(silence.turnaround(), 20000);
+  /// 2 bytes right after them
+  t += 2 * c;
+  silence.received(t, 2);
+  EXPECT_EQ(silence.lastSilence(), 0);
+  /// 1 byte after 2ms, longer than t1.5
+  t += 2000 + c;
+  silence.received(t, 1);
+  EXPECT_EQ(silence.lastSilence(), 2000);
+  EXPECT_EQ(silence.turnaround(), 20000);
+
+  RtuSilenceGaps gaps = silence.take();
+  EXPECT_EQ(gaps.size, 6U);
+  EXPECT_EQ(gaps.interFrame, 0U);
+  EXPECT_EQ(gaps.interCharacter, 5U);
+
+  gaps = silence.take();
+  EXPECT_TRUE(gaps.empty());
+  EXPECT_EQ(gaps.size, 0U);
+}
+
+TEST(RtuSilence, laterInterFrame_wins) {
+  RtuSilence silence(9600);
+  const int64_t c = silence.characterTime();
+  silence.received(0, 1);
+  silence.received(3000 + c, 1);
+  silence.received(3000 + c + 10000 + 2 * c, 2);
+
+  const RtuSilenceGaps gaps = silence.take();
+  EXPECT_EQ(gaps.size, 4U);
+  EXPECT_EQ(gaps.interFrame, 2U);
+  EXPECT_EQ(gaps.interCharacter, RtuSilenceGaps::kNone);
+}
@@ -4,6 +4,7 @@
 #include <QTest>
 #include <QTimer>
 #include <cstddef>
+#include <thread>
 #include <modbus/base/single_bit_access.h>
 #include <modbus/base/sixteen_bit_access.h>
 #include <modbus_frame.h>
@@ -1315,6 +1316,460 @@ TEST(ModbusClient, MbapBadTransactionId) {
   app.exec();
 }
 
+TEST(ModbusClient, sendPreparedRequest_mbap_onlyTransactionIdChanged) {
+  declare_app(app);
+  {
+    auto io = new MockSerialPort();
+    QModbusClient client(io);
+    client.setTransferMode(modbus::TransferMode::kMbap);
+
+    QSignalSpy spy(&client, &QModbusClient::readRegistersFinished);
+
+    std::vector<QByteArray> written;
+    EXPECT_CALL(*io, write(_, _))
+        .Times(2)
+        .WillRepeatedly(Invoke([&](const char *data, size_t size) {
+          written.push_back(QByteArray(data, size));
+          emit io->bytesWritten(size);
+          emit io->readyRead();
+        }));
+    EXPECT_CALL(*io, readAll()).WillRepeatedly(Invoke([&]() {
+      QByteArray response("\x00\x00\x00\x00\x00\x05\x01\x03\x02\x00\x01",
+                          11);
+      response[1] = static_cast<char>(written.size());
+      return response;
+    }));
+
+    client.open();
+    EXPECT_EQ(client.isOpened(), true);
+
+    auto prepared = client.prepareReadRegisters(
+        0x01, FunctionCode::kReadHoldingRegisters, Address(0), 1);
+    client.sendPreparedRequest(prepared);
+    client.sendPreparedRequest(prepared);
+
+    QTest::qWait(1000);
+    EXPECT_EQ(spy.count(), 2);
+    ASSERT_EQ(written.size(), 2U);
+    EXPECT_EQ(written[0], QByteArray("\x00\x01\x00\x00\x00\x06\x01\x03\x00"
+                                     "\x00\x00\x01",
+                                     12));
+    EXPECT_EQ(written[1].mid(2), written[0].mid(2));
+    EXPECT_EQ(written[1][1], 0x02);
+  }
+
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(ModbusClient, changeFilter_onlyChangesDelivered) {
+  declare_app(app);
+  {
+    auto io = new MockSerialPort();
+    QModbusClient client(io);
+    client.setTransferMode(modbus::TransferMode::kMbap);
+
+    QSignalSpy finishedSpy(&client, &QModbusClient::readRegistersFinished);
+    QSignalSpy changedSpy(&client, &QModbusClient::registersChanged);
+
+    int sent = 0;
+    EXPECT_CALL(*io, write(_, _))
+        .Times(3)
+        .WillRepeatedly(Invoke([&](const char *data, size_t size) {
+          sent++;
+          emit io->bytesWritten(size);
+          emit io->readyRead();
+        }));
+    EXPECT_CALL(*io, readAll()).WillRepeatedly(Invoke([&]() {
+      QByteArray response(
+          "\x00\x00\x00\x00\x00\x07\x01\x03\x04\x00\x01\x00\x02", 13);
+      response[1] = static_cast<char>(sent);
+      // the third response changed the second register
+      if (sent == 3) {
+        response[12] = 0x03;
+      }
+      return response;
+    }));
+
+    client.open();
+    EXPECT_EQ(client.isOpened(), true);
+
+    auto poll = client.prepareReadRegisters(
+        0x01, FunctionCode::kReadHoldingRegisters, Address(0x10), 2);
+    client.enableChangeFilter(poll);
+    client.sendPreparedRequest(poll);
+    client.sendPreparedRequest(poll);
+    client.sendPreparedRequest(poll);
+
+    QTest::qWait(1000);
+    EXPECT_EQ(finishedSpy.count(), 0);
+    ASSERT_EQ(changedSpy.count(), 2);
+    auto ranges = changedSpy.at(0).at(3).value<QVector<AddressRange>>();
+    EXPECT_EQ(ranges, QVector<AddressRange>({AddressRange(0x10, 2)}));
+    ranges = changedSpy.at(1).at(3).value<QVector<AddressRange>>();
+    EXPECT_EQ(ranges, QVector<AddressRange>({AddressRange(0x11, 1)}));
+  }
+
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(ModbusClient, changeFilter_plainReadOfPolledRangeNotFiltered) {
+  declare_app(app);
+  {
+    auto io = new MockSerialPort();
+    QModbusClient client(io);
+    client.setTransferMode(modbus::TransferMode::kMbap);
+
+    QSignalSpy finishedSpy(&client, &QModbusClient::readRegistersFinished);
+    QSignalSpy changedSpy(&client, &QModbusClient::registersChanged);
+
+    int sent = 0;
+    EXPECT_CALL(*io, write(_, _))
+        .Times(3)
+        .WillRepeatedly(Invoke([&](const char *data, size_t size) {
+          sent++;
+          emit io->bytesWritten(size);
+          emit io->readyRead();
+        }));
+    EXPECT_CALL(*io, readAll()).WillRepeatedly(Invoke([&]() {
+      QByteArray response(
+          "\x00\x00\x00\x00\x00\x07\x01\x03\x04\x00\x01\x00\x02", 13);
+      response[1] = static_cast<char>(sent);
+      return response;
+    }));
+
+    client.open();
+    EXPECT_EQ(client.isOpened(), true);
+
+    auto poll = client.prepareReadRegisters(
+        0x01, FunctionCode::kReadHoldingRegisters, Address(0x10), 2);
+    client.enableChangeFilter(poll);
+    client.sendPreparedRequest(poll);
+    /// the same range, but not the poll, so it is never diffed
+    client.readRegisters(0x01, FunctionCode::kReadHoldingRegisters,
+                         Address(0x10), 2);
+    client.sendPreparedRequest(poll);
+
+    QTest::qWait(1000);
+    EXPECT_EQ(changedSpy.count(), 1);
+    ASSERT_EQ(finishedSpy.count(), 1);
+    EXPECT_EQ(finishedSpy.at(0).at(4).value<ByteArray>(),
+              ByteArray({0x00, 0x01, 0x00, 0x02}));
+  }
+
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(ModbusClient, responseCache_duplicateReadServedFromCache) {
+  declare_app(app);
+  {
+    auto io = new MockSerialPort();
+    QModbusClient client(io);
+    client.setTransferMode(modbus::TransferMode::kMbap);
+    client.setResponseCacheTtl(10000);
+
+    QSignalSpy spy(&client, &QModbusClient::readRegistersFinished);
+
+    int sent = 0;
+    EXPECT_CALL(*io, write(_, _))
+        .Times(1)
+        .WillRepeatedly(Invoke([&](const char *data, size_t size) {
+          sent++;
+          emit io->bytesWritten(size);
+          emit io->readyRead();
+        }));
+    EXPECT_CALL(*io, readAll()).WillRepeatedly(Invoke([&]() {
+      QByteArray response("\x00\x00\x00\x00\x00\x05\x01\x03\x02\x00\x01",
+                          11);
+      response[1] = static_cast<char>(sent);
+      return response;
+    }));
+
+    client.open();
+    EXPECT_EQ(client.isOpened(), true);
+
+    client.readRegisters(0x01, FunctionCode::kReadHoldingRegisters, 0x00, 1);
+    QTest::qWait(500);
+    client.readRegisters(0x01, FunctionCode::kReadHoldingRegisters, 0x00, 1);
+    QTest::qWait(500);
+
+    EXPECT_EQ(spy.count(), 2);
+    EXPECT_EQ(client.responseCacheHits(), 1U);
+    EXPECT_EQ(client.responseCacheMisses(), 1U);
+  }
+
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(ModbusClient, singleFlight_identicalReadsSentOnce) {
+  declare_app(app);
+  {
+    auto io = new MockSerialPort();
+    QModbusClient client(io);
+    client.setTransferMode(modbus::TransferMode::kMbap);
+    client.enableSingleFlight(true);
+
+    QSignalSpy spy(&client, &QModbusClient::readRegistersFinished);
+
+    EXPECT_CALL(*io, write(_, _))
+        .Times(2)
+        .WillRepeatedly(Invoke([&](const char *data, size_t size) {
+          emit io->bytesWritten(size);
+          emit io->readyRead();
+        }));
+    int reads = 0;
+    EXPECT_CALL(*io, readAll()).WillRepeatedly(Invoke([&]() {
+      QByteArray response("\x00\x01\x00\x00\x00\x05\x01\x03\x02\x00\x01",
+                          11);
+      response[1] = static_cast<char>(++reads);
+      return response;
+    }));
+
+    client.open();
+    EXPECT_EQ(client.isOpened(), true);
+
+    client.readRegisters(0x01, FunctionCode::kReadHoldingRegisters, 0x00, 1);
+    client.readRegisters(0x01, FunctionCode::kReadHoldingRegisters, 0x00, 1);
+    client.readRegisters(0x01, FunctionCode::kReadHoldingRegisters, 0x00, 1);
+    client.readRegisters(0x01, FunctionCode::kReadHoldingRegisters, 0x01, 1);
+    EXPECT_EQ(client.pendingRequestSize(), 2U);
+
+    QTest::qWait(1000);
+    EXPECT_EQ(spy.count(), 4);
+  }
+
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(ModbusClient, writeCoalescing_pendingWritesMerged) {
+  declare_app(app);
+  {
+    auto io = new MockSerialPort();
+    QModbusClient client(io);
+    client.setTransferMode(modbus::TransferMode::kMbap);
+    client.enableWriteCoalescing(true);
+
+    QSignalSpy spy(&client, &QModbusClient::writeSingleRegisterFinished);
+
+    std::vector<QByteArray> written;
+    EXPECT_CALL(*io, write(_, _))
+        .Times(2)
+        .WillRepeatedly(Invoke([&](const char *data, size_t size) {
+          written.push_back(QByteArray(data, size));
+          emit io->bytesWritten(size);
+          emit io->readyRead();
+        }));
+    EXPECT_CALL(*io, readAll()).WillRepeatedly(Invoke([&]() -> QByteArray {
+      const QByteArray &request = written.back();
+      if (request[7] == 0x06) {
+        return request;
+      }
+      /// transaction id + mbap + server address + 0x10 + address + quantity
+      QByteArray response = request.left(12);
+      response[5] = 0x06;
+      return response;
+    }));
+
+    client.open();
+    EXPECT_EQ(client.isOpened(), true);
+
+    client.writeSingleRegister(0x01, 0x00, SixteenBitValue(10));
+    client.writeSingleRegister(0x01, 0x01, SixteenBitValue(11));
+    client.writeSingleRegister(0x01, 0x02, SixteenBitValue(12));
+    client.writeSingleRegister(0x01, 0x01, SixteenBitValue(13));
+    EXPECT_EQ(client.pendingRequestSize(), 2U);
+
+    QTest::qWait(1000);
+    ASSERT_EQ(written.size(), 2U);
+    EXPECT_EQ(written[1], QByteArray("\x00\x02\x00\x00\x00\x0b\x01\x10\x00"
+                                     "\x01\x00\x02\x04\x00\x0d\x00\x0c",
+                                     17));
+    ASSERT_EQ(spy.count(), 4);
+    for (int i = 0; i < spy.count(); i++) {
+      EXPECT_EQ(spy.at(i).at(2).value<Error>(), Error::kNoError);
+    }
+    EXPECT_EQ(spy.at(3).at(1).value<modbus::Address>(), 0x01);
+  }
+
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(ModbusClient, submitRequest_fromOtherThreads_completedThroughExecutor) {
+  declare_app(app);
+  {
+    auto io = new MockSerialPort();
+    QModbusClient client(io);
+    client.setTransferMode(modbus::TransferMode::kMbap);
+
+    QSignalSpy spy(&client, &QModbusClient::requestFinished);
+
+    QByteArray lastRequest;
+    EXPECT_CALL(*io, write(_, _))
+        .Times(4)
+        .WillRepeatedly(Invoke([&](const char *data, size_t size) {
+          lastRequest = QByteArray(data, size);
+          emit io->bytesWritten(size);
+          emit io->readyRead();
+        }));
+    EXPECT_CALL(*io, readAll()).WillRepeatedly(Invoke([&]() {
+      /// the register read is answered with its address
+      QByteArray response("\x00\x00\x00\x00\x00\x05\x01\x03\x02\x00\x00",
+                          11);
+      response[0] = lastRequest[0];
+      response[1] = lastRequest[1];
+      response[10] = lastRequest[9];
+      return response;
+    }));
+
+    client.open();
+    EXPECT_EQ(client.isOpened(), true);
+
+    /// the tasks run when the test says so, on its thread
+    std::vector<std::function<void()>> tasks;
+    const Executor executor = [&tasks](const std::function<void()> &task) {
+      tasks.push_back(task);
+    };
+    int direct = 0;
+    int executed = 0;
+    auto checker = [](int *count) {
+      return [count](const Request &request, const Response &response) {
+        EXPECT_EQ(response.error(), Error::kNoError);
+        EXPECT_THAT(response.data(),
+                    ElementsAre(0x02, 0x00, request.data()[1]));
+        (*count)++;
+      };
+    };
+    std::thread first([&]() {
+      for (uint8_t address = 0; address < 2; address++) {
+        client.submitRequest(Request(0x01, FunctionCode::kReadHoldingRegisters,
+                                     any(), {0x00, address, 0x00, 0x01}),
+                             checker(&direct));
+      }
+    });
+    std::thread second([&]() {
+      for (uint8_t address = 2; address < 4; address++) {
+        client.submitRequest(Request(0x01, FunctionCode::kReadHoldingRegisters,
+                                     any(), {0x00, address, 0x00, 0x01}),
+                             checker(&executed), executor);
+      }
+    });
+    first.join();
+    second.join();
+
+    QTest::qWait(1000);
+    EXPECT_EQ(spy.count(), 4);
+    EXPECT_EQ(direct, 2);
+    EXPECT_EQ(executed, 0);
+    ASSERT_EQ(tasks.size(), 2U);
+    for (auto &task : tasks) {
+      task();
+    }
+    EXPECT_EQ(executed, 2);
+  }
+
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(ModbusClient, submitRequest_clientIsClosed_completedWithTimeout) {
+  declare_app(app);
+  {
+    auto io = new MockSerialPort();
+    QModbusClient client(io);
+    EXPECT_CALL(*io, write(_, _)).Times(0);
+    EXPECT_EQ(client.isOpened(), false);
+
+    QSignalSpy spy(&client, &QModbusClient::requestFinished);
+    int completed = 0;
+    client.submitRequest(
+        Request(0x01, FunctionCode::kReadHoldingRegisters, any(),
+                {0x00, 0x00, 0x00, 0x01}),
+        [&](const Request &request, const Response &response) {
+          completed++;
+          EXPECT_EQ(response.error(), Error::kTimeout);
+          EXPECT_EQ(response.serverAddress(), request.serverAddress());
+          EXPECT_EQ(response.functionCode(),
+                    FunctionCode::kReadHoldingRegisters);
+        });
+
+    QTest::qWait(100);
+    EXPECT_EQ(completed, 1);
+    EXPECT_EQ(spy.count(), 0);
+    EXPECT_EQ(client.pendingRequestSize(), 0U);
+  }
+
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(ModbusClient, submitRequest_brocast_completedWithNoError) {
+  declare_app(app);
+  {
+    auto io = new MockSerialPort();
+    QModbusClient client(io);
+    EXPECT_CALL(*io, write(_, _))
+        .WillOnce(Invoke([&](const char * /*data*/, size_t size) {
+          emit io->bytesWritten(size);
+        }));
+    client.open();
+    EXPECT_EQ(client.isOpened(), true);
+
+    int completed = 0;
+    client.submitRequest(
+        Request(Adu::kBrocastAddress, FunctionCode::kWriteSingleRegister,
+                any(), {0x00, 0x01, 0x00, 0x01}),
+        [&](const Request & /*request*/, const Response &response) {
+          completed++;
+          EXPECT_EQ(response.error(), Error::kNoError);
+        });
+
+    QTest::qWait(100);
+    EXPECT_EQ(completed, 1);
+  }
+
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(ModbusClient, submitRequest_closedWhilePending_completedWithTimeout) {
+  declare_app(app);
+  {
+    auto io = new MockSerialPort();
+    QModbusClient client(io);
+    /// the request never leaves, it is pending when the client is closed
+    EXPECT_CALL(*io, write(_, _)).WillOnce(Return());
+    client.open();
+    EXPECT_EQ(client.isOpened(), true);
+
+    int completed = 0;
+    auto completion = [&](const Request & /*request*/,
+                          const Response &response) {
+      completed++;
+      EXPECT_EQ(response.error(), Error::kTimeout);
+    };
+    for (uint8_t address = 0; address < 2; address++) {
+      client.submitRequest(Request(0x01, FunctionCode::kReadHoldingRegisters,
+                                   any(), {0x00, address, 0x00, 0x01}),
+                           completion);
+    }
+    QTest::qWait(100);
+    EXPECT_EQ(client.pendingRequestSize(), 2U);
+
+    client.close();
+    QTest::qWait(100);
+    EXPECT_EQ(completed, 2);
+    EXPECT_EQ(client.pendingRequestSize(), 0U);
+  }
+
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
 template <TransferMode mode> static void createReadCoils(Session &session) {
   SingleBitAccess access;
 
@@ -0,0 +1,175 @@
+#include "modbus_test_mocker.h"
+#include <QSignalSpy>
+#include <QTest>
+#include <modbus/tools/modbus_serial_engine.h>
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace testing;
+using namespace modbus;
+
+#define declare_app(name)                                                      \
+  int argc = 1;                                                                \
+  char *argv[] = {(char *)"test"};                                             \
+  QCoreApplication name(argc, argv);
+
+/// the master side of a pty pair, the engine opens the slave side
+class PtyMaster {
+public:
+  PtyMaster() {
+    fd_ = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd_ >= 0 && grantpt(fd_) == 0 && unlockpt(fd_) == 0) {
+      slaveName_ = ptsname(fd_);
+    }
+  }
+  ~PtyMaster() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  bool isValid() const { return !slaveName_.empty(); }
+  const std::string &slaveName() const { return slaveName_; }
+
+  void write(const ByteArray &data) {
+    ASSERT_EQ(::write(fd_, data.data(), data.size()),
+              static_cast<ssize_t>(data.size()));
+  }
+
+  /// the bytes the engine wrote, waiting up to 5s for size of them
+  ByteArray read(size_t size) {
+    ByteArray data;
+    for (int i = 0; i < 500 && data.size() < size; i++) {
+      uint8_t buffer[256];
+      const ssize_t n = ::read(fd_, buffer, sizeof(buffer));
+      if (n > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+        continue;
+      }
+      QTest::qWait(10);
+    }
+    return data;
+  }
+
+private:
+  int fd_ = -1;
+  std::string slaveName_;
+};
+
+static SerialEnginePort enginePort(const PtyMaster &master) {
+  SerialEnginePort port;
+  port.portName = master.slaveName();
+  port.termios.baudRate = 115200;
+  port.termios.lowLatency = false;
+  port.waitResponseTimeout = 200;
+  return port;
+}
+
+static Request readRegister(uint8_t start) {
+  return Request(1, FunctionCode::kReadHoldingRegisters, any(),
+                 {0x00, start, 0x00, 0x01});
+}
+
+TEST(SerialEngine, addPort_notFound_failed) {
+  SerialEngine engine(1);
+  SerialEnginePort port;
+  port.portName = "/dev/modbus-no-such-port";
+  EXPECT_EQ(engine.addPort(port), -1);
+  EXPECT_FALSE(engine.errorString().isEmpty());
+  EXPECT_EQ(engine.portCount(), 0);
+  EXPECT_FALSE(engine.sendRequest(0, readRegister(0)));
+}
+
+TEST(SerialEngine, addPort_balancedAcrossThreads) {
+  PtyMaster masters[4];
+  SerialEngine engine(2);
+  EXPECT_EQ(engine.threadCount(), 2);
+  int ports[2] = {0, 0};
+  for (auto &master : masters) {
+    ASSERT_TRUE(master.isValid());
+    const SerialEngine::PortId id = engine.addPort(enginePort(master));
+    ASSERT_GE(id, 0);
+    ports[engine.threadOf(id)]++;
+  }
+  EXPECT_EQ(engine.portCount(), 4);
+  EXPECT_EQ(ports[0], 2);
+  EXPECT_EQ(ports[1], 2);
+}
+
+TEST(SerialEngine, sendRequest_manyPorts_requestFinished) {
+  declare_app(app);
+  PtyMaster masters[3];
+  {
+    SerialEngine engine(2);
+    for (auto &master : masters) {
+      ASSERT_TRUE(master.isValid());
+      ASSERT_GE(engine.addPort(enginePort(master)), 0);
+    }
+    QSignalSpy spy(&engine, &SerialEngine::requestFinished);
+    /// sent from other threads, finished on this one
+    std::thread sender([&engine]() {
+      for (int port = 0; port < 3; port++) {
+        engine.sendRequest(port, readRegister(static_cast<uint8_t>(port)));
+      }
+    });
+    sender.join();
+
+    for (int port = 0; port < 3; port++) {
+      const ByteArray request(
+          {0x01, 0x03, 0x00, static_cast<uint8_t>(port), 0x00, 0x01});
+      EXPECT_EQ(masters[port].read(8), tool::appendCrc(request));
+      masters[port].write(tool::appendCrc(
+          ByteArray({0x01, 0x03, 0x02, 0x00, static_cast<uint8_t>(port)})));
+    }
+    for (int i = 0; i < 50 && spy.count() < 3; i++) {
+      spy.wait(100);
+    }
+
+    ASSERT_EQ(spy.count(), 3);
+    for (int i = 0; i < 3; i++) {
+      const int port = spy.at(i).at(0).toInt();
+      const Response response = qvariant_cast<Response>(spy.at(i).at(2));
+      EXPECT_EQ(response.error(), Error::kNoError);
+      EXPECT_THAT(response.data(), ElementsAre(0x02, 0x00, port));
+    }
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(SerialEngine, sendRequest_noResponse_timeoutAfterRetry) {
+  declare_app(app);
+  PtyMaster master;
+  ASSERT_TRUE(master.isValid());
+  {
+    SerialEngine engine(1);
+    SerialEnginePort port = enginePort(master);
+    port.waitResponseTimeout = 50;
+    port.retryTimes = 1;
+    const SerialEngine::PortId id = engine.addPort(port);
+    ASSERT_GE(id, 0);
+
+    QSignalSpy spy(&engine, &SerialEngine::requestFinished);
+    engine.sendRequest(id, readRegister(0));
+    /// sent twice
+    EXPECT_EQ(master.read(16).size(), 16U);
+    if (spy.count() == 0) {
+      spy.wait(5000);
+    }
+
+    ASSERT_EQ(spy.count(), 1);
+    const Response response = qvariant_cast<Response>(spy.at(0).at(2));
+    EXPECT_EQ(response.error(), Error::kTimeout);
+    EXPECT_EQ(response.serverAddress(), 1);
+    EXPECT_EQ(response.functionCode(), FunctionCode::kReadHoldingRegisters);
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+#endif // __linux__
@@ -3,6 +3,7 @@
 #include "modbus_frame.h"
 #include "modbusserver_client_session.h"
 #include "gmock/gmock-spec-builders.h"
+#include <QDir>
 #include <QObject>
 #include <QScopedPointer>
 #include <QSignalSpy>
@@ -154,6 +155,42 @@ TEST(
   session.handleModbusRequest(requestBuffer);
 }
 
+TEST(QModbusServer, recivedRequest_unknownFunctionCode_rawRequestHandler) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  d.setServer(&server);
+  d.setServerAddress(1);
+  d.setTransferMode(TransferMode::kMbap);
+  d.rawRequestHandler_ = [](ServerAddress serverAddress,
+                            FunctionCode functionCode, const ByteArray &data,
+                            ByteArray *response) {
+    EXPECT_EQ(serverAddress, 1);
+    EXPECT_EQ(functionCode, 0x2b);
+    EXPECT_EQ(data, ByteArray({0x0e, 0x01, 0x00}));
+    *response = ByteArray({0x0e, 0x01, 0x01, 0x00, 0x00, 0x00});
+    return Error::kNoError;
+  };
+
+  /// 0x2b has no size function, the request is framed by the mbap length
+  pp::bytes::Buffer requestBuffer;
+  requestBuffer.Write("\x00\x07\x00\x00\x00\x05\x01\x2b\x0e\x01\x00", 11);
+
+  auto *mockConn = new TestConnection();
+  ClientSession session(&d, mockConn,
+                        creatDefaultCheckSizeFuncTableForServer());
+
+  ByteArray written;
+  EXPECT_CALL(*mockConn, write)
+      .WillOnce(Invoke([&](const char *data, size_t size) {
+        written.assign(data, data + size);
+      }));
+  session.handleModbusRequest(requestBuffer);
+  EXPECT_EQ(written, ByteArray({0x00, 0x07, 0x00, 0x00, 0x00, 0x08, 0x01, 0x2b,
+                                0x0e, 0x01, 0x01, 0x00, 0x00, 0x00}));
+}
+
 TEST(QModbusServer, processReadCoils_success) {
   TestServer server;
   QModbusServer modbusServer(&server);
@@ -342,6 +379,136 @@ TEST(QModbusServer, processWriteMultipleCoils_success) {
   EXPECT_EQ(response.data(), ByteArray({0x00, 0x00, 0x00, 0x09}));
 }
 
+TEST(QModbusServer, processWriteMultipleCoils_perAddressRequestsWhenConnected) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  std::vector<ByteArray> requested;
+  QObject::connect(
+      &modbusServer, &QModbusServer::writeMultipleCoilsRequested,
+      [&](modbus::Address startAddress, const ByteArray &values) {
+        EXPECT_EQ(startAddress, 0x00);
+        requested.push_back(values);
+      });
+  QSignalSpy spy2(&modbusServer, &QModbusServer::writeCoilsRequested);
+
+  d.setServerAddress(1);
+  d.setTransferMode(TransferMode::kRtu);
+
+  d.handleCoils(0x00, 0x10);
+
+  Adu request;
+  Adu response;
+
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kWriteMultipleCoils);
+  request.setData(ByteArray({0x00, 0x00, 0x00, 0x09, 0x02, 0xfe, 0x01}));
+
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kNoError);
+  ASSERT_EQ(requested.size(), 1u);
+  EXPECT_EQ(requested[0],
+            ByteArray({0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01}));
+  /// the per-address requests are kept, applications write the coils there
+  EXPECT_EQ(spy2.count(), 9);
+}
+
+TEST(QModbusServer, processWriteMultipleCoils_disconnectedPerAddressSkipped) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  int requested = 0;
+  int perAddress = 0;
+  QObject::connect(&modbusServer, &QModbusServer::writeMultipleCoilsRequested,
+                   [&](modbus::Address, const ByteArray &) { requested++; });
+  auto connection = QObject::connect(
+      &modbusServer, &QModbusServer::writeCoilsRequested,
+      [&](modbus::Address, bool) { perAddress++; });
+
+  d.setServerAddress(1);
+  d.setTransferMode(TransferMode::kRtu);
+  d.handleCoils(0x00, 0x10);
+
+  Adu request;
+  Adu response;
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kWriteMultipleCoils);
+  request.setData(ByteArray({0x00, 0x00, 0x00, 0x09, 0x02, 0xfe, 0x01}));
+
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kNoError);
+  EXPECT_EQ(perAddress, 9);
+
+  QObject::disconnect(connection);
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kNoError);
+  EXPECT_EQ(requested, 2);
+  EXPECT_EQ(perAddress, 9);
+}
+
+TEST(QModbusServer, writeCoils_valueChangedOnlyWithPerAddressSignals) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  QSignalSpy spy(&modbusServer, &QModbusServer::coilsValueChanged);
+  int changed = 0;
+  QObject::connect(&modbusServer, &QModbusServer::coilsChanged,
+                   [&](const QVector<AddressRange> &) { changed++; });
+
+  d.handleCoils(0x00, 0x10);
+  d.writeCoils(0x01, true);
+  EXPECT_EQ(spy.count(), 0);
+  EXPECT_EQ(changed, 1);
+
+  d.enablePerAddressSignals(true);
+  d.writeCoils(0x02, true);
+  EXPECT_EQ(spy.count(), 1);
+  EXPECT_EQ(changed, 2);
+}
+
+TEST(QModbusServer, processWriteMultipleCoils_writtenBack_validatedOnce) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  int calls = 0;
+  d.setCanWriteSingleBitRangeFunc(
+      [&](StorageKind kind, modbus::Address startAddress,
+          const ByteArray &values) {
+        calls++;
+        return Error::kNoError;
+      });
+  /// the application writes the coils the way the master asked
+  QObject::connect(&modbusServer, &QModbusServer::writeCoilsRequested,
+                   [&](modbus::Address address, bool value) {
+                     EXPECT_EQ(d.writeCoils(address, value), Error::kNoError);
+                   });
+
+  d.setServerAddress(1);
+  d.setTransferMode(TransferMode::kRtu);
+  d.handleCoils(0x00, 0x10);
+
+  Adu request;
+  Adu response;
+
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kWriteMultipleCoils);
+  request.setData(ByteArray({0x00, 0x00, 0x00, 0x09, 0x02, 0xfe, 0x01}));
+
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kNoError);
+  EXPECT_EQ(calls, 1);
+  EXPECT_FALSE(d.coilsValue(0x00));
+  EXPECT_TRUE(d.coilsValue(0x08));
+
+  /// a local write is validated on its own
+  d.writeCoils(0x0a, true);
+  EXPECT_EQ(calls, 2);
+}
+
 TEST(QModbusServer, processWriteMultipleCoils_failed) {
   TestServer server;
   QModbusServer modbusServer(&server);
@@ -526,6 +693,50 @@ TEST(QModbusServer, processWriteSingleRegister_badValue_failed) {
   EXPECT_EQ(response.data(), ByteArray({0x03}));
 }
 
+TEST(QModbusServer, processWriteMultipleRegisters_rangeCheckedOnce) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  int calls = 0;
+  d.setCanWriteSixteenBitRangeFunc([&](StorageKind kind,
+                                       modbus::Address startAddress,
+                                       const ByteArray &values) {
+    calls++;
+    EXPECT_EQ(kind, StorageKind::kHoldingRegisters);
+    EXPECT_EQ(startAddress, 0x02);
+    EXPECT_EQ(values, ByteArray({0x00, 0x01, 0x00, 0x02, 0x00, 0x03}));
+    return Error::kNoError;
+  });
+
+  d.setServerAddress(1);
+  d.setTransferMode(TransferMode::kRtu);
+  d.handleHoldingRegisters(0x00, 0x10);
+
+  Adu request;
+  Adu response;
+
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kWriteMultipleRegisters);
+  request.setData(ByteArray(
+      {0x00, 0x02, 0x00, 0x03, 0x06, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03}));
+
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kNoError);
+  EXPECT_EQ(calls, 1);
+
+  /// the per-value form is adapted
+  d.setCanWriteSixteenBitValueFunc(
+      [&](modbus::Address address, const SixteenBitValue &value) {
+        calls++;
+        return value.toUint16() == 0x02 ? Error::kIllegalDataValue
+                                        : Error::kNoError;
+      });
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kIllegalDataValue);
+  EXPECT_EQ(calls, 3);
+}
+
 TEST(QModbusServer, processWriteMultipleRegisters_success) {
   TestServer server;
   QModbusServer modbusServer(&server);
@@ -558,6 +769,496 @@ TEST(QModbusServer, processWriteMultipleRegisters_success) {
   EXPECT_EQ(spy2.count(), 1);
 }
 
+TEST(QModbusServer, writeHodingRegisters_changedRangesMerged) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  std::vector<QVector<AddressRange>> changed;
+  QObject::connect(&modbusServer, &QModbusServer::holdingRegistersChanged,
+                   [&](const QVector<AddressRange> &ranges) {
+                     changed.push_back(ranges);
+                   });
+
+  d.handleHoldingRegisters(0x00, 0x10);
+  d.writeHodingRegisters(0x00, {SixteenBitValue(0x01), SixteenBitValue(0x02),
+                                SixteenBitValue(0x03)});
+  ASSERT_EQ(changed.size(), 1u);
+  EXPECT_EQ(changed[0], QVector<AddressRange>({AddressRange(0x00, 3)}));
+
+  /// unchanged values are not reported
+  d.writeHodingRegisters(0x00, {SixteenBitValue(0x01)});
+  EXPECT_EQ(changed.size(), 1u);
+
+  /// collected until the next tick
+  d.setChangeNotifyInterval(100);
+  d.writeHodingRegisters(0x03, {SixteenBitValue(0x04)});
+  d.writeHodingRegisters(0x04, {SixteenBitValue(0x05)});
+  d.writeHodingRegisters(0x08, {SixteenBitValue(0x06)});
+  EXPECT_EQ(changed.size(), 1u);
+  d.flushChanges();
+  ASSERT_EQ(changed.size(), 2u);
+  EXPECT_EQ(changed[1], QVector<AddressRange>({AddressRange(0x03, 2),
+                                               AddressRange(0x08, 1)}));
+}
+
+TEST(QModbusServer, mapRegisters_createdThenAttached) {
+  const QString fileName = QDir::tempPath() + "/modbus_test_holding.regs";
+  QFile::remove(fileName);
+
+  {
+    TestServer server;
+    QModbusServer modbusServer(&server);
+    QModbusServerPrivate d(&modbusServer);
+
+    /// only handled register tables can be mapped
+    EXPECT_FALSE(d.mapRegisters(StorageKind::kHoldingRegisters, fileName));
+    EXPECT_FALSE(d.mapRegisters(StorageKind::kCoils, fileName));
+
+    d.handleHoldingRegisters(0x100, 100);
+    d.writeHodingRegisters(0x105, {SixteenBitValue(0x1234)});
+    /// a new file gets the current values
+    ASSERT_TRUE(d.mapRegisters(StorageKind::kHoldingRegisters, fileName));
+    SixteenBitValue value;
+    EXPECT_TRUE(d.holdingRegisterValue(0x105, &value));
+    EXPECT_EQ(value.toUint16(), 0x1234);
+  }
+
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+  d.handleHoldingRegisters(0x100, 100);
+  /// an existing file keeps its values
+  ASSERT_TRUE(d.mapRegisters(StorageKind::kHoldingRegisters, fileName));
+  SixteenBitValue value;
+  EXPECT_TRUE(d.holdingRegisterValue(0x105, &value));
+  EXPECT_EQ(value.toUint16(), 0x1234);
+  QFile::remove(fileName);
+}
+
+TEST(QModbusServer, mapRegisters_layoutMismatch_failed) {
+  const QString fileName = QDir::tempPath() + "/modbus_test_holding.regs";
+  QFile::remove(fileName);
+
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+  d.handleHoldingRegisters(0x100, 100);
+  ASSERT_TRUE(d.mapRegisters(StorageKind::kHoldingRegisters, fileName));
+
+  TestServer server2;
+  QModbusServer modbusServer2(&server2);
+  QModbusServerPrivate d2(&modbusServer2);
+  d2.handleHoldingRegisters(0x100, 101);
+  EXPECT_FALSE(d2.mapRegisters(StorageKind::kHoldingRegisters, fileName));
+  d2.handleHoldingRegisters(0x101, 100);
+  EXPECT_FALSE(d2.mapRegisters(StorageKind::kHoldingRegisters, fileName));
+  QFile::remove(fileName);
+}
+
+TEST(QModbusServer, mapRegisters_readServedFromMapping) {
+  const QString fileName = QDir::tempPath() + "/modbus_test_input.regs";
+  QFile::remove(fileName);
+
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+  d.setServerAddress(1);
+  d.handleInputRegisters(0x00, 0x10);
+  ASSERT_TRUE(d.mapRegisters(StorageKind::kInputRegisters, fileName));
+
+  /// a producer writes the file in place
+  QFile file(fileName);
+  ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+  SharedRegisters producer;
+  ASSERT_TRUE(producer.attach(file.map(0, file.size()), file.size()));
+  producer.setValue(0x02, 0xABCD);
+
+  Adu request;
+  Adu response;
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kReadInputRegister);
+  request.setData(ByteArray({0x00, 0x01, 0x00, 0x02}));
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kNoError);
+  EXPECT_EQ(response.data(), ByteArray({0x04, 0x00, 0x00, 0xAB, 0xCD}));
+  QFile::remove(fileName);
+}
+
+TEST(QModbusServer, mapRegisters_writesLandInMapping) {
+  const QString fileName = QDir::tempPath() + "/modbus_test_holding.regs";
+  QFile::remove(fileName);
+
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+  d.setServerAddress(1);
+  d.handleHoldingRegisters(0x00, 0x10);
+  ASSERT_TRUE(d.mapRegisters(StorageKind::kHoldingRegisters, fileName));
+
+  QFile file(fileName);
+  ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+  SharedRegisters producer;
+  ASSERT_TRUE(producer.attach(file.map(0, file.size()), file.size()));
+
+  QSignalSpy spy(&modbusServer, &QModbusServer::holdingRegisterValueChanged);
+  d.writeHodingRegisters(0x03, {SixteenBitValue(0x0012)});
+  EXPECT_EQ(producer.value(0x03), 0x0012);
+  EXPECT_EQ(spy.count(), 1);
+
+  /// 0x16 reads and writes the mapping
+  Adu request;
+  Adu response;
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kMaskWriteRegister);
+  request.setData(ByteArray({0x00, 0x03, 0x00, 0xF2, 0x00, 0x25}));
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kNoError);
+  EXPECT_EQ(producer.value(0x03), 0x0017);
+  EXPECT_EQ(spy.count(), 2);
+
+  /// the same value again is no change
+  d.writeHodingRegisters(0x03, {SixteenBitValue(0x0017)});
+  EXPECT_EQ(spy.count(), 2);
+  QFile::remove(fileName);
+}
+
+TEST(QModbusServer, mapRegisters_blockLeftLocked_slaveDeviceBusy) {
+  const QString fileName = QDir::tempPath() + "/modbus_test_locked.regs";
+  QFile::remove(fileName);
+
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+  d.setServerAddress(1);
+  d.handleHoldingRegisters(0x00, 0x10);
+  ASSERT_TRUE(d.mapRegisters(StorageKind::kHoldingRegisters, fileName));
+
+  /// a producer died in the middle of a write, the block stays locked
+  QFile file(fileName);
+  ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+  uchar *memory = file.map(0, file.size());
+  ASSERT_TRUE(memory);
+  reinterpret_cast<std::atomic<uint32_t> *>(
+      memory + SharedRegisters::kHeaderSize)
+      ->fetch_add(1);
+
+  Adu request;
+  Adu response;
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kReadHoldingRegisters);
+  request.setData(ByteArray({0x00, 0x00, 0x00, 0x02}));
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kSlaveDeviceBusy);
+
+  request.setFunctionCode(FunctionCode::kMaskWriteRegister);
+  request.setData(ByteArray({0x00, 0x03, 0x00, 0xF2, 0x00, 0x25}));
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kSlaveDeviceBusy);
+  QFile::remove(fileName);
+}
+
+TEST(QModbusServer, snapshot_restoredAfterRestart) {
+  const QString fileName = QDir::tempPath() + "/modbus_test_snapshot.bin";
+  QFile::remove(fileName);
+
+  {
+    TestServer server;
+    QModbusServer modbusServer(&server);
+    QModbusServerPrivate d(&modbusServer);
+
+    d.handleCoils(0x00, 0x20);
+    d.handleHoldingRegisters(0x100, 3000);
+    ASSERT_TRUE(d.enableSnapshot(fileName, 1000));
+
+    d.writeHodingRegisters(0x100 + 2999, {SixteenBitValue(0x1234)});
+    SingleBitAccess access;
+    access.setStartAddress(0x03);
+    access.setQuantity(1);
+    access.setValue(true);
+    d.writeCoilsInternal(StorageKind::kCoils, &d.coils_, &access);
+    /// the last changes are saved when the server is destroyed
+  }
+
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+  d.handleCoils(0x00, 0x20);
+  d.handleHoldingRegisters(0x100, 3000);
+  ASSERT_TRUE(d.enableSnapshot(fileName, 1000));
+
+  SixteenBitValue value;
+  EXPECT_TRUE(d.holdingRegisterValue(0x100 + 2999, &value));
+  EXPECT_EQ(value.toUint16(), 0x1234);
+  EXPECT_TRUE(d.coilsValue(0x03));
+  EXPECT_FALSE(d.coilsValue(0x04));
+
+  Adu request;
+  Adu response;
+  d.setServerAddress(1);
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kReadHoldingRegisters);
+  request.setData(ByteArray({0x0C, 0xB6, 0x00, 0x02}));
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.data(), ByteArray({0x04, 0x00, 0x00, 0x12, 0x34}));
+  QFile::remove(fileName);
+}
+
+TEST(QModbusServer, snapshot_savesWritesOfOtherProcesses) {
+  const QString fileName = QDir::tempPath() + "/modbus_test_snapshot.bin";
+  const QString regsName = QDir::tempPath() + "/modbus_test_holding.regs";
+  QFile::remove(fileName);
+  QFile::remove(regsName);
+
+  {
+    TestServer server;
+    QModbusServer modbusServer(&server);
+    QModbusServerPrivate d(&modbusServer);
+
+    d.handleHoldingRegisters(0x00, 200);
+    ASSERT_TRUE(d.mapRegisters(StorageKind::kHoldingRegisters, regsName));
+    ASSERT_TRUE(d.enableSnapshot(fileName, 1000));
+
+    /// a producer writes the mapping, the server knows nothing of it
+    QFile file(regsName);
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+    SharedRegisters producer;
+    ASSERT_TRUE(producer.attach(file.map(0, file.size()), file.size()));
+    producer.setValue(150, 0x4242);
+    d.saveSnapshot();
+  }
+
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+  d.handleHoldingRegisters(0x00, 200);
+  ASSERT_TRUE(d.enableSnapshot(fileName, 1000));
+
+  SixteenBitValue value;
+  EXPECT_TRUE(d.holdingRegisterValue(150, &value));
+  EXPECT_EQ(value.toUint16(), 0x4242);
+  QFile::remove(fileName);
+  QFile::remove(regsName);
+}
+
+TEST(QModbusServer, snapshot_onlySameRangeUnmappedTablesRestored) {
+  const QString fileName = QDir::tempPath() + "/modbus_test_snapshot.bin";
+  const QString regsName = QDir::tempPath() + "/modbus_test_input.regs";
+  QFile::remove(fileName);
+  QFile::remove(regsName);
+
+  {
+    TestServer server;
+    QModbusServer modbusServer(&server);
+    QModbusServerPrivate d(&modbusServer);
+
+    d.handleCoils(0x00, 0x20);
+    d.handleHoldingRegisters(0x00, 10);
+    d.handleInputRegisters(0x00, 10);
+    d.writeHodingRegisters(0x02, {SixteenBitValue(0x1111)});
+    d.writeInputRegisters(0x02, {SixteenBitValue(0x2222)});
+    SingleBitAccess access;
+    access.setStartAddress(0x03);
+    access.setQuantity(1);
+    access.setValue(true);
+    d.writeCoilsInternal(StorageKind::kCoils, &d.coils_, &access);
+    ASSERT_TRUE(d.enableSnapshot(fileName, 1000));
+  }
+
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+  /// the application moved the coils
+  d.handleCoils(0x10, 0x20);
+  d.handleHoldingRegisters(0x00, 10);
+  d.handleInputRegisters(0x00, 10);
+  d.writeInputRegisters(0x02, {SixteenBitValue(0x3333)});
+  ASSERT_TRUE(d.mapRegisters(StorageKind::kInputRegisters, regsName));
+  ASSERT_TRUE(d.enableSnapshot(fileName, 1000));
+
+  EXPECT_EQ(d.coils_.startAddress(), 0x10);
+  EXPECT_EQ(d.coils_.quantity(), 0x20u);
+  EXPECT_FALSE(d.coilsValue(0x13));
+  SixteenBitValue value;
+  EXPECT_TRUE(d.holdingRegisterValue(0x02, &value));
+  EXPECT_EQ(value.toUint16(), 0x1111);
+  /// the mapping is not overwritten by the snapshot
+  EXPECT_TRUE(d.inputRegisterValue(0x02, &value));
+  EXPECT_EQ(value.toUint16(), 0x3333);
+  QFile::remove(fileName);
+  QFile::remove(regsName);
+}
+
+TEST(QModbusServer, processMaskWriteRegister_success) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  d.setServerAddress(1);
+  d.setTransferMode(TransferMode::kRtu);
+
+  d.handleHoldingRegisters(0x00, 0x10);
+  d.writeHodingRegisters(0x04, {SixteenBitValue(0x0012)});
+
+  QSignalSpy spy(&modbusServer, &QModbusServer::holdingRegisterValueChanged);
+
+  Adu request;
+  Adu response;
+
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kMaskWriteRegister);
+  request.setData(ByteArray({0x00, 0x04, 0x00, 0xF2, 0x00, 0x25}));
+
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kNoError);
+  EXPECT_EQ(response.isException(), false);
+  EXPECT_EQ(response.data(), ByteArray({0x00, 0x04, 0x00, 0xF2, 0x00, 0x25}));
+  EXPECT_EQ(spy.count(), 1);
+
+  SixteenBitValue value;
+  EXPECT_TRUE(d.holdingRegisterValue(0x04, &value));
+  EXPECT_EQ(value.toUint16(), 0x0017);
+}
+
+TEST(QModbusServer, processReadWriteMultipleRegisters_writeBeforeRead) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  d.setServerAddress(1);
+  d.setTransferMode(TransferMode::kRtu);
+
+  d.handleHoldingRegisters(0x00, 0x10);
+  d.writeHodingRegisters(0x00, {SixteenBitValue(0x1234)});
+  d.writeHodingRegisters(0x01, {SixteenBitValue(0x5678)});
+  d.writeHodingRegisters(0x02, {SixteenBitValue(0x9876)});
+
+  /// the application writes the requested values back
+  QObject::connect(&modbusServer, &QModbusServer::writeHodingRegistersRequested,
+                   [&](modbus::Address address, const ByteArray &values) {
+                     QVector<SixteenBitValue> setValues;
+                     for (size_t i = 0; i + 1 < values.size(); i += 2) {
+                       setValues.push_back(
+                           SixteenBitValue(values[i], values[i + 1]));
+                     }
+                     d.writeHodingRegisters(address, setValues);
+                   });
+  QSignalSpy spy(&modbusServer, &QModbusServer::holdingRegisterValueChanged);
+
+  Adu request;
+  Adu response;
+
+  /// read 0x00-0x02, write 0x01-0x02
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kReadWriteMultipleRegisters);
+  request.setData(ByteArray({0x00, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x02,
+                             0x04, 0x00, 0x0A, 0x00, 0x0B}));
+
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kNoError);
+  EXPECT_EQ(response.isException(), false);
+  EXPECT_EQ(response.data(),
+            ByteArray({0x06, 0x12, 0x34, 0x00, 0x0A, 0x00, 0x0B}));
+  EXPECT_EQ(spy.count(), 1);
+}
+
+TEST(QModbusServer, processReadWriteMultipleRegisters_writeRequested) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  d.setServerAddress(1);
+  d.setTransferMode(TransferMode::kRtu);
+
+  d.handleHoldingRegisters(0x00, 0x10);
+  d.writeHodingRegisters(0x01, {SixteenBitValue(0x5678)});
+
+  int calls = 0;
+  d.setCanWriteSixteenBitRangeFunc([&](StorageKind kind,
+                                       modbus::Address startAddress,
+                                       const ByteArray &values) {
+    calls++;
+    return Error::kNoError;
+  });
+  std::vector<std::pair<modbus::Address, ByteArray>> requested;
+  QObject::connect(&modbusServer, &QModbusServer::writeHodingRegistersRequested,
+                   [&](modbus::Address address, const ByteArray &values) {
+                     requested.push_back({address, values});
+                   });
+  QSignalSpy spy(&modbusServer, &QModbusServer::holdingRegisterValueChanged);
+
+  Adu request;
+  Adu response;
+
+  /// read 0x01, write 0x01, nobody writes the requested value back
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kReadWriteMultipleRegisters);
+  request.setData(ByteArray({0x00, 0x01, 0x00, 0x01, 0x00, 0x01, 0x00, 0x01,
+                             0x02, 0x00, 0x0A}));
+
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kNoError);
+  EXPECT_EQ(response.data(), ByteArray({0x02, 0x56, 0x78}));
+  EXPECT_EQ(calls, 1);
+  ASSERT_EQ(requested.size(), 1u);
+  EXPECT_EQ(requested[0].first, 0x01);
+  EXPECT_EQ(requested[0].second, ByteArray({0x00, 0x0A}));
+  EXPECT_EQ(spy.count(), 0);
+}
+
+TEST(QModbusServer, processReadWriteMultipleRegisters_badAddress_failed) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  d.setServerAddress(1);
+  d.setTransferMode(TransferMode::kRtu);
+
+  d.handleHoldingRegisters(0x00, 0x10);
+  d.writeHodingRegisters(0x01, {SixteenBitValue(0x5678)});
+
+  Adu request;
+  Adu response;
+
+  /// the read range is out of the storage, nothing is written
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kReadWriteMultipleRegisters);
+  request.setData(ByteArray({0x00, 0x0F, 0x00, 0x02, 0x00, 0x01, 0x00, 0x01,
+                             0x02, 0x00, 0x0A}));
+
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kIllegalDataAddress);
+  EXPECT_EQ(response.isException(), true);
+  EXPECT_EQ(response.data(), ByteArray({0x02}));
+
+  SixteenBitValue value;
+  EXPECT_TRUE(d.holdingRegisterValue(0x01, &value));
+  EXPECT_EQ(value.toUint16(), 0x5678);
+}
+
+TEST(QModbusServer, processMaskWriteRegister_badAddress_failed) {
+  TestServer server;
+  QModbusServer modbusServer(&server);
+  QModbusServerPrivate d(&modbusServer);
+
+  d.setServerAddress(1);
+  d.setTransferMode(TransferMode::kRtu);
+
+  d.handleHoldingRegisters(0x00, 0x10);
+
+  Adu request;
+  Adu response;
+
+  request.setServerAddress(0x01);
+  request.setFunctionCode(FunctionCode::kMaskWriteRegister);
+  request.setData(ByteArray({0x00, 0x88, 0x00, 0xF2, 0x00, 0x25}));
+
+  d.processRequest(&request, &response);
+  EXPECT_EQ(response.error(), Error::kIllegalDataAddress);
+  EXPECT_EQ(response.isException(), true);
+  EXPECT_EQ(response.data(), ByteArray({0x02}));
+}
+
 TEST(QModbusServer, writeValueSixteenValue_success) {
   TestServer server;
   QModbusServer modbusServer(&server);
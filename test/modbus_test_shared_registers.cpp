@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <atomic>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <modbus/base/modbus_shared_registers.h>
+#include <thread>
+#include <vector>
+
+using namespace testing;
+using namespace modbus;
+
+TEST(SharedRegisters, formatAndAttach) {
+  std::vector<uint8_t> memory(SharedRegisters::requiredSize(200));
+  SharedRegisters server;
+  ASSERT_TRUE(server.format(memory.data(), memory.size(), 0x100, 200));
+  EXPECT_EQ(server.startAddress(), 0x100);
+  EXPECT_EQ(server.quantity(), 200u);
+
+  /// another process attaches the same region
+  SharedRegisters producer;
+  ASSERT_TRUE(producer.attach(memory.data(), memory.size()));
+  EXPECT_EQ(producer.startAddress(), 0x100);
+  EXPECT_EQ(producer.quantity(), 200u);
+
+  EXPECT_TRUE(producer.setValue(0x100 + 199, 0x1234));
+  EXPECT_EQ(server.value(0x100 + 199), 0x1234);
+  EXPECT_FALSE(producer.setValue(0x100 + 200, 0x1234));
+  EXPECT_FALSE(producer.setValue(0xFF, 0x1234));
+
+  SharedRegisters bad;
+  EXPECT_FALSE(bad.attach(memory.data(), memory.size() - 1));
+  memory[0] ^= 0xFF;
+  EXPECT_FALSE(bad.attach(memory.data(), memory.size()));
+}
+
+TEST(SharedRegisters, readWrite_acrossBlocks) {
+  std::vector<uint8_t> memory(SharedRegisters::requiredSize(300));
+  SharedRegisters regs;
+  ASSERT_TRUE(regs.format(memory.data(), memory.size(), 0, 300));
+
+  std::vector<uint8_t> values;
+  for (int i = 0; i < 125; i++) {
+    values.push_back(i);
+    values.push_back(i + 1);
+  }
+  ASSERT_TRUE(regs.write(50, values.data(), 125));
+
+  std::vector<uint8_t> out(250);
+  ASSERT_TRUE(regs.read(50, 125, out.data()));
+  EXPECT_EQ(out, values);
+  EXPECT_EQ(regs.value(51), 0x0102);
+  EXPECT_FALSE(regs.read(250, 51, out.data()));
+
+  /// the replaced values come back with the write
+  const uint8_t next[4] = {0xAA, 0xBB, 0xCC, 0xDD};
+  uint8_t previous[4] = {0};
+  ASSERT_TRUE(regs.write(50, next, 2, previous));
+  EXPECT_THAT(previous, ElementsAre(0x00, 0x01, 0x01, 0x02));
+  EXPECT_EQ(regs.value(51), 0xCCDD);
+
+  /// only the sequence counter of the block written moves
+  ASSERT_EQ(regs.blockCount(), 5u);
+  std::vector<uint32_t> sequences;
+  for (uint32_t b = 0; b < regs.blockCount(); b++) {
+    sequences.push_back(regs.blockSequence(b));
+  }
+  regs.setValue(130, 0x0001);
+  for (uint32_t b = 0; b < regs.blockCount(); b++) {
+    EXPECT_EQ(regs.blockSequence(b) != sequences[b], b == 2) << b;
+  }
+}
+
+TEST(SharedRegisters, concurrentWriter_readsAreConsistent) {
+  std::vector<uint8_t> memory(SharedRegisters::requiredSize(128));
+  SharedRegisters reader;
+  ASSERT_TRUE(reader.format(memory.data(), memory.size(), 0, 128));
+  SharedRegisters writer;
+  ASSERT_TRUE(writer.attach(memory.data(), memory.size()));
+
+  /// the writer fills all the registers with the same value, a torn read
+  /// would see two different values
+  std::atomic<bool> stop(false);
+  std::thread thread([&]() {
+    std::vector<uint8_t> values(256);
+    for (uint8_t round = 0; !stop.load(); round++) {
+      std::fill(values.begin(), values.end(), round);
+      writer.write(0, values.data(), 128);
+    }
+  });
+
+  std::vector<uint8_t> out(256);
+  for (int i = 0; i < 2000; i++) {
+    ASSERT_TRUE(reader.read(0, 128, out.data()));
+    ASSERT_EQ(std::count(out.begin(), out.end(), out[0]), 256);
+  }
+  stop = true;
+  thread.join();
+}
+
+TEST(SharedRegisters, blockLeftLocked_readAndWriteGiveUp) {
+  std::vector<uint8_t> memory(SharedRegisters::requiredSize(128));
+  SharedRegisters regs;
+  ASSERT_TRUE(regs.format(memory.data(), memory.size(), 0, 128));
+  regs.setValue(0, 0x1234);
+
+  /// a producer died while it wrote the second block, its counter stays odd
+  std::atomic<uint32_t> *sequences =
+      reinterpret_cast<std::atomic<uint32_t> *>(memory.data() +
+                                                SharedRegisters::kHeaderSize);
+  sequences[1].fetch_add(1);
+  const uint32_t first = regs.blockSequence(0);
+
+  uint8_t out[4] = {0};
+  const uint8_t values[4] = {0xAA, 0xBB, 0xCC, 0xDD};
+  EXPECT_FALSE(regs.read(63, 2, out));
+  EXPECT_FALSE(regs.write(63, values, 2));
+  EXPECT_FALSE(regs.maskWrite(64, 0x00FF, 0x1200));
+  /// the first block is unlocked again, as it was
+  EXPECT_EQ(regs.blockSequence(0), first);
+  EXPECT_TRUE(regs.read(0, 1, out));
+  EXPECT_THAT(std::vector<uint8_t>(out, out + 2), ElementsAre(0x12, 0x34));
+
+  sequences[1].fetch_add(1);
+  EXPECT_TRUE(regs.write(63, values, 2));
+  EXPECT_TRUE(regs.read(63, 2, out));
+  EXPECT_THAT(out, ElementsAre(0xAA, 0xBB, 0xCC, 0xDD));
+}
+
+TEST(SharedRegisters, maskWrite_appliedInOneWrite) {
+  std::vector<uint8_t> memory(SharedRegisters::requiredSize(10));
+  SharedRegisters regs;
+  ASSERT_TRUE(regs.format(memory.data(), memory.size(), 0, 10));
+  regs.setValue(4, 0x0012);
+
+  /// the example of the modbus specification
+  uint16_t previous = 0;
+  const uint32_t sequence = regs.blockSequence(0);
+  ASSERT_TRUE(regs.maskWrite(4, 0x00F2, 0x0025, &previous));
+  EXPECT_EQ(previous, 0x0012);
+  EXPECT_EQ(regs.value(4), 0x0017);
+  EXPECT_EQ(regs.blockSequence(0), sequence + 2);
+  EXPECT_FALSE(regs.maskWrite(10, 0x00F2, 0x0025));
+}
@@ -0,0 +1,98 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <modbus/base/modbus_static_request.h>
+
+using namespace testing;
+using namespace modbus;
+
+static_assert(modbus::internal::crc16(0x01, 0x03, 0x00, 0x00, 0x00, 0x0A) ==
+                  0xCDC5,
+              "crc is evaluated at compile time");
+
+TEST(StaticRequest, readHolding_frameIsConstexpr) {
+  using Poll = ReadHolding<0x01, 0x0000, 10>;
+  static_assert(Poll::kRtuFrameSize == 8, "");
+  static_assert(Poll::Response::kPduSize == 22, "");
+  static_assert(Poll::Response::kRtuFrameSize == 25, "");
+
+  std::vector<uint8_t> frame(Poll::kRtuFrame,
+                             Poll::kRtuFrame + Poll::kRtuFrameSize);
+  EXPECT_THAT(frame,
+              ElementsAre(0x01, 0x03, 0x00, 0x00, 0x00, 0x0A, 0xC5, 0xCD));
+  std::vector<uint8_t> pdu(Poll::kPdu, Poll::kPdu + Poll::kPduSize);
+  EXPECT_THAT(pdu, ElementsAre(0x03, 0x00, 0x00, 0x00, 0x0A));
+}
+
+TEST(StaticRequest, crc_sameAsRuntime) {
+  using Poll = ReadCoils<0x11, 0x0013, 0x25>;
+  const uint16_t crc = modbus::internal::crc16Of(Poll::kRtuFrame, 6);
+  EXPECT_EQ(crc, Poll::kCrc);
+  EXPECT_EQ(Poll::kRtuFrame[6], crc & 0xFF);
+  EXPECT_EQ(Poll::kRtuFrame[7], crc >> 8);
+}
+
+TEST(StaticRequest, readHoldingResponse_fromRtuFrame) {
+  using Poll = ReadHolding<0x01, 0x0000, 2>;
+  uint8_t frame[] = {0x01, 0x03, 0x04, 0x12, 0x34, 0x56, 0x78, 0x00, 0x00};
+  const uint16_t crc = modbus::internal::crc16Of(frame, sizeof(frame) - 2);
+  frame[7] = crc & 0xFF;
+  frame[8] = crc >> 8;
+
+  Poll::Response response;
+  ASSERT_TRUE(response.fromRtuFrame(frame, sizeof(frame)));
+  EXPECT_FALSE(response.isException());
+  EXPECT_EQ(response.value<0>(), 0x1234);
+  EXPECT_EQ(response.value<1>(), 0x5678);
+
+  // bad crc
+  frame[8] ^= 0xFF;
+  EXPECT_FALSE(response.fromRtuFrame(frame, sizeof(frame)));
+  EXPECT_FALSE(response.isValid());
+
+  // wrong size
+  EXPECT_FALSE(response.fromRtuFrame(frame, sizeof(frame) - 1));
+}
+
+TEST(StaticRequest, readHoldingResponse_exception) {
+  using Poll = ReadHolding<0x01, 0x0000, 2>;
+  uint8_t frame[] = {0x01, 0x83, 0x02, 0x00, 0x00};
+  const uint16_t crc = modbus::internal::crc16Of(frame, sizeof(frame) - 2);
+  frame[3] = crc & 0xFF;
+  frame[4] = crc >> 8;
+
+  Poll::Response response;
+  ASSERT_TRUE(response.fromRtuFrame(frame, sizeof(frame)));
+  EXPECT_TRUE(response.isException());
+  EXPECT_EQ(response.error(), Error::kIllegalDataAddress);
+}
+
+TEST(StaticRequest, readCoilsResponse_fromPdu) {
+  using Poll = ReadCoils<0x01, 0x0000, 10>;
+  static_assert(Poll::Response::kPduSize == 4, "");
+  const uint8_t pdu[] = {0x01, 0x02, 0x05, 0x02};
+
+  Poll::Response response;
+  ASSERT_TRUE(response.fromPdu(pdu, sizeof(pdu)));
+  EXPECT_TRUE(response.value<0>());
+  EXPECT_FALSE(response.value<1>());
+  EXPECT_TRUE(response.value<2>());
+  EXPECT_TRUE(response.value<9>());
+
+  const uint8_t badByteCount[] = {0x01, 0x03, 0x05, 0x02};
+  EXPECT_FALSE(response.fromPdu(badByteCount, sizeof(badByteCount)));
+}
+
+TEST(StaticRequest, writeRegisterResponse_isEcho) {
+  using Write = WriteRegister<0x01, 0x0001, 0x0003>;
+  std::vector<uint8_t> frame(Write::kRtuFrame,
+                             Write::kRtuFrame + Write::kRtuFrameSize);
+  EXPECT_THAT(frame,
+              ElementsAre(0x01, 0x06, 0x00, 0x01, 0x00, 0x03, 0x98, 0x0B));
+
+  Write::Response response;
+  EXPECT_TRUE(response.fromRtuFrame(Write::kRtuFrame, Write::kRtuFrameSize));
+
+  using WriteOther = WriteRegister<0x01, 0x0001, 0x0004>;
+  EXPECT_FALSE(response.fromRtuFrame(WriteOther::kRtuFrame,
+                                     WriteOther::kRtuFrameSize));
+}
@@ -0,0 +1,49 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <modbus/base/modbus_storage_snapshot.h>
+#include <vector>
+
+using namespace testing;
+using namespace modbus;
+
+TEST(StorageSnapshot, formatAndAttach) {
+  SnapshotTable tables[StorageSnapshot::kTableCount];
+  tables[0].startAddress = 0x10;
+  tables[0].quantity = 2000;
+  tables[2].quantity = 5000;
+
+  const size_t size = StorageSnapshot::requiredSize(tables);
+  /// a header page, one page of coils and 3 pages of holding registers
+  EXPECT_EQ(size, StorageSnapshot::kPageSize * 5);
+
+  std::vector<uint8_t> memory(size);
+  StorageSnapshot writer;
+  ASSERT_TRUE(writer.format(memory.data(), memory.size(), tables));
+  writer.data(StorageKind::kHoldingRegisters)[9999] = 0x5A;
+
+  StorageSnapshot reader;
+  ASSERT_TRUE(reader.attach(memory.data(), memory.size()));
+  EXPECT_TRUE(reader.table(StorageKind::kCoils) == tables[0]);
+  EXPECT_EQ(reader.table(StorageKind::kInputDiscrete).quantity, 0u);
+  EXPECT_EQ(reader.table(StorageKind::kHoldingRegisters).quantity, 5000u);
+  EXPECT_EQ(reader.data(StorageKind::kHoldingRegisters)[9999], 0x5A);
+  EXPECT_EQ(reader.data(StorageKind::kHoldingRegisters) -
+                reader.data(StorageKind::kCoils),
+            static_cast<ptrdiff_t>(StorageSnapshot::kPageSize));
+}
+
+TEST(StorageSnapshot, invalid_attachFailed) {
+  SnapshotTable tables[StorageSnapshot::kTableCount];
+  tables[3].quantity = 100;
+  std::vector<uint8_t> memory(StorageSnapshot::requiredSize(tables));
+  StorageSnapshot snapshot;
+  ASSERT_TRUE(snapshot.format(memory.data(), memory.size(), tables));
+
+  /// truncated file
+  EXPECT_FALSE(snapshot.attach(memory.data(), memory.size() - 1));
+  EXPECT_FALSE(snapshot.isAttached());
+
+  memory[0] = 0;
+  EXPECT_FALSE(snapshot.attach(memory.data(), memory.size()));
+  EXPECT_FALSE(snapshot.format(memory.data(), 100, tables));
+}
@@ -0,0 +1,247 @@
+#include "modbus_test_mocker.h"
+#include <QSignalSpy>
+#include <QTest>
+#include <modbus/tools/modbus_tcp_device_manager.h>
+
+#if defined(__linux__)
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace testing;
+using namespace modbus;
+
+#define declare_app(name)                                                      \
+  int argc = 1;                                                                \
+  char *argv[] = {(char *)"test"};                                             \
+  QCoreApplication name(argc, argv);
+
+/**
+ * a modbus tcp server on the loopback, it answers a read holding registers
+ * request of one register with its address, or nothing if it is silent
+ */
+class FakeTcpServer {
+public:
+  explicit FakeTcpServer(bool silent = false) : silent_(silent) {
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    ::bind(listenFd_, reinterpret_cast<struct sockaddr *>(&address), length);
+    ::listen(listenFd_, 128);
+    getsockname(listenFd_, reinterpret_cast<struct sockaddr *>(&address),
+                &length);
+    port_ = ntohs(address.sin_port);
+    thread_ = std::thread([this]() { run(); });
+  }
+
+  ~FakeTcpServer() {
+    stop_.store(true);
+    thread_.join();
+    for (auto &client : fds_) {
+      ::close(client.fd);
+    }
+  }
+
+  uint16_t port() const { return port_; }
+  int requests() const { return requests_.load(); }
+  int connections() const { return connections_.load(); }
+
+private:
+  void run() {
+    fds_.push_back({listenFd_, POLLIN, 0});
+    buffers_.emplace_back();
+    while (!stop_.load()) {
+      if (::poll(fds_.data(), fds_.size(), 10) <= 0) {
+        continue;
+      }
+      for (size_t i = fds_.size(); i-- > 0;) {
+        if (!(fds_[i].revents & POLLIN)) {
+          continue;
+        }
+        if (i == 0) {
+          fds_.push_back({::accept(listenFd_, nullptr, nullptr), POLLIN, 0});
+          buffers_.emplace_back();
+          connections_++;
+          continue;
+        }
+        uint8_t data[512];
+        const ssize_t n = ::read(fds_[i].fd, data, sizeof(data));
+        if (n <= 0) {
+          ::close(fds_[i].fd);
+          fds_.erase(fds_.begin() + i);
+          buffers_.erase(buffers_.begin() + i);
+          continue;
+        }
+        ByteArray &buffer = buffers_[i];
+        buffer.insert(buffer.end(), data, data + n);
+        /// 12 bytes, the mbap header, the unit id and the pdu
+        while (buffer.size() >= 12) {
+          const ByteArray request(buffer.begin(), buffer.begin() + 12);
+          buffer.erase(buffer.begin(), buffer.begin() + 12);
+          requests_++;
+          if (!silent_) {
+            const ByteArray response({request[0], request[1], 0x00, 0x00,
+                                      0x00, 0x05, request[6], 0x03, 0x02,
+                                      0x00, request[9]});
+            ASSERT_EQ(::write(fds_[i].fd, response.data(), response.size()),
+                      static_cast<ssize_t>(response.size()));
+          }
+        }
+      }
+    }
+  }
+
+  const bool silent_;
+  int listenFd_ = -1;
+  uint16_t port_ = 0;
+  std::vector<struct pollfd> fds_;
+  std::vector<ByteArray> buffers_;
+  std::atomic<bool> stop_{false};
+  std::atomic<int> requests_{0};
+  std::atomic<int> connections_{0};
+  std::thread thread_;
+};
+
+static TcpDevice tcpDevice(uint16_t port) {
+  TcpDevice device;
+  device.host = "127.0.0.1";
+  device.port = port;
+  device.waitResponseTimeout = 200;
+  device.reconnectDelay = 100;
+  return device;
+}
+
+static Request readRegister(uint8_t start) {
+  return Request(1, FunctionCode::kReadHoldingRegisters, any(),
+                 {0x00, start, 0x00, 0x01});
+}
+
+static void waitFor(QSignalSpy &spy, int count) {
+  for (int i = 0; i < 50 && spy.count() < count; i++) {
+    spy.wait(100);
+  }
+}
+
+TEST(TcpDeviceManager, addDevice_emptyHost_failed) {
+  TcpDeviceManager manager(1);
+  EXPECT_EQ(manager.addDevice(TcpDevice()), -1);
+  EXPECT_FALSE(manager.errorString().isEmpty());
+  EXPECT_EQ(manager.deviceCount(), 0);
+  EXPECT_FALSE(manager.sendRequest(0, readRegister(0)));
+}
+
+TEST(TcpDeviceManager, addDevice_balancedAcrossThreads) {
+  FakeTcpServer server;
+  TcpDeviceManager manager(3);
+  EXPECT_EQ(manager.threadCount(), 3);
+  int devices[3] = {0, 0, 0};
+  for (int i = 0; i < 9; i++) {
+    const TcpDeviceManager::DeviceId id =
+        manager.addDevice(tcpDevice(server.port()));
+    ASSERT_GE(id, 0);
+    devices[manager.threadOf(id)]++;
+  }
+  EXPECT_EQ(manager.deviceCount(), 9);
+  EXPECT_THAT(devices, ElementsAre(3, 3, 3));
+}
+
+TEST(TcpDeviceManager, sendRequest_manyDevices_requestFinished) {
+  declare_app(app);
+  FakeTcpServer server;
+  {
+    const int kDevices = 50;
+    TcpDeviceManager manager(2);
+    for (int i = 0; i < kDevices; i++) {
+      ASSERT_GE(manager.addDevice(tcpDevice(server.port())), 0);
+    }
+    QSignalSpy spy(&manager, &TcpDeviceManager::requestFinished);
+    /// sent from other threads, finished on this one
+    std::thread sender([&manager]() {
+      for (int round = 0; round < 2; round++) {
+        for (int device = 0; device < kDevices; device++) {
+          manager.sendRequest(device,
+                              readRegister(static_cast<uint8_t>(device)));
+        }
+      }
+    });
+    sender.join();
+    waitFor(spy, 2 * kDevices);
+
+    ASSERT_EQ(spy.count(), 2 * kDevices);
+    EXPECT_EQ(server.connections(), kDevices);
+    for (int i = 0; i < spy.count(); i++) {
+      const int device = spy.at(i).at(0).toInt();
+      const Response response = qvariant_cast<Response>(spy.at(i).at(2));
+      EXPECT_EQ(response.error(), Error::kNoError);
+      EXPECT_THAT(response.data(), ElementsAre(0x02, 0x00, device));
+    }
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(TcpDeviceManager, sendRequest_noResponse_timeoutAfterRetry) {
+  declare_app(app);
+  FakeTcpServer server(true);
+  {
+    TcpDeviceManager manager(1);
+    TcpDevice device = tcpDevice(server.port());
+    device.waitResponseTimeout = 50;
+    device.retryTimes = 1;
+    const TcpDeviceManager::DeviceId id = manager.addDevice(device);
+    ASSERT_GE(id, 0);
+
+    QSignalSpy spy(&manager, &TcpDeviceManager::requestFinished);
+    manager.sendRequest(id, readRegister(0));
+    waitFor(spy, 1);
+
+    ASSERT_EQ(spy.count(), 1);
+    /// sent twice
+    for (int i = 0; i < 100 && server.requests() < 2; i++) {
+      QTest::qWait(10);
+    }
+    EXPECT_EQ(server.requests(), 2);
+    const Response response = qvariant_cast<Response>(spy.at(0).at(2));
+    EXPECT_EQ(response.error(), Error::kTimeout);
+    EXPECT_EQ(response.serverAddress(), 1);
+    EXPECT_EQ(response.functionCode(), FunctionCode::kReadHoldingRegisters);
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(TcpDeviceManager, sendRequest_connectionRefused_timeout) {
+  declare_app(app);
+  uint16_t port = 0;
+  {
+    /// a port nobody listens on
+    FakeTcpServer server;
+    port = server.port();
+  }
+  {
+    TcpDeviceManager manager(1);
+    const TcpDeviceManager::DeviceId id = manager.addDevice(tcpDevice(port));
+    ASSERT_GE(id, 0);
+
+    QSignalSpy spy(&manager, &TcpDeviceManager::requestFinished);
+    manager.sendRequest(id, readRegister(0));
+    waitFor(spy, 1);
+
+    ASSERT_EQ(spy.count(), 1);
+    const Response response = qvariant_cast<Response>(spy.at(0).at(2));
+    EXPECT_EQ(response.error(), Error::kTimeout);
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+#endif // __linux__
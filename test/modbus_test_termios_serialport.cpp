@@ -0,0 +1,153 @@
+#include "modbus_test_mocker.h"
+#include <QSignalSpy>
+#include <QTest>
+#include <modbus/tools/modbus_termios_serialport.h>
+#include <modbus_frame.h>
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace testing;
+using namespace modbus;
+
+#define declare_app(name)                                                      \
+  int argc = 1;                                                                \
+  char *argv[] = {(char *)"test"};                                             \
+  QCoreApplication name(argc, argv);
+
+/// the master side of a pty pair, the port under test opens the slave side
+class PtyMaster {
+public:
+  PtyMaster() {
+    fd_ = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd_ >= 0 && grantpt(fd_) == 0 && unlockpt(fd_) == 0) {
+      slaveName_ = ptsname(fd_);
+    }
+  }
+  ~PtyMaster() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  bool isValid() const { return !slaveName_.empty(); }
+  QString slaveName() const { return QString::fromStdString(slaveName_); }
+
+  void write(const ByteArray &data) {
+    ASSERT_EQ(::write(fd_, data.data(), data.size()),
+              static_cast<ssize_t>(data.size()));
+  }
+
+  /// the bytes the port wrote, waiting up to 5s for size of them
+  ByteArray read(size_t size) {
+    ByteArray data;
+    for (int i = 0; i < 500 && data.size() < size; i++) {
+      uint8_t buffer[256];
+      const ssize_t n = ::read(fd_, buffer, sizeof(buffer));
+      if (n > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+        continue;
+      }
+      QTest::qWait(10);
+    }
+    return data;
+  }
+
+private:
+  int fd_ = -1;
+  std::string slaveName_;
+};
+
+TEST(TermiosSerialPort, portNotFound_error) {
+  TermiosSerialPort port;
+  port.setPortName("/dev/modbus-no-such-port");
+  QSignalSpy spy(&port, &AbstractIoDevice::error);
+  port.open();
+  EXPECT_EQ(spy.count(), 1);
+  EXPECT_FALSE(port.isOpen());
+}
+
+TEST(TermiosSerialPort, unsupportedBaudRate_rejected) {
+  TermiosSerialPort port;
+  EXPECT_TRUE(port.setBaudRate(115200));
+  EXPECT_FALSE(port.setBaudRate(12345));
+}
+
+TEST(TermiosSerialPort, pty_readAndWrite) {
+  declare_app(app);
+  PtyMaster master;
+  ASSERT_TRUE(master.isValid());
+  {
+    TermiosSerialPort port;
+    port.setPortName(master.slaveName());
+    port.setBaudRate(115200);
+    QSignalSpy openedSpy(&port, &AbstractIoDevice::opened);
+    port.open();
+    ASSERT_TRUE(port.isOpen());
+    EXPECT_EQ(openedSpy.count(), 1);
+
+    QSignalSpy readSpy(&port, &AbstractIoDevice::readyRead);
+    master.write({0x01, 0x03, 0x02, 0x00, 0x2a});
+    readSpy.wait(5000);
+    ASSERT_GE(readSpy.count(), 1);
+    pp::bytes::Buffer buffer;
+    for (int i = 0; i < 50 && buffer.Len() < 5; i++) {
+      port.readInto(buffer);
+      QTest::qWait(10);
+    }
+    ByteArray received(buffer.Len());
+    buffer.Read(received.data(), received.size());
+    EXPECT_THAT(received, ElementsAre(0x01, 0x03, 0x02, 0x00, 0x2a));
+    /// timestamped when the tty got readable
+    EXPECT_EQ(port.silence()->take().size, 5U);
+
+    QSignalSpy writtenSpy(&port, &AbstractIoDevice::bytesWritten);
+    port.write("\x0a\x0b", 2);
+    EXPECT_THAT(master.read(2), ElementsAre(0x0a, 0x0b));
+    EXPECT_EQ(writtenSpy.count(), 1);
+
+    QSignalSpy closedSpy(&port, &AbstractIoDevice::closed);
+    port.close();
+    EXPECT_FALSE(port.isOpen());
+    EXPECT_EQ(closedSpy.count(), 1);
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+TEST(TermiosSerialPort, createClient_termiosBackend_requestFinished) {
+  declare_app(app);
+  PtyMaster master;
+  ASSERT_TRUE(master.isValid());
+  {
+    std::unique_ptr<QModbusClient> client(
+        createClient("modbus.file://" + master.slaveName() +
+                     "/?115200-8-n-1&backend=termios"));
+    ASSERT_TRUE(client);
+    client->open();
+    for (int i = 0; i < 50 && !client->isOpened(); i++) {
+      QTest::qWait(10);
+    }
+    ASSERT_TRUE(client->isOpened());
+
+    QSignalSpy spy(client.get(), &QModbusClient::requestFinished);
+    client->readRegisters(1, FunctionCode::kReadHoldingRegisters, 0, 1);
+    const ByteArray request({0x01, 0x03, 0x00, 0x00, 0x00, 0x01});
+    EXPECT_EQ(master.read(8), tool::appendCrc(request));
+    master.write(tool::appendCrc(ByteArray({0x01, 0x03, 0x02, 0x00, 0x2a})));
+    spy.wait(5000);
+
+    ASSERT_EQ(spy.count(), 1);
+    const Response response = qvariant_cast<Response>(spy.at(0).at(1));
+    EXPECT_EQ(response.error(), Error::kNoError);
+    EXPECT_THAT(response.data(), ElementsAre(0x02, 0x00, 0x2a));
+    EXPECT_GE(client->turnaround(), 0);
+  }
+  QTimer::singleShot(1, [&]() { app.quit(); });
+  app.exec();
+}
+
+#endif // __linux__
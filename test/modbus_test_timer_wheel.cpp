@@ -0,0 +1,166 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <modbus/base/modbus_timer_wheel.h>
+#include <random>
+#include <vector>
+
+using namespace testing;
+using namespace modbus;
+
+/// a wheel with a tick of 1ms on a clock moved by the test
+class TimerWheelTest : public Test {
+protected:
+  TimerWheelTest() : wheel_(1000, [this]() { return now_; }) {}
+
+  /// move the clock by ms and advance the wheel
+  size_t sleep(int64_t ms) {
+    now_ += ms * 1000;
+    return wheel_.advance();
+  }
+
+  int64_t now_ = 1000000;
+  TimerWheel wheel_;
+};
+
+TEST_F(TimerWheelTest, schedule_firedAtExpiry) {
+  int fired = 0;
+  TimerWheel::Timer timer([&]() { fired++; });
+  wheel_.schedule(&timer, 10 * 1000);
+  EXPECT_TRUE(timer.isActive());
+  EXPECT_EQ(wheel_.size(), 1U);
+  EXPECT_EQ(wheel_.nextExpiry(), now_ + 10 * 1000);
+
+  EXPECT_EQ(sleep(9), 0U);
+  EXPECT_EQ(fired, 0);
+  EXPECT_EQ(sleep(1), 1U);
+  EXPECT_EQ(fired, 1);
+  EXPECT_FALSE(timer.isActive());
+  EXPECT_TRUE(wheel_.empty());
+  EXPECT_EQ(wheel_.nextExpiry(), -1);
+}
+
+TEST_F(TimerWheelTest, cancel_neverFired) {
+  int fired = 0;
+  TimerWheel::Timer timer([&]() { fired++; });
+  wheel_.schedule(&timer, 5 * 1000);
+  timer.cancel();
+  EXPECT_FALSE(timer.isActive());
+  EXPECT_TRUE(wheel_.empty());
+  sleep(100);
+  EXPECT_EQ(fired, 0);
+}
+
+TEST_F(TimerWheelTest, cancelInTheTickThatFiresIt_neverFired) {
+  int fired = 0;
+  TimerWheel::Timer second([&]() { fired++; });
+  TimerWheel::Timer first([&]() { second.cancel(); });
+  wheel_.schedule(&first, 5 * 1000);
+  wheel_.schedule(&second, 5 * 1000);
+  EXPECT_EQ(sleep(5), 1U);
+  EXPECT_EQ(fired, 0);
+  EXPECT_TRUE(wheel_.empty());
+}
+
+TEST_F(TimerWheelTest, reschedule_movesTheExpiry) {
+  int fired = 0;
+  TimerWheel::Timer timer([&]() { fired++; });
+  wheel_.schedule(&timer, 5 * 1000);
+  wheel_.schedule(&timer, 20 * 1000);
+  EXPECT_EQ(wheel_.size(), 1U);
+  sleep(10);
+  EXPECT_EQ(fired, 0);
+  sleep(10);
+  EXPECT_EQ(fired, 1);
+}
+
+TEST_F(TimerWheelTest, rescheduleFromCallback_periodic) {
+  int fired = 0;
+  TimerWheel::Timer timer;
+  timer.setCallback([&]() {
+    fired++;
+    wheel_.schedule(&timer, 100 * 1000);
+  });
+  wheel_.schedule(&timer, 100 * 1000);
+  for (int i = 0; i < 50; i++) {
+    sleep(100);
+  }
+  EXPECT_EQ(fired, 50);
+}
+
+TEST_F(TimerWheelTest, destroyed_cancelled) {
+  {
+    TimerWheel::Timer timer([]() {});
+    wheel_.schedule(&timer, 1000);
+  }
+  EXPECT_TRUE(wheel_.empty());
+  EXPECT_EQ(sleep(10), 0U);
+}
+
+TEST_F(TimerWheelTest, everyLevel_firedAtExpiry) {
+  /// 1ms to beyond the last level(4.7h)
+  const std::vector<int64_t> delays = {1,      63,      64,       65,
+                                       4095,   4096,    262143,   262144,
+                                       300000, 1 << 24, (1 << 24) + 5000};
+  std::vector<std::unique_ptr<TimerWheel::Timer>> timers;
+  std::vector<int64_t> firedAt(delays.size(), -1);
+  const int64_t start = now_;
+  for (size_t i = 0; i < delays.size(); i++) {
+    timers.emplace_back(new TimerWheel::Timer([&, i]() {
+      firedAt[i] = (now_ - start) / 1000;
+    }));
+    wheel_.schedule(timers.back().get(), delays[i] * 1000);
+  }
+  /// the clock is moved to each wakeup the wheel asks for
+  while (!wheel_.empty()) {
+    const int64_t next = wheel_.nextExpiry();
+    ASSERT_GT(next, now_);
+    now_ = next;
+    wheel_.advance();
+  }
+  for (size_t i = 0; i < delays.size(); i++) {
+    EXPECT_EQ(firedAt[i], delays[i]) << i;
+  }
+}
+
+TEST_F(TimerWheelTest, manyRandomTimers_noneEarlyOrLate) {
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int64_t> delay(1, 20000);
+  const size_t kTimers = 2000;
+  std::vector<std::unique_ptr<TimerWheel::Timer>> timers;
+  std::vector<int64_t> expected(kTimers);
+  size_t wrong = 0;
+  for (size_t i = 0; i < kTimers; i++) {
+    expected[i] = now_ + delay(random) * 1000;
+    timers.emplace_back(new TimerWheel::Timer([&, i]() {
+      if (now_ != expected[i]) {
+        wrong++;
+      }
+    }));
+    wheel_.schedule(timers.back().get(), expected[i] - now_);
+  }
+  /// every other one is cancelled
+  for (size_t i = 0; i < kTimers; i += 2) {
+    timers[i]->cancel();
+  }
+  size_t fired = 0;
+  for (int i = 0; i < 20000; i++) {
+    fired += sleep(1);
+  }
+  EXPECT_EQ(fired, kTimers / 2);
+  EXPECT_EQ(wrong, 0U);
+}
+
+TEST_F(TimerWheelTest, lateAdvance_firesAllDue) {
+  int fired = 0;
+  TimerWheel::Timer a([&]() { fired++; });
+  TimerWheel::Timer b([&]() { fired++; });
+  TimerWheel::Timer c([&]() { fired++; });
+  wheel_.schedule(&a, 3 * 1000);
+  wheel_.schedule(&b, 700 * 1000);
+  wheel_.schedule(&c, 5000 * 1000);
+  EXPECT_EQ(sleep(1000), 2U);
+  EXPECT_EQ(fired, 2);
+  EXPECT_TRUE(c.isActive());
+  EXPECT_EQ(sleep(4000), 1U);
+}